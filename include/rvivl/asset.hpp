@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rvivl {
+
+    // A read-only memory mapping of a whole file. Mappings start on a page
+    // boundary, so the bytes are suitably aligned for SPIR-V words or any
+    // other plain data.
+    class MappedFile {
+    public:
+        // Throws if the file cannot be opened or mapped
+        explicit MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        std::span<const char> bytes() const {
+            return {static_cast<const char *>(data_), size_};
+        }
+
+    private:
+        void *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Bytes of an asset and the mapping that keeps them alive. Copies share
+    // the mapping.
+    class Asset {
+    public:
+        Asset() = default;
+        Asset(std::shared_ptr<const MappedFile> file,
+              std::span<const char> bytes)
+            : file_(std::move(file)), bytes_(bytes) {}
+
+        std::span<const char> bytes() const { return bytes_; }
+        size_t size() const { return bytes_.size(); }
+
+        // The bytes as 32-bit words, e.g. SPIR-V for vkCreateShaderModule.
+        // Throws if the size or alignment does not allow that.
+        std::span<const uint32_t> words() const;
+
+    private:
+        std::shared_ptr<const MappedFile> file_;
+        std::span<const char> bytes_;
+    };
+
+    struct ArchiveEntry {
+        std::string name;
+        std::span<const char> data;
+    };
+
+    // Packs entries into one file: a header, an index of names, offsets
+    // and sizes, then the data of every entry at a 16-byte aligned offset
+    std::vector<char> encodeAssetArchive(
+        const std::vector<ArchiveEntry> &entries);
+
+    // A file written by encodeAssetArchive(), mapped into memory. Lookups
+    // return views into the mapping, nothing is read or copied up front
+    // apart from the index.
+    class AssetArchive {
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        // Throws if the file is missing, has another format version or is
+        // truncated
+        explicit AssetArchive(const std::string &path);
+
+        std::optional<Asset> find(std::string_view name) const;
+        size_t size() const { return entries_.size(); }
+
+    private:
+        std::shared_ptr<const MappedFile> file_;
+        std::map<std::string, std::span<const char>, std::less<>> entries_;
+    };
+
+    // Looks assets up by name in archives and then in directories, each in
+    // the order they were added
+    class AssetLibrary {
+    public:
+        void addArchive(const std::string &path);
+        void addDirectory(std::string path);
+
+        std::optional<Asset> tryLoad(const std::string &name) const;
+        // Throws if no archive or directory has name
+        Asset load(const std::string &name) const;
+
+    private:
+        std::vector<AssetArchive> archives_;
+        std::vector<std::string> directories_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    class Renderer;
+
+    // One resource bound to a compute pipeline, in the order of
+    // ComputePipelineCreateInfo::bindings
+    struct ComputeResource {
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL;
+        VkSampler sampler = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize range = VK_WHOLE_SIZE;
+
+        // Storage images are read and written in GENERAL
+        static ComputeResource storageImage(VkImageView view) {
+            ComputeResource resource;
+            resource.view = view;
+            return resource;
+        }
+        static ComputeResource sampledImage(VkImageView view,
+                                            VkSampler sampler,
+                                            VkImageLayout layout) {
+            ComputeResource resource;
+            resource.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            resource.view = view;
+            resource.layout = layout;
+            resource.sampler = sampler;
+            return resource;
+        }
+        static ComputeResource
+        storageBuffer(VkBuffer buffer, VkDeviceSize offset = 0,
+                      VkDeviceSize range = VK_WHOLE_SIZE) {
+            ComputeResource resource;
+            resource.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            resource.buffer = buffer;
+            resource.offset = offset;
+            resource.range = range;
+            return resource;
+        }
+    };
+
+    struct ComputePipelineCreateInfo {
+        // Must outlive the pipeline
+        Renderer *renderer = nullptr;
+
+        // SPIR-V of the compute shader, only read by the constructor
+        std::span<const uint32_t> shaderCode;
+
+        // Descriptor types of bindings 0, 1, ... of set 0
+        std::vector<VkDescriptorType> bindings;
+        // Bytes of push constants, at offset 0
+        uint32_t pushConstantSize = 0;
+
+        // local_size of the shader, which dispatch() divides by
+        uint32_t localSizeX = 8;
+        uint32_t localSizeY = 8;
+        uint32_t localSizeZ = 1;
+    };
+
+    // A compute shader with one descriptor set and push constants. Each
+    // bind() takes its set from Renderer::frameDescriptors(), so resources
+    // can change from dispatch to dispatch without sets being managed by
+    // the caller. Dispatches are recorded outside the render pass, e.g.
+    // from the beforeRendering callback of Renderer::beginFrame().
+    class ComputePipeline {
+    public:
+        static constexpr uint32_t MAX_BINDINGS = 8;
+
+        explicit ComputePipeline(const ComputePipelineCreateInfo &createInfo);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline &) = delete;
+        ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+        // Binds the pipeline, a set holding resources and pushConstants,
+        // which must hold pushConstantSize bytes. Throws if resources do
+        // not match the bindings.
+        void bind(VkCommandBuffer commandBuffer,
+                  std::span<const ComputeResource> resources,
+                  const void *pushConstants = nullptr) const;
+
+        // Dispatches enough workgroups to cover width x height x depth
+        // invocations; the shader skips the ones past the edge
+        void dispatch(VkCommandBuffer commandBuffer, uint32_t width,
+                      uint32_t height = 1, uint32_t depth = 1) const;
+
+        static uint32_t groupCount(uint32_t invocations, uint32_t localSize) {
+            return (invocations + localSize - 1) / localSize;
+        }
+
+        VkPipeline pipeline() const { return pipeline_; }
+        VkPipelineLayout pipelineLayout() const { return pipelineLayout_; }
+        VkDescriptorSetLayout setLayout() const { return setLayout_; }
+
+    private:
+        void destroy();
+
+        Renderer *renderer_;
+        VkDevice device_;
+        std::vector<VkDescriptorType> bindings_;
+        uint32_t pushConstantSize_;
+        uint32_t localSize_[3];
+
+        VkDescriptorSetLayout setLayout_ = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+        VkPipeline pipeline_ = VK_NULL_HANDLE;
+    };
+
+    // Records a barrier for the whole color image, e.g. between a dispatch
+    // writing it and a later one or a fragment shader sampling it
+    void imageBarrier(VkCommandBuffer commandBuffer, VkImage image,
+                      VkImageLayout oldLayout, VkImageLayout newLayout,
+                      VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                      VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+} // namespace rvivl
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Hands out the slots of a descriptor array. A freed slot is only
+    // handed out again once the frame that last used it has completed, so
+    // a descriptor is never rewritten while a command buffer in flight may
+    // still read it. Slots that were never used come last, which keeps the
+    // used part of the array small.
+    class DescriptorIndexAllocator {
+    public:
+        static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+        explicit DescriptorIndexAllocator(uint32_t capacity);
+
+        // Returns NO_INDEX when every slot is in use or waiting for its
+        // frame
+        uint32_t allocate();
+
+        // The frame numbered serial may still read index
+        void free(uint32_t index, uint64_t serial);
+
+        // Makes the slots freed by frames up to completedSerial available
+        void release(uint64_t completedSerial);
+
+        uint32_t capacity() const { return capacity_; }
+        // Slots allocated and not yet released
+        uint32_t size() const { return size_; }
+
+    private:
+        struct Retired {
+            uint32_t index;
+            uint64_t serial;
+        };
+
+        uint32_t capacity_;
+        uint32_t size_ = 0;
+        // Slots below next_ have been handed out before
+        uint32_t next_ = 0;
+        std::vector<uint32_t> free_;
+        std::vector<Retired> retired_;
+    };
+
+    struct DescriptorHeapCreateInfo {
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+
+        // Array sizes, clamped to the device's update after bind limits
+        uint32_t maxImages = 4096;
+        uint32_t maxBuffers = 1024;
+    };
+
+    // One descriptor set that holds every sampled image and storage buffer,
+    // so a frame binds it once instead of a set per draw. Binding 0 is an
+    // array of combined image samplers and binding 1 one of storage
+    // buffers; shaders index them with the slot addImage() or addBuffer()
+    // returned, e.g. from a push constant or the instance index.
+    //
+    // Both bindings are partially bound and written with update after
+    // bind, which needs descriptor indexing (core in Vulkan 1.2, see
+    // supported()). Adding a slot therefore never waits for the frames in
+    // flight, and removed slots are recycled through a
+    // DescriptorIndexAllocator. Belongs to the render thread.
+    class DescriptorHeap {
+    public:
+        static constexpr uint32_t NO_INDEX = DescriptorIndexAllocator::NO_INDEX;
+        static constexpr uint32_t IMAGE_BINDING = 0;
+        static constexpr uint32_t BUFFER_BINDING = 1;
+
+        // True if the device has every feature enableFeatures() turns on
+        static bool supported(VkPhysicalDevice physicalDevice);
+        // Adds the features the heap needs to a device's create info
+        static void enableFeatures(VkPhysicalDeviceVulkan12Features &features);
+
+        explicit DescriptorHeap(const DescriptorHeapCreateInfo &createInfo);
+        ~DescriptorHeap();
+
+        DescriptorHeap(const DescriptorHeap &) = delete;
+        DescriptorHeap &operator=(const DescriptorHeap &) = delete;
+
+        // Writes the image into a free slot and returns it. view must be in
+        // layout whenever a shader samples the slot. Throws if the heap is
+        // full.
+        uint32_t addImage(VkImageView view, VkSampler sampler,
+                          VkImageLayout layout);
+        uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset,
+                           VkDeviceSize range);
+
+        // The frame numbered serial may still read the slot, it is reused
+        // once that frame has completed
+        void removeImage(uint32_t index, uint64_t serial);
+        void removeBuffer(uint32_t index, uint64_t serial);
+
+        // Recycles the slots of completed frames. Called by the renderer
+        // at the start of every frame.
+        void release(uint64_t completedSerial);
+
+        // Binds the set as set number firstSet of layout
+        void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+                  VkPipelineLayout layout, uint32_t firstSet = 0) const;
+
+        VkDescriptorSetLayout setLayout() const { return setLayout_; }
+        VkDescriptorSet descriptorSet() const { return descriptorSet_; }
+        uint32_t imageCapacity() const { return images_.capacity(); }
+        uint32_t bufferCapacity() const { return buffers_.capacity(); }
+        uint32_t imageCount() const { return images_.size(); }
+        uint32_t bufferCount() const { return buffers_.size(); }
+
+    private:
+        void destroy();
+
+        VkDevice device_;
+        DescriptorIndexAllocator images_;
+        DescriptorIndexAllocator buffers_;
+        VkDescriptorSetLayout setLayout_ = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool_ = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet_ = VK_NULL_HANDLE;
+    };
+
+    struct FrameDescriptorAllocatorCreateInfo {
+        VkDevice device = VK_NULL_HANDLE;
+
+        // One list of pools per frame in flight
+        uint32_t frameCount = 2;
+
+        // Sets per pool. A frame that runs out adds another pool, which it
+        // keeps from then on.
+        uint32_t setsPerPool = 256;
+        // Descriptors of each type per set on average, scaled by
+        // setsPerPool
+        std::vector<VkDescriptorPoolSize> poolSizes = {
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+            // Uniforms in Renderer::frameArena(), see FrameRing
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        };
+    };
+
+    // Descriptor sets that live for one frame, the fallback for devices
+    // without descriptor indexing. Each frame slot allocates from its own
+    // pools, which are reset as a whole once the renderer has waited for
+    // the slot, so sets are never freed one by one and the pools never
+    // fragment. Belongs to the render thread.
+    class FrameDescriptorAllocator {
+    public:
+        explicit FrameDescriptorAllocator(
+            const FrameDescriptorAllocatorCreateInfo &createInfo);
+        ~FrameDescriptorAllocator();
+
+        FrameDescriptorAllocator(const FrameDescriptorAllocator &) = delete;
+        FrameDescriptorAllocator &
+        operator=(const FrameDescriptorAllocator &) = delete;
+
+        // Resets the pools of frameIndex. Called by the renderer at the
+        // start of every frame.
+        void beginFrame(uint32_t frameIndex);
+
+        // A set of layout that is valid until the frame slot comes round
+        // again
+        VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+        // Pools the current frame has allocated from
+        uint32_t poolsUsed() const { return frames_[frameIndex_].used; }
+
+    private:
+        struct Frame {
+            std::vector<VkDescriptorPool> pools;
+            // pools[used - 1] is the one being allocated from
+            uint32_t used = 0;
+        };
+
+        VkDescriptorPool createPool();
+        void destroy();
+
+        VkDevice device_;
+        uint32_t setsPerPool_;
+        std::vector<VkDescriptorPoolSize> poolSizes_;
+        std::vector<Frame> frames_;
+        uint32_t frameIndex_ = 0;
+    };
+
+} // namespace rvivl
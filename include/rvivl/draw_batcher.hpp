@@ -0,0 +1,142 @@
+#pragma once
+
+#include "rvivl/memory_allocator.hpp"
+#include "rvivl/upload_queue.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Indirect draw commands of one frame, grouped by pipeline in the order
+    // each pipeline was first used. Storage is kept across clear() so a
+    // steady frame loop does not allocate.
+    class DrawList {
+    public:
+        struct Batch {
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            std::vector<VkDrawIndexedIndirectCommand> commands;
+        };
+
+        void clear();
+        void add(VkPipeline pipeline,
+                 const VkDrawIndexedIndirectCommand &command);
+
+        std::span<const Batch> batches() const {
+            return {batches_.data(), batchCount_};
+        }
+        uint32_t drawCount() const { return drawCount_; }
+
+    private:
+        std::vector<Batch> batches_;
+        uint32_t batchCount_ = 0;
+        uint32_t drawCount_ = 0;
+        uint32_t lastBatch_ = 0;
+    };
+
+    struct DrawBatcherCreateInfo {
+        MemoryAllocator *allocator = nullptr;
+        // Fills the megabuffers; the frame that first draws a new mesh
+        // waits for it through Renderer::submit()
+        UploadQueue *uploadQueue = nullptr;
+
+        // One region of the indirect buffer per frame in flight
+        uint32_t frameCount = 2;
+
+        // Without the multiDrawIndirect feature every command is issued as
+        // its own indirect draw, which still saves the buffer binds
+        bool multiDrawIndirect = false;
+        // Queried for maxDrawIndirectCount, which batches larger than it
+        // are split at. Needed with multiDrawIndirect.
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+        // Every mesh shares one vertex layout and index type
+        uint32_t vertexStride = 0;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+
+        // Megabuffer sizes in vertices and indices
+        uint32_t vertexCapacity = 1u << 20;
+        uint32_t indexCapacity = 1u << 22;
+
+        // Draws per frame
+        uint32_t maxDraws = 1u << 16;
+    };
+
+    // Where a mesh lives in the megabuffers
+    struct Mesh {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        int32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+    };
+
+    // Packs meshes into shared vertex and index megabuffers and turns the
+    // draws of a frame into VkDrawIndexedIndirectCommand records in a
+    // persistently mapped buffer. The buffers are bound once per frame and
+    // every pipeline costs a single vkCmdDrawIndexedIndirect, however many
+    // meshes it draws, unless they exceed the device's
+    // maxDrawIndirectCount.
+    class DrawBatcher {
+    public:
+        explicit DrawBatcher(const DrawBatcherCreateInfo &createInfo);
+        ~DrawBatcher();
+
+        DrawBatcher(const DrawBatcher &) = delete;
+        DrawBatcher &operator=(const DrawBatcher &) = delete;
+
+        // Copies the mesh into the megabuffers. Indices are relative to the
+        // mesh's own vertices and use the batcher's index type.
+        Mesh addMesh(const void *vertices, uint32_t vertexCount,
+                     const void *indices, uint32_t indexCount);
+
+        // Frees the mesh's ranges. No frame still in flight may draw it.
+        void removeMesh(const Mesh &mesh);
+
+        // Starts a new draw list that is written to the indirect buffer
+        // region of the frame slot frameIndex
+        void beginFrame(uint32_t frameIndex);
+
+        void draw(VkPipeline pipeline, const Mesh &mesh,
+                  uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+        // Writes the draw list and records it into commandBuffer, which
+        // must be inside the render pass with viewport and scissor set
+        void record(VkCommandBuffer commandBuffer);
+
+        uint32_t drawCount() const { return drawList_.drawCount(); }
+        uint32_t batchCount() const {
+            return static_cast<uint32_t>(drawList_.batches().size());
+        }
+
+        VkBuffer vertexBuffer() const { return vertexBuffer_.buffer; }
+        VkBuffer indexBuffer() const { return indexBuffer_.buffer; }
+
+    private:
+        void destroy();
+
+        MemoryAllocator *allocator_;
+        UploadQueue *uploadQueue_;
+        uint32_t frameCount_;
+        bool multiDrawIndirect_;
+        // Commands per vkCmdDrawIndexedIndirect
+        uint32_t maxDrawCount_ = 1;
+        uint32_t vertexStride_;
+        VkIndexType indexType_;
+        uint32_t indexSize_;
+        uint32_t maxDraws_;
+
+        // Ranges are counted in vertices and indices rather than bytes
+        MemoryBlockMetadata vertexRanges_;
+        MemoryBlockMetadata indexRanges_;
+
+        Buffer vertexBuffer_;
+        Buffer indexBuffer_;
+        Buffer indirectBuffer_;
+
+        DrawList drawList_;
+        uint32_t frameIndex_ = 0;
+    };
+
+} // namespace rvivl
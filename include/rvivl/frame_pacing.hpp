@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    enum class PacingMode {
+        // No tearing and little queueing: MAILBOX where available, two
+        // frames in flight
+        Balanced,
+        // Highest frame rate: IMMEDIATE, deep swapchain and three frames in
+        // flight, at the cost of tearing and latency
+        Throughput,
+        // Shortest input to present delay: a single frame in flight and
+        // the smallest swapchain, so input is sampled right before the
+        // frame that shows it is recorded
+        LowLatency,
+    };
+
+    struct PacingPolicy {
+        PacingMode mode = PacingMode::Balanced;
+
+        // Override the mode's choices. A present mode the surface does not
+        // support falls back to the mode's preference.
+        uint32_t framesInFlight = 0;
+        uint32_t imageCount = 0;
+        std::optional<VkPresentModeKHR> presentMode;
+    };
+
+    // Upper bound for PacingPolicy::framesInFlight
+    inline constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    uint32_t chooseFramesInFlight(const PacingPolicy &policy);
+
+    // FIFO is always supported and the last resort of every mode
+    VkPresentModeKHR
+    choosePresentMode(const PacingPolicy &policy,
+                      const std::vector<VkPresentModeKHR> &availableModes);
+
+    // Clamped to what the surface allows
+    uint32_t chooseImageCount(const PacingPolicy &policy,
+                              VkPresentModeKHR presentMode,
+                              const VkSurfaceCapabilitiesKHR &capabilities);
+
+    struct LatencyStats {
+        uint32_t samples = 0;
+        std::chrono::steady_clock::duration last{};
+        std::chrono::steady_clock::duration average{};
+        std::chrono::steady_clock::duration max{};
+    };
+
+    // Measures the CPU time from an input event to the present of the
+    // first frame recorded after it. Inputs are latched into a frame when
+    // it begins, so input arriving while a frame is recorded counts
+    // towards the next one.
+    class LatencyTracker {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Number of most recent frames the statistics cover
+        static constexpr uint32_t WINDOW = 128;
+
+        // Only the earliest input since the last frame began is kept
+        void input(Clock::time_point when);
+        void beginFrame();
+        void present(Clock::time_point when);
+
+        LatencyStats stats() const;
+
+    private:
+        std::optional<Clock::time_point> pending_;
+        std::optional<Clock::time_point> frameInput_;
+        std::array<Clock::duration, WINDOW> samples_{};
+        uint32_t count_ = 0;
+        uint32_t next_ = 0;
+    };
+
+    // The parts of the surface that changed since the last present, for
+    // drawing only when something did and for Renderer::endFrame(damage).
+    // Kept in a fixed number of rectangles: overlapping ones are merged,
+    // and once they run out everything collapses into one bounding box.
+    class DamageRegion {
+    public:
+        static constexpr uint32_t MAX_RECTS = 8;
+
+        // Empty rectangles are ignored
+        void add(VkRect2D rect);
+        // The whole surface changed, e.g. after a resize or an expose
+        void addAll();
+        void clear();
+
+        bool empty() const { return !full_ && count_ == 0; }
+        bool full() const { return full_; }
+        // Empty both when nothing and when everything changed, which is
+        // what endFrame() takes to mean the whole image
+        std::span<const VkRect2D> rects() const;
+
+    private:
+        std::array<VkRect2D, MAX_RECTS> rects_{};
+        uint32_t count_ = 0;
+        bool full_ = false;
+    };
+
+} // namespace rvivl
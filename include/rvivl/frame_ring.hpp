@@ -0,0 +1,136 @@
+#pragma once
+
+#include "rvivl/memory_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    struct FrameRingCreateInfo {
+        MemoryAllocator *allocator = nullptr;
+
+        // One region per frame in flight
+        uint32_t frameCount = 2;
+        VkDeviceSize frameSize = 4ull << 20;
+
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+
+        // minUniformBufferOffsetAlignment of the device, which pushUniform()
+        // aligns to. 256 is the largest any device requires.
+        VkDeviceSize uniformAlignment = 256;
+    };
+
+    // Where a FrameRing allocation lives in the buffer and in host memory
+    struct FrameAllocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void *mapped = nullptr;
+
+        // Where a dynamic descriptor of FrameRing::bufferInfo() is bound to
+        // reach the allocation
+        uint32_t dynamicOffset() const {
+            return static_cast<uint32_t>(offset);
+        }
+    };
+
+    // Offset bookkeeping for a FrameRing: one region of frameSize bytes
+    // per frame in flight, bumped through and rewound as a whole
+    class FrameRegions {
+    public:
+        FrameRegions(uint32_t frameCount, VkDeviceSize frameSize,
+                     VkDeviceSize uniformAlignment);
+
+        // Throws if frameIndex is out of range
+        void beginFrame(uint32_t frameIndex);
+
+        // Finds room for size bytes in the current region. offset is from
+        // the start of the buffer and aligned within it, not just within
+        // the region. Returns false if the region is full.
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment,
+                      VkDeviceSize &offset);
+        // Like allocate(), aligned to at least the uniform alignment
+        bool allocateUniform(VkDeviceSize size, VkDeviceSize alignment,
+                             VkDeviceSize &offset) {
+            return allocate(size, std::max(uniformAlignment_, alignment),
+                            offset);
+        }
+
+        uint32_t frameCount() const { return frameCount_; }
+        VkDeviceSize frameSize() const { return frameSize_; }
+        VkDeviceSize bytesUsed() const { return head_; }
+
+    private:
+        uint32_t frameCount_;
+        VkDeviceSize frameSize_;
+        VkDeviceSize uniformAlignment_;
+        uint32_t frameIndex_ = 0;
+        VkDeviceSize head_ = 0;
+    };
+
+    // A persistently mapped buffer split into one region per frame in
+    // flight, for data that is written every frame such as instance
+    // streams, uniforms and immediate-mode vertices. Allocation bumps
+    // through the current frame's region, which is reused as a whole once
+    // the renderer has waited for that frame slot, so nothing is allocated
+    // or mapped per frame. Uniforms go through one
+    // VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor written once
+    // with bufferInfo() and bound at each allocation's dynamicOffset().
+    class FrameRing {
+    public:
+        explicit FrameRing(const FrameRingCreateInfo &createInfo);
+        ~FrameRing();
+
+        FrameRing(const FrameRing &) = delete;
+        FrameRing &operator=(const FrameRing &) = delete;
+
+        // Rewinds the region of frameIndex. Call after
+        // Renderer::beginFrame() with Renderer::frameIndex().
+        void beginFrame(uint32_t frameIndex);
+
+        // Throws if the frame's region is full
+        FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+        // Copies data into the ring
+        template <typename T> FrameAllocation push(std::span<const T> data) {
+            FrameAllocation allocation =
+                allocate(data.size_bytes(), alignof(T));
+            memcpy(allocation.mapped, data.data(), data.size_bytes());
+            return allocation;
+        }
+
+        // Copies data where a dynamic uniform buffer descriptor can point
+        template <typename T> FrameAllocation pushUniform(const T &data) {
+            FrameAllocation allocation =
+                allocateUniform(sizeof(T), alignof(T));
+            memcpy(allocation.mapped, &data, sizeof(T));
+            return allocation;
+        }
+
+        // The whole ring, for a dynamic descriptor that shows range bytes
+        // from the offset it is bound at, so range should be the uniform's
+        // size. The buffer never changes and the descriptor can be written
+        // once.
+        VkDescriptorBufferInfo bufferInfo(VkDeviceSize range) const {
+            return {buffer_.buffer, 0, range};
+        }
+
+        VkBuffer buffer() const { return buffer_.buffer; }
+        VkDeviceSize frameSize() const { return regions_.frameSize(); }
+        // Bytes allocated in the current frame, including alignment padding
+        VkDeviceSize bytesUsed() const { return regions_.bytesUsed(); }
+
+    private:
+        FrameAllocation allocateUniform(VkDeviceSize size,
+                                        VkDeviceSize alignment);
+        FrameAllocation at(VkDeviceSize offset) const;
+
+        MemoryAllocator *allocator_;
+        FrameRegions regions_;
+        Buffer buffer_;
+    };
+
+} // namespace rvivl
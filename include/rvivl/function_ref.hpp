@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace rvivl {
+
+    template <typename Signature> class FunctionRef;
+
+    // Non-owning reference to a callable, so per-frame callbacks can be
+    // passed without the heap allocation std::function may need. The
+    // callable must outlive the call it is passed to.
+    template <typename R, typename... Args> class FunctionRef<R(Args...)> {
+    public:
+        template <typename F>
+            requires(!std::is_same_v<std::remove_cvref_t<F>, FunctionRef> &&
+                     std::is_invocable_r_v<R, F &, Args...>)
+        FunctionRef(F &&function)
+            : object_(const_cast<void *>(
+                  static_cast<const void *>(std::addressof(function)))),
+              invoke_([](void *object, Args... args) -> R {
+                  return (*static_cast<std::remove_reference_t<F> *>(object))(
+                      std::forward<Args>(args)...);
+              }) {}
+
+        R operator()(Args... args) const {
+            return invoke_(object_, std::forward<Args>(args)...);
+        }
+
+    private:
+        void *object_;
+        R (*invoke_)(void *, Args...);
+    };
+
+} // namespace rvivl
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace rvivl {
+
+    inline constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+
+    // 64-bit FNV-1a. Results only depend on the bytes, so they are stable
+    // across runs and builds.
+    inline uint64_t fnv1a(const void *data, size_t size,
+                          uint64_t hash = FNV_OFFSET_BASIS) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Folds one integer, enum or Vulkan handle into hash. Values are
+    // widened to 64 bits first so struct padding never reaches the hash.
+    template <typename T> void hashCombine(uint64_t &hash, T value) {
+        uint64_t bits;
+        if constexpr (std::is_pointer_v<T>) {
+            bits = reinterpret_cast<uintptr_t>(value);
+        } else {
+            bits = static_cast<uint64_t>(value);
+        }
+        hash = fnv1a(&bits, sizeof(bits), hash);
+    }
+
+} // namespace rvivl
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace rvivl {
+
+    // Decoded pixels, always tightly packed 8-bit RGBA rows
+    struct DecodedImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    // Turns the bytes of an image file into pixels. Returns false if the
+    // data is not in a format the decoder understands or is damaged.
+    using ImageDecoder =
+        std::function<bool(std::span<const char> data, DecodedImage &image)>;
+
+    // Layout of a binary PPM or PGM file
+    struct PnmHeader {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t maxValue = 0;
+        // 3 for PPM, 1 for PGM, one byte each
+        uint32_t channels = 0;
+        // Where the pixel rows start
+        size_t dataOffset = 0;
+    };
+
+    // Parses the header at the start of data. Only needs the header bytes,
+    // so large files can be read a region at a time.
+    bool parsePnmHeader(std::span<const char> data, PnmHeader &header);
+
+    // Decodes binary PPM (P6) and PGM (P5) files with a maximum value of
+    // 255. Grey images are expanded to RGBA.
+    bool decodePnm(std::span<const char> data, DecodedImage &image);
+
+    // Number of levels of a full mip chain, down to 1x1
+    uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+} // namespace rvivl
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "rvivl/compute.hpp"
+#include "rvivl/memory_allocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    class Renderer;
+
+    enum class YuvLayout {
+        // Three planes: y, then u and v at half width and height
+        I420,
+        // Two planes: y, then u and v interleaved at half width and height
+        Nv12,
+    };
+
+    enum class YuvMatrix { Bt601, Bt709 };
+
+    enum class YuvRange {
+        // y in 16..235 and u, v in 16..240, as most video is encoded
+        Limited,
+        Full,
+    };
+
+    // An 8 bit 4:2:0 image in a storage buffer. Offsets and strides are in
+    // bytes; the chroma sample of a pixel is at
+    // uOffset + (y / 2) * chromaStride + (x / 2) * step, with step 1 for
+    // I420 and 2 for Nv12, and likewise from vOffset.
+    struct YuvFrame {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        YuvLayout layout = YuvLayout::I420;
+        YuvMatrix matrix = YuvMatrix::Bt709;
+        YuvRange range = YuvRange::Limited;
+
+        VkDeviceSize yOffset = 0;
+        VkDeviceSize uOffset = 0;
+        VkDeviceSize vOffset = 0;
+        uint32_t yStride = 0;
+        uint32_t chromaStride = 0;
+
+        // Planes stored back to back without padding, as decoders
+        // usually write them
+        static YuvFrame packed(VkBuffer buffer, uint32_t width,
+                               uint32_t height,
+                               YuvLayout layout = YuvLayout::I420);
+
+        // Bytes of a packed frame, rounded up to whole words since the
+        // shader reads the buffer as uints
+        static VkDeviceSize packedSize(uint32_t width, uint32_t height);
+    };
+
+    // Rows of the matrix that turns (y, u, v, 1), each sample scaled from
+    // 0..255 to 0..1, into non-linear RGB
+    std::array<float, 12> yuvToRgbMatrix(YuvMatrix matrix, YuvRange range);
+
+    enum class TonemapOperator {
+        // Exposure only, values above 1 clip
+        Clamp,
+        // Extended Reinhard, whitePoint maps to 1
+        Reinhard,
+        // Narkowicz's fit of the ACES filmic curve
+        Aces,
+    };
+
+    struct TonemapSettings {
+        // In stops, each doubles the brightness
+        float exposure = 0.0f;
+        float whitePoint = 4.0f;
+        TonemapOperator op = TonemapOperator::Reinhard;
+        // Writes sRGB encoded values into the UNORM output
+        bool encodeSrgb = false;
+    };
+
+    // An image the processor can write to and sample from
+    struct ProcessedImage {
+        Image image;
+        VkImageView view = VK_NULL_HANDLE;
+        VkExtent2D extent{};
+        VkFormat format = VK_FORMAT_UNDEFINED;
+    };
+
+    struct ImageProcessorCreateInfo {
+        // Must outlive the processor
+        Renderer *renderer = nullptr;
+    };
+
+    // Pixel format conversion, resizing and tonemapping as compute
+    // dispatches, so frames never make a round trip through the CPU. Every
+    // call only records into commandBuffer, which is either the frame's
+    // outside a render pass or one from Renderer::beginAsyncCompute(); the
+    // caller puts the barriers between the passes, see imageBarrier().
+    // Outputs are rgba8 storage images in GENERAL and inputs are read
+    // with texelFetch, so any sampled format works as a source. Belongs to
+    // the render thread.
+    class ImageProcessor {
+    public:
+        explicit ImageProcessor(const ImageProcessorCreateInfo &createInfo);
+        ~ImageProcessor();
+
+        ImageProcessor(const ImageProcessor &) = delete;
+        ImageProcessor &operator=(const ImageProcessor &) = delete;
+
+        // Converts frame into the top left frame.width x frame.height
+        // pixels of output
+        void convertYuv(VkCommandBuffer commandBuffer, const YuvFrame &frame,
+                        VkImageView output);
+
+        // Resamples source into output, averaging every source texel an
+        // output pixel covers by its area. For shrinking; enlarging
+        // repeats texels.
+        void downscale(VkCommandBuffer commandBuffer, VkImageView source,
+                       VkExtent2D sourceExtent, VkImageView output,
+                       VkExtent2D outputExtent, bool encodeSrgb = false,
+                       VkImageLayout sourceLayout = VK_IMAGE_LAYOUT_GENERAL);
+
+        void tonemap(VkCommandBuffer commandBuffer, VkImageView source,
+                     VkImageView output, VkExtent2D extent,
+                     const TonemapSettings &settings,
+                     VkImageLayout sourceLayout = VK_IMAGE_LAYOUT_GENERAL);
+
+        // Device local, usable as storage, sampled and copy source, and
+        // still in UNDEFINED. Shared by the graphics and compute families,
+        // so it may be written through Renderer::beginAsyncCompute().
+        ProcessedImage createImage(VkExtent2D extent,
+                                   VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+        // The image must no longer be in use by the GPU
+        void destroyImage(ProcessedImage &image);
+
+    private:
+        void destroy();
+
+        Renderer *renderer_;
+        VkDevice device_;
+        VkSampler sampler_ = VK_NULL_HANDLE;
+        std::unique_ptr<ComputePipeline> yuvToRgb_;
+        std::unique_ptr<ComputePipeline> downscale_;
+        std::unique_ptr<ComputePipeline> tonemap_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rvivl/function_ref.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rvivl {
+
+    // Fixed pool of worker threads that run batches of indexed jobs. The
+    // calling thread takes part in every batch as worker 0, so a pool of
+    // one thread runs everything inline.
+    class JobSystem {
+    public:
+        // threadCount includes the calling thread, 0 uses one per core
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        // Runs job(index, worker) for every index below jobCount and
+        // returns once all of them have finished. Jobs are handed out in
+        // order to whichever worker is free. The first exception thrown by
+        // a job is rethrown here after the rest of the batch has run.
+        void run(uint32_t jobCount,
+                 FunctionRef<void(uint32_t index, uint32_t worker)> job);
+
+        uint32_t threadCount() const {
+            return static_cast<uint32_t>(workers_.size()) + 1;
+        }
+
+    private:
+        using Job = FunctionRef<void(uint32_t, uint32_t)>;
+
+        void workerLoop(uint32_t worker);
+        void execute(uint32_t worker);
+        void stop();
+
+        std::vector<std::thread> workers_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        bool stopping_ = false;
+        uint64_t generation_ = 0;
+        uint32_t busyWorkers_ = 0;
+
+        // The current batch, published under mutex_ before waking workers
+        const Job *job_ = nullptr;
+        uint32_t jobCount_ = 0;
+        std::atomic<uint32_t> nextIndex_{0};
+        std::exception_ptr error_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Buffers and linear images may not share a bufferImageGranularity page
+    // with optimally tiled images
+    enum class ResourceKind { Linear, Optimal };
+
+    // Offset bookkeeping for one VkDeviceMemory block. Ranges are kept in
+    // address order with free neighbours always merged, and free ranges are
+    // additionally indexed by size for best-fit lookup.
+    class MemoryBlockMetadata {
+    public:
+        MemoryBlockMetadata(VkDeviceSize size, VkDeviceSize granularity);
+
+        // Finds room for size bytes at the given alignment. Returns false if
+        // the block has no suitable free range.
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment,
+                      ResourceKind kind, VkDeviceSize &offset);
+        void free(VkDeviceSize offset);
+
+        VkDeviceSize size() const { return size_; }
+        VkDeviceSize bytesInUse() const { return bytesInUse_; }
+        VkDeviceSize largestFreeRange() const;
+        uint32_t allocationCount() const { return allocationCount_; }
+        uint32_t freeRangeCount() const {
+            return static_cast<uint32_t>(freeBySize_.size());
+        }
+        bool empty() const { return allocationCount_ == 0; }
+
+    private:
+        struct Range {
+            VkDeviceSize size;
+            ResourceKind kind;
+            bool free;
+        };
+
+        void insertFree(VkDeviceSize offset, VkDeviceSize size);
+        void eraseFree(VkDeviceSize offset, VkDeviceSize size);
+
+        VkDeviceSize size_;
+        VkDeviceSize granularity_;
+        VkDeviceSize bytesInUse_ = 0;
+        uint32_t allocationCount_ = 0;
+        std::map<VkDeviceSize, Range> ranges_;
+        std::multimap<VkDeviceSize, VkDeviceSize> freeBySize_;
+    };
+
+    struct MemoryBlock;
+
+    // A sub-range of a larger VkDeviceMemory block
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Persistent mapping of the range, null unless host visible
+        void *mapped = nullptr;
+        MemoryBlock *block = nullptr;
+    };
+
+    // A buffer together with the memory range backing it
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        VkDeviceSize size = 0;
+    };
+
+    // An image together with the memory range backing it
+    struct Image {
+        VkImage image = VK_NULL_HANDLE;
+        Allocation allocation;
+    };
+
+    struct AllocatorStats {
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize bytesReserved = 0;
+        VkDeviceSize bytesInUse = 0;
+        VkDeviceSize largestFreeRange = 0;
+        // 0 when all free memory is one contiguous range, approaching 1 as
+        // it is split into many small ranges
+        float fragmentation = 0.0f;
+    };
+
+    // Reserves large VkDeviceMemory blocks per memory type and hands out
+    // sub-ranges of them, so the number of live vkAllocateMemory calls stays
+    // far below maxMemoryAllocationCount. Host visible blocks are mapped once
+    // for their whole lifetime.
+    class MemoryAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+        MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device,
+                        VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+        Allocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties,
+                            ResourceKind kind);
+        void free(Allocation &allocation);
+
+        Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                            VkMemoryPropertyFlags properties);
+        Buffer createBuffer(const VkBufferCreateInfo &bufferInfo,
+                            VkMemoryPropertyFlags properties);
+        void destroyBuffer(Buffer &buffer);
+
+        Image createImage(const VkImageCreateInfo &imageInfo,
+                          VkMemoryPropertyFlags properties);
+        void destroyImage(Image &image);
+
+        uint32_t findMemoryType(uint32_t typeFilter,
+                                VkMemoryPropertyFlags properties) const;
+
+        AllocatorStats stats() const;
+
+    private:
+        MemoryBlock *createBlock(uint32_t memoryType, VkDeviceSize size,
+                                 bool dedicated);
+        void destroyBlock(MemoryBlock *block);
+        VkDeviceSize preferredBlockSize(uint32_t memoryType) const;
+
+        VkDevice device_;
+        VkDeviceSize blockSize_;
+        VkDeviceSize bufferImageGranularity_;
+        uint32_t maxAllocationCount_;
+        VkPhysicalDeviceMemoryProperties memoryProperties_{};
+
+        mutable std::mutex mutex_;
+        std::array<std::vector<std::unique_ptr<MemoryBlock>>,
+                   VK_MAX_MEMORY_TYPES>
+            blocks_;
+        uint32_t deviceMemoryCount_ = 0;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Identifies the device and driver that produced a pipeline cache. Data
+    // is only reused when every field matches.
+    struct PipelineCacheKey {
+        uint32_t vendorID = 0;
+        uint32_t deviceID = 0;
+        uint32_t driverVersion = 0;
+        std::array<uint8_t, VK_UUID_SIZE> pipelineCacheUUID{};
+        std::array<uint8_t, VK_UUID_SIZE> driverUUID{};
+
+        static PipelineCacheKey query(VkPhysicalDevice physicalDevice);
+
+        bool operator==(const PipelineCacheKey &) const = default;
+    };
+
+    // Wraps driver cache data in a versioned header carrying the key and a
+    // checksum of the data
+    std::vector<char> encodePipelineCacheFile(const PipelineCacheKey &key,
+                                              const std::vector<char> &data);
+
+    // Extracts the driver cache data from a file written by
+    // encodePipelineCacheFile(). Returns false if the file has another
+    // format version or key, or is truncated or corrupted.
+    bool decodePipelineCacheFile(const PipelineCacheKey &key,
+                                 const std::vector<char> &file,
+                                 std::vector<char> &data);
+
+    // A VkPipelineCache that is loaded from and saved to a file, so
+    // pipelines compiled in one run are not compiled again in the next.
+    // Stale or damaged files are ignored and replaced on the next save.
+    class PipelineCache {
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        // An empty path keeps the cache in memory only
+        PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device,
+                      std::string path);
+        ~PipelineCache();
+
+        PipelineCache(const PipelineCache &) = delete;
+        PipelineCache &operator=(const PipelineCache &) = delete;
+
+        // Writes the current contents to the file, replacing it atomically
+        void save() const;
+
+        VkPipelineCache handle() const { return cache_; }
+        const std::string &path() const { return path_; }
+
+        // Whether usable data for this device was found on disk
+        bool loaded() const { return loaded_; }
+
+    private:
+        VkDevice device_;
+        std::string path_;
+        PipelineCacheKey key_;
+        VkPipelineCache cache_ = VK_NULL_HANDLE;
+        bool loaded_ = false;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Everything that distinguishes one graphics pipeline from another.
+    // Viewport and scissor are dynamic state and not part of it.
+    struct PipelineDesc {
+        VkShaderModule vertexShader = VK_NULL_HANDLE;
+        VkShaderModule fragmentShader = VK_NULL_HANDLE;
+
+        std::vector<VkVertexInputBindingDescription> vertexBindings;
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        bool blendEnable = false;
+        VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+        VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+        VkColorComponentFlags colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+        // Attachment format for dynamic rendering, used when renderPass is
+        // VK_NULL_HANDLE
+        VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+
+        // Hashes every field, handles included, for the registry's map.
+        // Handle values differ between runs; PipelineRegistry::stableHash()
+        // is the one to keep across them.
+        uint64_t hash() const;
+        // Hashes every field but the handles, of which only whether
+        // renderPass is set counts. The attachment format is colorFormat
+        // either way.
+        uint64_t stateHash() const;
+
+        bool operator==(const PipelineDesc &other) const;
+    };
+
+    struct PipelineDescHash {
+        size_t operator()(const PipelineDesc &desc) const {
+            return static_cast<size_t>(desc.hash());
+        }
+    };
+
+    // Creates each distinct graphics pipeline once and hands out the same
+    // VkPipeline for every identical PipelineDesc. Pipelines are created on
+    // first use, or ahead of time on a background thread through
+    // prefetch(). Shader modules are deduplicated by their SPIR-V.
+    class PipelineRegistry {
+    public:
+        PipelineRegistry(VkDevice device, VkPipelineCache pipelineCache);
+        ~PipelineRegistry();
+
+        PipelineRegistry(const PipelineRegistry &) = delete;
+        PipelineRegistry &operator=(const PipelineRegistry &) = delete;
+
+        // Returns the pipeline for desc, creating it now if needed or
+        // waiting for it if the background thread is already on it
+        VkPipeline get(const PipelineDesc &desc);
+
+        // Returns the pipeline for desc if it is ready, VK_NULL_HANDLE
+        // otherwise. Never blocks on pipeline creation.
+        VkPipeline tryGet(const PipelineDesc &desc);
+
+        // Queues desc for creation on the background thread if it is new
+        void prefetch(const PipelineDesc &desc);
+
+        // Returns a module for code, shared with every earlier call that
+        // passed the same SPIR-V. code is only read during the call.
+        VkShaderModule shaderModule(std::span<const uint32_t> code);
+
+        // Hash of desc that is the same across runs and builds: its
+        // stateHash() with the SPIR-V of its shaders in place of the
+        // module handles. The pipeline layout is left out, as only the
+        // caller knows what went into it. Throws if a shader module did not
+        // come from shaderModule().
+        uint64_t stableHash(const PipelineDesc &desc) const;
+
+        // Distinct descriptions seen so far, ready or not
+        size_t pipelineCount() const;
+
+    private:
+        enum class State { Queued, Creating, Ready, Failed };
+
+        struct Entry {
+            // Points at the map key, which never moves
+            const PipelineDesc *desc = nullptr;
+            State state = State::Queued;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+        };
+
+        VkPipeline createPipeline(const PipelineDesc &desc) const;
+        void compileLoop();
+
+        VkDevice device_;
+        VkPipelineCache pipelineCache_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable stateChanged_;
+        std::condition_variable queueChanged_;
+        std::unordered_map<PipelineDesc, std::unique_ptr<Entry>,
+                           PipelineDescHash>
+            entries_;
+        std::deque<Entry *> queue_;
+        bool stopping_ = false;
+        std::thread compiler_;
+
+        // Looked up by a view of the SPIR-V, so only new code is copied
+        struct CodeHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view code) const {
+                return std::hash<std::string_view>()(code);
+            }
+        };
+
+        mutable std::mutex shaderMutex_;
+        std::unordered_map<std::string, VkShaderModule, CodeHash,
+                           std::equal_to<>>
+            shaderModules_;
+        // FNV-1a of each module's SPIR-V, for stableHash()
+        std::unordered_map<VkShaderModule, uint64_t> codeHashes_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    enum class ProfileTrack : uint32_t {
+        Cpu,
+        Gpu,
+    };
+
+    // A finished scope. Times are nanoseconds since the profiler was
+    // created; GPU scopes are moved onto the same clock, see Profiler.
+    struct ProfileEvent {
+        // Not copied, so it must outlive the profiler, e.g. a literal
+        const char *name = nullptr;
+        ProfileTrack track = ProfileTrack::Cpu;
+        // Small per-thread number for CPU scopes, 0 for GPU scopes
+        uint32_t thread = 0;
+        // Renderer submission the scope belongs to, 0 if none
+        uint64_t frame = 0;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    struct ProfilerCreateInfo {
+        // Without a device, or when the queue family has no timestamps, GPU
+        // scopes are ignored and only CPU scopes are recorded
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+
+        // One set of queries per frame in flight
+        uint32_t frameCount = 2;
+        // GPU scopes per frame, further scopes are dropped
+        uint32_t maxGpuScopes = 64;
+
+        // Finished scopes kept for export, the oldest are overwritten
+        uint32_t maxEvents = 1u << 16;
+
+        // A disabled profiler ignores every scope
+        bool enabled = true;
+    };
+
+    // Times named scopes on the CPU and, through timestamp queries, in
+    // command buffers. Every frame slot has its own range of a query pool
+    // that is read back by the next beginFrame() of the slot, after its
+    // frame has completed, so nothing waits for the GPU. Events go to a
+    // fixed ring and can be written out as Chrome trace JSON, which
+    // chrome://tracing and Perfetto open.
+    //
+    // GPU timestamps are moved onto the CPU clock through the submit time
+    // of each frame: GPU work cannot start before its submit, so the
+    // largest submit time minus first timestamp seen so far is the
+    // tightest offset. Thread safe apart from the frame and GPU scope
+    // calls, which belong to the render thread.
+    class Profiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr uint32_t NO_SCOPE = UINT32_MAX;
+
+        explicit Profiler(const ProfilerCreateInfo &createInfo);
+        ~Profiler();
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        // Starts GPU scopes of the frame numbered serial in the slot
+        // frameIndex. The slot's previous frame must have completed. Records
+        // the query reset, so commandBuffer must be outside a render pass.
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                        uint64_t serial);
+        // Call right after the frame was submitted
+        void endFrame();
+
+        // Returns NO_SCOPE when GPU scopes are off or the frame has no
+        // queries left; endGpuScope() ignores that
+        uint32_t beginGpuScope(VkCommandBuffer commandBuffer,
+                               const char *name);
+        void endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        // Records a CPU scope that already finished
+        void addCpuScope(const char *name, Clock::time_point begin,
+                         Clock::time_point end);
+        void addEvent(const ProfileEvent &event);
+
+        // Recorded events, oldest first
+        std::vector<ProfileEvent> events() const;
+        void clear();
+
+        // GPU time of the most recently read back frame, from its first
+        // timestamp to its last, 0 until one has been read
+        std::chrono::nanoseconds lastGpuFrameTime() const;
+        // Serial of the frame lastGpuFrameTime() belongs to
+        uint64_t lastGpuFrame() const { return lastGpuFrame_; }
+
+        void writeChromeTrace(std::ostream &out) const;
+        // Throws if the file cannot be written
+        void saveChromeTrace(const std::string &path) const;
+
+        bool enabled() const { return enabled_; }
+        bool gpuTimestamps() const { return queryPool_ != VK_NULL_HANDLE; }
+        uint64_t now() const;
+
+    private:
+        struct GpuScope {
+            const char *name = nullptr;
+            bool ended = false;
+        };
+
+        struct FrameQueries {
+            uint64_t serial = 0;
+            // Nanoseconds since start_ at submit
+            uint64_t submitted = 0;
+            std::vector<GpuScope> scopes;
+            uint32_t scopeCount = 0;
+        };
+
+        void readFrame(FrameQueries &frame, uint32_t frameIndex);
+        void destroy();
+
+        bool enabled_;
+        Clock::time_point start_;
+        VkDevice device_ = VK_NULL_HANDLE;
+        VkQueryPool queryPool_ = VK_NULL_HANDLE;
+        double timestampPeriod_ = 1.0;
+        uint64_t timestampMask_ = UINT64_MAX;
+        uint32_t maxGpuScopes_;
+        // Nanoseconds to add to a GPU timestamp, see the class comment
+        int64_t gpuOffset_ = INT64_MIN;
+        uint64_t lastGpuFrameTime_ = 0;
+        uint64_t lastGpuFrame_ = 0;
+
+        std::vector<FrameQueries> frames_;
+        uint32_t frameIndex_ = UINT32_MAX;
+        std::vector<uint64_t> timestamps_;
+
+        mutable std::mutex mutex_;
+        std::vector<ProfileEvent> events_;
+        size_t eventHead_ = 0;
+        size_t eventCount_ = 0;
+    };
+
+    // Times its own lifetime as a CPU scope
+    class CpuScope {
+    public:
+        CpuScope(Profiler &profiler, const char *name)
+            : profiler_(profiler), name_(name),
+              begin_(profiler.enabled() ? Profiler::Clock::now()
+                                        : Profiler::Clock::time_point{}) {}
+        ~CpuScope() {
+            if (profiler_.enabled()) {
+                profiler_.addCpuScope(name_, begin_, Profiler::Clock::now());
+            }
+        }
+
+        CpuScope(const CpuScope &) = delete;
+        CpuScope &operator=(const CpuScope &) = delete;
+
+    private:
+        Profiler &profiler_;
+        const char *name_;
+        Profiler::Clock::time_point begin_;
+    };
+
+    // Brackets the commands recorded during its lifetime with timestamps
+    class GpuScope {
+    public:
+        GpuScope(Profiler &profiler, VkCommandBuffer commandBuffer,
+                 const char *name)
+            : profiler_(profiler), commandBuffer_(commandBuffer),
+              scope_(profiler.beginGpuScope(commandBuffer, name)) {}
+        ~GpuScope() { profiler_.endGpuScope(commandBuffer_, scope_); }
+
+        GpuScope(const GpuScope &) = delete;
+        GpuScope &operator=(const GpuScope &) = delete;
+
+    private:
+        Profiler &profiler_;
+        VkCommandBuffer commandBuffer_;
+        uint32_t scope_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "rvivl/memory_allocator.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    class Renderer;
+
+    // How a pass uses an image. Each usage implies the stages, accesses and
+    // layout the graph synchronizes against.
+    enum class ImageUsage {
+        // Contents are not needed, e.g. the state of a new image
+        None,
+        // Written as a color attachment, overwriting what was there
+        ColorAttachment,
+        SampledFragment,
+        SampledCompute,
+        // Storage image reads and writes in a compute shader. A pass that
+        // declares both keeps the previous contents.
+        StorageRead,
+        StorageWrite,
+        TransferSrc,
+        TransferDst,
+        // Handed to vkQueuePresentKHR after the graph
+        Present,
+    };
+
+    struct ImageUsageInfo {
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Flags a transient image needs for the usage
+        VkImageUsageFlags imageUsage = 0;
+        bool write = false;
+    };
+
+    ImageUsageInfo imageUsageInfo(ImageUsage usage);
+
+    // vkCmdPipelineBarrier flags for the subset of synchronization2 flags
+    // the graph produces, for devices without synchronization2
+    VkPipelineStageFlags legacyStages(VkPipelineStageFlags2 stages);
+    VkAccessFlags legacyAccess(VkAccessFlags2 access);
+
+    // Index of an image declared in a RenderGraph
+    using RenderGraphImage = uint32_t;
+
+    struct ImageAccess {
+        RenderGraphImage image = 0;
+        ImageUsage usage = ImageUsage::None;
+    };
+
+    struct RenderGraphBarrier {
+        RenderGraphImage image = 0;
+        VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 dstStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 dstAccess = VK_ACCESS_2_NONE;
+        VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    // The graph as it will be recorded: the passes that survived culling
+    // in declaration order, each with the batch of barriers recorded
+    // ahead of it
+    struct CompiledRenderGraph {
+        static constexpr uint32_t UNUSED = UINT32_MAX;
+
+        struct Pass {
+            uint32_t pass = 0;
+            uint32_t firstBarrier = 0;
+            uint32_t barrierCount = 0;
+        };
+
+        struct Lifetime {
+            // Indices into passes, UNUSED for images no live pass touches
+            uint32_t first = UNUSED;
+            uint32_t last = UNUSED;
+            // Union of the usages of the live passes
+            VkImageUsageFlags imageUsage = 0;
+            // Barrier ahead of the first use, UNUSED if there is none
+            uint32_t firstBarrier = UNUSED;
+            // Stages and writes of all its accesses, which an image
+            // aliasing its memory next has to wait for
+            VkPipelineStageFlags2 accessStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        };
+
+        std::vector<Pass> passes;
+        std::vector<RenderGraphBarrier> barriers;
+        // Batch moving imported images into their final usage
+        uint32_t finalBarrier = 0;
+        uint32_t finalBarrierCount = 0;
+        // One per declared image
+        std::vector<Lifetime> lifetimes;
+    };
+
+    struct TransientImageLifetime {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        VkMemoryRequirements requirements{};
+    };
+
+    // Which memory slot each transient image is bound to. Images whose
+    // lifetimes do not overlap share a slot, which is as large as the
+    // largest of them.
+    struct AliasPlan {
+        static constexpr uint32_t NO_IMAGE = UINT32_MAX;
+
+        // Per image
+        std::vector<uint32_t> slot;
+        // Image that used the slot before, NO_IMAGE for the first one
+        std::vector<uint32_t> previous;
+        // Per slot
+        std::vector<VkMemoryRequirements> slots;
+    };
+
+    // Packs the largest images first, each into the first slot it fits
+    // beside in time and memory type
+    AliasPlan planAliasing(std::span<const TransientImageLifetime> images);
+
+    struct RenderGraphStats {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t barrierBatches = 0;
+        uint32_t imageBarriers = 0;
+        uint32_t transientImages = 0;
+        uint32_t memorySlots = 0;
+        // Bytes bound to transient images, and bytes they would take
+        // without aliasing
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize unaliasedBytes = 0;
+    };
+
+    struct RenderGraphCreateInfo {
+        // Must outlive the graph. Only execute() uses it, so a graph
+        // without one can still be compiled.
+        Renderer *renderer = nullptr;
+    };
+
+    // A frame's passes outside the render pass, declared with the images
+    // they read and write and recorded by execute(), which works out
+    // everything in between:
+    // - passes whose results nothing reads are culled,
+    // - the barriers in front of each pass go out as one
+    //   vkCmdPipelineBarrier2 batch, and only where there is a hazard or a
+    //   layout change,
+    // - transient images are created by the graph and share memory with
+    //   others whose lifetimes do not overlap.
+    // The physical images are kept while the declarations stay the same
+    // from frame to frame. Declarations are cleared by execute(), so the
+    // graph is rebuilt every frame. Belongs to the render thread.
+    class RenderGraph {
+    public:
+        using Record = std::function<void(VkCommandBuffer commandBuffer,
+                                          const RenderGraph &graph)>;
+
+        explicit RenderGraph(const RenderGraphCreateInfo &createInfo);
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+
+        // A color image that lives for the graph's execution, with usage
+        // flags from its accesses
+        RenderGraphImage createImage(std::string name, VkExtent2D extent,
+                                     VkFormat format);
+
+        // An image owned elsewhere. before is how it was last used, after
+        // how it will be used next, and the graph leaves it ready for
+        // that. Writes to imported images are never culled.
+        RenderGraphImage importImage(std::string name, VkImage image,
+                                     VkImageView view, VkExtent2D extent,
+                                     ImageUsage before, ImageUsage after);
+
+        // Passes with side effects, e.g. copies into host memory, are
+        // never culled. Accesses of one image in a pass must agree on the
+        // layout.
+        void addPass(std::string name, std::span<const ImageAccess> accesses,
+                     Record record, bool sideEffects = false);
+
+        // Culls the passes and places the barriers. Only reads the
+        // declarations.
+        CompiledRenderGraph compile() const;
+
+        // Compiles and records the graph into commandBuffer, then clears
+        // the declarations
+        void execute(VkCommandBuffer commandBuffer);
+
+        // Valid inside the Record callbacks
+        VkImage image(RenderGraphImage image) const;
+        VkImageView view(RenderGraphImage image) const;
+        VkExtent2D extent(RenderGraphImage image) const;
+
+        // Of the last execute()
+        const RenderGraphStats &stats() const { return stats_; }
+
+    private:
+        struct ImageDecl {
+            std::string name;
+            VkExtent2D extent{};
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            bool imported = false;
+            ImageUsage before = ImageUsage::None;
+            ImageUsage after = ImageUsage::None;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+        };
+
+        struct PassDecl {
+            std::string name;
+            std::vector<ImageAccess> accesses;
+            Record record;
+            bool sideEffects = false;
+        };
+
+        // What a set of transient images was created from, compared to
+        // reuse them in the next frame
+        struct TransientKey {
+            VkExtent2D extent;
+            VkFormat format;
+            VkImageUsageFlags usage;
+            uint32_t first;
+            uint32_t last;
+
+            bool operator==(const TransientKey &other) const {
+                return extent.width == other.extent.width &&
+                       extent.height == other.extent.height &&
+                       format == other.format && usage == other.usage &&
+                       first == other.first && last == other.last;
+            }
+        };
+
+        // Transient images and the memory behind them
+        struct Physical {
+            std::vector<TransientKey> keys;
+            std::vector<VkImage> images;
+            std::vector<VkImageView> views;
+            std::vector<Allocation> memory;
+            AliasPlan plan;
+            // Accesses of each slot's last image in the previous
+            // execution, which its first image waits for
+            std::vector<VkPipelineStageFlags2> slotStages;
+            std::vector<VkAccessFlags2> slotAccess;
+            VkDeviceSize unaliasedBytes = 0;
+            // Submission that used them last
+            uint64_t serial = 0;
+        };
+
+        // Creates or reuses the transient images and makes the first use of
+        // each wait for whatever used its memory before
+        void realize(CompiledRenderGraph &compiled);
+        void recordBarriers(VkCommandBuffer commandBuffer,
+                            std::span<const RenderGraphBarrier> barriers);
+        void destroyPhysical(Physical &physical);
+        void releaseRetired();
+        void destroy();
+
+        Renderer *renderer_;
+        VkDevice device_ = VK_NULL_HANDLE;
+
+        std::vector<ImageDecl> images_;
+        std::vector<PassDecl> passes_;
+
+        Physical physical_;
+        // Declared images that map to physical_, in declaration order
+        std::vector<uint32_t> transientIndex_;
+        std::vector<Physical> retired_;
+
+        RenderGraphStats stats_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,430 @@
+#pragma once
+
+#include "rvivl/descriptor_heap.hpp"
+#include "rvivl/frame_pacing.hpp"
+#include "rvivl/frame_ring.hpp"
+#include "rvivl/function_ref.hpp"
+#include "rvivl/job_system.hpp"
+#include "rvivl/memory_allocator.hpp"
+#include "rvivl/pipeline_cache.hpp"
+#include "rvivl/pipeline_registry.hpp"
+#include "rvivl/profiler.hpp"
+#include "rvivl/upload_queue.hpp"
+#include "rvivl/vertex.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    struct RendererCreateInfo {
+        const char *applicationName = "rvivl";
+
+        // Render into a ring of offscreen images instead of a swapchain. No
+        // surface or window system is needed, so this also works on CPU-only
+        // drivers such as lavapipe.
+        bool headless = false;
+
+        // Size and format of the offscreen images in headless mode
+        VkExtent2D extent = {800, 600};
+        VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+        // Copy every headless frame into host memory for readback()
+        bool enableReadback = false;
+
+        // Instance extensions required by the windowing system
+        std::vector<const char *> instanceExtensions;
+
+        // Creates the presentation surface once the instance exists
+        std::function<VkSurfaceKHR(VkInstance)> createSurface;
+
+        // Returns the current drawable size of the window in pixels
+        std::function<VkExtent2D()> drawableExtent;
+
+        // SPIR-V for the default pipeline, e.g. embeddedShader() or
+        // Asset::words() of a mapped file. Shader code is only read while
+        // the renderer is created.
+        std::span<const uint32_t> vertexShaderCode;
+        std::span<const uint32_t> fragmentShaderCode;
+
+        // Vertex layout of the default pipeline, e.g.
+        // VertexInput::of<HalfVertex>() for compact vertices
+        VertexInput vertexInput = VertexInput::of<Vertex>();
+
+        // Optional SPIR-V of shaders/instanced.vert. Adds an instanced
+        // variant of the default pipeline that also reads Instance data
+        // from binding 1.
+        std::span<const uint32_t> instancedVertexShaderCode;
+
+        // File the pipeline cache is loaded from at startup and saved to at
+        // shutdown. Empty keeps the cache in memory only.
+        std::string pipelineCachePath;
+
+        VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+        // Size of the persistently mapped ring that uploads are staged in
+        VkDeviceSize stagingSize = 16ull << 20;
+
+        // Bytes of Renderer::frameArena() per frame in flight
+        VkDeviceSize frameArenaSize = 4ull << 20;
+
+        // Render with vkCmdBeginRendering instead of a render pass and
+        // per-image framebuffers. Needs Vulkan 1.3 or
+        // VK_KHR_dynamic_rendering and falls back to the render pass
+        // otherwise, see Renderer::dynamicRendering().
+        bool dynamicRendering = false;
+
+        // Frames in flight, swapchain size and present mode. Headless
+        // renderers only use the frames in flight.
+        PacingPolicy pacing;
+
+        // Threads used by recordParallel(), including the calling thread.
+        // 0 uses one per core.
+        uint32_t recordingThreads = 0;
+
+        // Time every frame on the GPU and the frame calls on the CPU into
+        // profiler(). Off, profiler() ignores every scope.
+        bool profiling = false;
+
+        // Keep sampled images and storage buffers in one bindless
+        // DescriptorHeap where the device supports descriptor indexing,
+        // see Renderer::descriptorHeap()
+        bool bindless = true;
+    };
+
+    // Owns the Vulkan instance, device, render target (a swapchain or a ring
+    // of offscreen images), default pipeline and per-frame synchronization.
+    // A frame is driven by calling beginFrame(), recording into
+    // commandBuffer(), then submit() and endFrame(). All per-frame state is
+    // created up front so the frame loop itself does not touch the heap.
+    class Renderer {
+    public:
+        // Slices smaller than this cost more to hand out than to record
+        static constexpr uint32_t MIN_DRAWS_PER_SLICE = 64;
+
+        explicit Renderer(const RendererCreateInfo &createInfo);
+        ~Renderer();
+
+        Renderer(const Renderer &) = delete;
+        Renderer &operator=(const Renderer &) = delete;
+
+        // Waits for the frame slot, acquires the next image and begins the
+        // render pass. An out of date swapchain is recreated first. Returns
+        // false if no image could be acquired, for example while the window
+        // is minimized. Pass
+        // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to draw through
+        // recordParallel() instead of commandBuffer().
+        bool beginFrame(
+            VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+        // Like beginFrame(contents), but calls beforeRendering with the
+        // frame's command buffer before the render pass begins, which is
+        // where compute dispatches and their barriers are recorded. They
+        // may read data uploaded this frame, which makes the frame wait for
+        // uploads at compute and transfer as well as vertex input.
+        bool beginFrame(
+            VkSubpassContents contents,
+            FunctionRef<void(VkCommandBuffer commandBuffer)> beforeRendering);
+
+        // Splits drawCount draws into slices and records each slice on a
+        // worker thread into a secondary command buffer, which is then
+        // executed in the frame's render pass in slice order. record is
+        // called with the command buffer and the first draw and draw count
+        // of its slice. Viewport and scissor are already set, but nothing
+        // else is inherited, so every slice binds its own pipeline and
+        // buffers.
+        void recordParallel(
+            uint32_t drawCount,
+            FunctionRef<void(VkCommandBuffer commandBuffer, uint32_t firstDraw,
+                             uint32_t drawCount)>
+                record);
+
+        // Begins recording compute work of the current frame into a
+        // command buffer of computeFamily(), at most once per frame
+        // between beginFrame() and submit(). Where the device has a
+        // compute family without graphics, the work runs on its own queue
+        // and overlaps the graphics work of the frames still in flight.
+        // Resources it shares with graphics must then be created for both
+        // families, as ImageProcessor::createImage() does.
+        VkCommandBuffer beginAsyncCompute();
+
+        // Submits the compute work after the uploads flushed so far. The
+        // frame's graphics submission waits for it at consumerStage.
+        // submit() calls this itself if the work is still being recorded.
+        void submitAsyncCompute(VkPipelineStageFlags consumerStage =
+                                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        // Ends the render pass and submits the recorded command buffer.
+        // Pending uploads are flushed first and the frame waits for them on
+        // the GPU before vertex input.
+        void submit();
+
+        // Presents the submitted image and advances to the next frame slot.
+        // damage lists the pixels that changed since the last present, at
+        // most DamageRegion::MAX_RECTS rectangles, and empty means all of
+        // them. The image must still be rendered in full; the damage is only
+        // a hint, passed on where VK_KHR_incremental_present is supported.
+        void endFrame(std::span<const VkRect2D> damage = {});
+
+        // Marks the swapchain out of date after the window changed size, so
+        // the next beginFrame() recreates it. Out of date and suboptimal
+        // results from acquire and present do the same, but not every
+        // platform reports them on resize.
+        void resize() { swapchainDirty_ = true; }
+
+        // Records an input event for latency(). Call it when input is read,
+        // the next frame to begin is the one that reacts to it.
+        void markInput(LatencyTracker::Clock::time_point when =
+                           LatencyTracker::Clock::now()) {
+            latency_.input(when);
+        }
+
+        // CPU time from markInput() to the return of the present of the
+        // frame reacting to it, over the most recent frames
+        LatencyStats latency() const { return latency_.stats(); }
+
+        // Copies the pixels of the most recently submitted headless frame
+        // into pixels, which must hold width * height * 4 bytes. Only waits
+        // for that frame, not for the whole device.
+        void readback(void *pixels);
+
+        // Command buffer of the frame between beginFrame() and submit()
+        VkCommandBuffer commandBuffer() const;
+
+        void waitIdle() const;
+
+        // Buffers are sub-allocated from the renderer's MemoryAllocator;
+        // host visible ones come back persistently mapped
+        Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                            VkMemoryPropertyFlags properties);
+        void destroyBuffer(Buffer &buffer);
+
+        MemoryAllocator &allocator() { return *allocator_; }
+        PipelineCache &pipelineCache() { return *pipelineCache_; }
+        PipelineRegistry &pipelines() { return *pipelines_; }
+        // Add GpuScope and CpuScope of your own between beginFrame() and
+        // submit()
+        Profiler &profiler() { return *profiler_; }
+        // nullptr without bindless or descriptor indexing, in which case
+        // descriptor sets come from frameDescriptors()
+        DescriptorHeap *descriptorHeap() { return descriptorHeap_.get(); }
+        // Sets valid until the current frame slot comes round again
+        FrameDescriptorAllocator &frameDescriptors() {
+            return *frameDescriptors_;
+        }
+        // Transient vertices, indices, uniforms and storage data of the
+        // current frame, rewound by beginFrame() once the frame slot's
+        // previous use has completed
+        FrameRing &frameArena() { return *frameArena_; }
+
+        // Writes the pipeline cache to disk now rather than at shutdown
+        void savePipelineCache() const { pipelineCache_->save(); }
+        JobSystem &jobs() { return *jobs_; }
+
+        // Staging path into DEVICE_LOCAL memory, on a dedicated transfer
+        // queue when the device has one
+        UploadQueue &uploadQueue() { return *uploadQueue_; }
+
+        VkInstance instance() const { return instance_; }
+        VkPhysicalDevice physicalDevice() const { return physicalDevice_; }
+        VkDevice device() const { return device_; }
+        VkQueue graphicsQueue() const { return graphicsQueue_; }
+        // Core features the device was created with
+        const VkPhysicalDeviceFeatures &enabledFeatures() const {
+            return enabledFeatures_;
+        }
+        uint32_t graphicsFamily() const { return graphicsFamily_; }
+        uint32_t transferFamily() const { return transferFamily_; }
+        // The graphics family where the device has no compute-only one
+        uint32_t computeFamily() const { return computeFamily_; }
+        VkQueue computeQueue() const { return computeQueue_; }
+        bool asyncCompute() const { return computeFamily_ != graphicsFamily_; }
+        // VK_NULL_HANDLE with dynamic rendering
+        VkRenderPass renderPass() const { return renderPass_; }
+        VkPipeline pipeline() const { return pipeline_; }
+        // VK_NULL_HANDLE without instancedVertexShaderCode
+        VkPipeline instancedPipeline() const { return instancedPipeline_; }
+        // Description of the default pipeline, a starting point for
+        // variants looked up through pipelines()
+        const PipelineDesc &pipelineDesc() const { return pipelineDesc_; }
+        VkPipelineLayout pipelineLayout() const { return pipelineLayout_; }
+        VkExtent2D extent() const { return extent_; }
+        VkFormat colorFormat() const { return colorFormat_; }
+        uint32_t frameIndex() const { return currentFrame_; }
+        uint32_t framesInFlight() const { return framesInFlight_; }
+        // Frame submissions are numbered from 1. Whatever a frame used may
+        // be destroyed once completedSerial() has reached its number.
+        uint64_t submittedSerial() const { return submitSerial_; }
+        uint64_t completedSerial() const { return completedSerial_; }
+        // Reaches a frame's serial once its graphics work has completed
+        VkSemaphore frameTimeline() const { return frameTimeline_; }
+        // Reaches computeSerial() once the last async compute submission
+        // has completed
+        VkSemaphore computeTimeline() const { return computeTimeline_; }
+        uint64_t computeSerial() const { return computeSerial_; }
+        // Meaningless when headless
+        VkPresentModeKHR presentMode() const { return presentMode_; }
+        bool headless() const { return headless_; }
+        bool dynamicRendering() const { return dynamicRendering_; }
+        // Whether endFrame() hands damage to the presentation engine
+        bool incrementalPresent() const { return incrementalPresent_; }
+        // vkCmdPipelineBarrier2 or its KHR alias, nullptr where the device
+        // lacks synchronization2
+        PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2() const {
+            return cmdPipelineBarrier2_;
+        }
+
+    private:
+        // Secondary command buffers of one recording thread for one frame
+        // slot. The pool is reset as a whole once the slot's frame has
+        // completed.
+        struct WorkerCommands {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> commandBuffers;
+            uint32_t used = 0;
+        };
+
+        struct FrameData {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            // From the compute family, see beginAsyncCompute()
+            VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+            // Signalled by acquire, VK_NULL_HANDLE when headless
+            VkSemaphore imageAvailable = VK_NULL_HANDLE;
+            // Value of frameTimeline_ the slot's last submission signals, 0
+            // before the first one
+            uint64_t serial = 0;
+            Buffer readback;
+            std::vector<WorkerCommands> workers;
+            // Filled in slice order by recordParallel()
+            std::vector<VkCommandBuffer> secondaries;
+        };
+
+        void createInstance(const RendererCreateInfo &createInfo);
+        void pickPhysicalDevice();
+        void createLogicalDevice();
+        void createUploadQueue(const RendererCreateInfo &createInfo);
+        void createPipelineCache(const RendererCreateInfo &createInfo);
+        void createSwapchain();
+        void createOffscreenImages(const RendererCreateInfo &createInfo);
+        void createImageViews();
+        void createRenderPass();
+        void createPipeline(const RendererCreateInfo &createInfo);
+        void createFramebuffers();
+        void createCommandPool();
+        void createFrameData();
+        void createProfiler(const RendererCreateInfo &createInfo);
+        void createDescriptors();
+        void createFrameArena(const RendererCreateInfo &createInfo);
+        bool recreateSwapchain();
+        void releaseRetiredSwapchains();
+        void destroy();
+        VkCommandBuffer acquireSecondary(WorkerCommands &worker);
+        void setViewport(VkCommandBuffer commandBuffer) const;
+        void beginRendering(VkCommandBuffer commandBuffer,
+                            VkSubpassContents contents);
+        void endRendering(VkCommandBuffer commandBuffer);
+
+        std::function<VkExtent2D()> drawableExtent_;
+        VkClearColorValue clearColor_{};
+        bool headless_ = false;
+        bool enableReadback_ = false;
+        bool dynamicRendering_ = false;
+        bool descriptorIndexing_ = false;
+        bool synchronization2_ = false;
+        bool incrementalPresent_ = false;
+        PacingPolicy pacing_;
+        uint32_t framesInFlight_ = 0;
+        LatencyTracker latency_;
+        PFN_vkCmdBeginRendering cmdBeginRendering_ = nullptr;
+        PFN_vkCmdEndRendering cmdEndRendering_ = nullptr;
+        PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2_ = nullptr;
+
+        VkInstance instance_ = VK_NULL_HANDLE;
+        VkSurfaceKHR surface_ = VK_NULL_HANDLE;
+        VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
+        VkDevice device_ = VK_NULL_HANDLE;
+        VkPhysicalDeviceFeatures enabledFeatures_{};
+        std::vector<const char *> deviceExtensions_;
+        std::unique_ptr<MemoryAllocator> allocator_;
+        std::unique_ptr<UploadQueue> uploadQueue_;
+        std::unique_ptr<PipelineCache> pipelineCache_;
+        std::unique_ptr<PipelineRegistry> pipelines_;
+        std::unique_ptr<JobSystem> jobs_;
+        std::unique_ptr<Profiler> profiler_;
+        std::unique_ptr<DescriptorHeap> descriptorHeap_;
+        std::unique_ptr<FrameDescriptorAllocator> frameDescriptors_;
+        std::unique_ptr<FrameRing> frameArena_;
+
+        uint32_t graphicsFamily_ = UINT32_MAX;
+        uint32_t presentFamily_ = UINT32_MAX;
+        uint32_t transferFamily_ = UINT32_MAX;
+        uint32_t computeFamily_ = UINT32_MAX;
+        VkQueue graphicsQueue_ = VK_NULL_HANDLE;
+        VkQueue presentQueue_ = VK_NULL_HANDLE;
+        VkQueue transferQueue_ = VK_NULL_HANDLE;
+        VkQueue computeQueue_ = VK_NULL_HANDLE;
+
+        VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
+        VkPresentModeKHR presentMode_ = VK_PRESENT_MODE_FIFO_KHR;
+        VkFormat colorFormat_ = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent_{};
+        std::vector<VkImage> images_;
+        // Headless image ring, empty with a swapchain
+        std::vector<Image> offscreenImages_;
+        std::vector<VkImageView> imageViews_;
+        std::vector<VkFramebuffer> framebuffers_;
+        // Signalled by the submit and waited on by present, one per image so
+        // a semaphore is never reused while a present may still hold it
+        std::vector<VkSemaphore> renderFinished_;
+        bool swapchainDirty_ = false;
+
+        // A replaced swapchain and everything built on its images. Frames
+        // already in flight may still use them, so they are only destroyed
+        // once the submission numbered serial has completed.
+        struct RetiredSwapchain {
+            VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+            std::vector<VkImageView> imageViews;
+            std::vector<VkFramebuffer> framebuffers;
+            std::vector<VkSemaphore> renderFinished;
+            uint64_t serial = 0;
+        };
+        std::vector<RetiredSwapchain> retiredSwapchains_;
+
+        VkRenderPass renderPass_ = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+        // Owned by pipelines_
+        VkPipeline pipeline_ = VK_NULL_HANDLE;
+        VkPipeline instancedPipeline_ = VK_NULL_HANDLE;
+        PipelineDesc pipelineDesc_;
+
+        VkCommandPool commandPool_ = VK_NULL_HANDLE;
+        VkCommandPool computeCommandPool_ = VK_NULL_HANDLE;
+        std::vector<FrameData> frames_;
+        uint32_t currentFrame_ = 0;
+        uint32_t imageIndex_ = 0;
+        uint32_t lastSubmittedFrame_ = UINT32_MAX;
+        uint64_t submitSerial_ = 0;
+        uint64_t completedSerial_ = 0;
+        // Signalled by every graphics and async compute submission, so
+        // CPU waits go by value instead of through per-slot fences
+        VkSemaphore frameTimeline_ = VK_NULL_HANDLE;
+        VkSemaphore computeTimeline_ = VK_NULL_HANDLE;
+        uint64_t computeSerial_ = 0;
+        // Compute value the frame's graphics submission waits for, 0 for
+        // none
+        uint64_t computeWait_ = 0;
+        VkPipelineStageFlags computeWaitStage_ = 0;
+        // Where the frame's graphics submission waits for uploads
+        VkPipelineStageFlags uploadWaitStages_ =
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        bool computeRecording_ = false;
+        uint32_t frameScope_ = Profiler::NO_SCOPE;
+        VkSubpassContents subpassContents_ = VK_SUBPASS_CONTENTS_INLINE;
+    };
+
+} // namespace rvivl
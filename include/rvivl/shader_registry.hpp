@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace rvivl {
+
+    // SPIR-V of a file in shaders/, named after the source file, e.g.
+    // "vertex.vert"
+    struct EmbeddedShader {
+        std::string_view name;
+        std::span<const uint32_t> code;
+    };
+
+    // Every shader in shaders/, compiled and embedded into the library at
+    // build time, sorted by name. The code lives in constant data, so
+    // looking it up neither touches the filesystem nor allocates.
+    std::span<const EmbeddedShader> embeddedShaders();
+
+    std::optional<std::span<const uint32_t>>
+    findEmbeddedShader(std::string_view name);
+
+    // Throws if no shader has name
+    std::span<const uint32_t> embeddedShader(std::string_view name);
+
+} // namespace rvivl
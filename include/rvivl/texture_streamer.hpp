@@ -0,0 +1,257 @@
+#pragma once
+
+#include "rvivl/descriptor_heap.hpp"
+#include "rvivl/image_decode.hpp"
+#include "rvivl/memory_allocator.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    class Renderer;
+
+    struct TextureStreamerCreateInfo {
+        // Provides the device, queues and upload queue, must outlive the
+        // streamer
+        Renderer *renderer = nullptr;
+
+        // SPIR-V used by draw() and only read by the constructor. Empty
+        // picks the embedded shaders/image.vert and, with a descriptor
+        // heap, shaders/image_bindless.frag or else shaders/image.frag.
+        std::span<const uint32_t> vertexShaderCode;
+        std::span<const uint32_t> fragmentShaderCode;
+
+        // Threads that read and decode files
+        uint32_t decodeThreads = 2;
+        ImageDecoder decoder = decodePnm;
+
+        // Textures alive at once
+        uint32_t maxTextures = 256;
+
+        // Bytes staged per update(), so a large image is spread over a few
+        // frames instead of stalling one
+        VkDeviceSize uploadBudget = 4ull << 20;
+
+        // sRGB to match the swapchain format picked by the renderer
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    };
+
+    using TextureId = uint32_t;
+
+    enum class TextureState {
+        // Queued for or being read and decoded on a worker
+        Loading,
+        // Rows going through the staging ring, then mips being generated
+        Uploading,
+        Ready,
+        // The file could not be read or decoded
+        Failed,
+    };
+
+    // Where draw() puts a texture, in normalized device coordinates, and
+    // which part of the texture it shows. Matches the push constants of
+    // shaders/image.vert.
+    struct ImageRect {
+        float x = -1.0f;
+        float y = -1.0f;
+        float width = 2.0f;
+        float height = 2.0f;
+        float u = 0.0f;
+        float v = 0.0f;
+        float uWidth = 1.0f;
+        float vHeight = 1.0f;
+    };
+
+    // What a draw samples: a slot of Renderer::descriptorHeap() or, without
+    // one, a descriptor set of TextureStreamer::setLayout()
+    struct ImageBinding {
+        uint32_t heapIndex = DescriptorHeap::NO_INDEX;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+
+    struct TextureDraw {
+        TextureId id = 0;
+        ImageRect rect;
+    };
+
+    // Loads images in the background. Files are read and decoded on worker
+    // threads, rows are staged through the UploadQueue ring with batched
+    // vkCmdCopyBufferToImage and the mip chain is generated on the graphics
+    // queue with vkCmdBlitImage.
+    //
+    // With the renderer's DescriptorHeap every texture takes a slot of the
+    // bindless image array, which draws pick with a push constant, so a
+    // batch of draws binds one set. Without it each texture drawn in a
+    // frame gets a set from Renderer::frameDescriptors().
+    //
+    // Apart from the constructor and destructor every function belongs to
+    // the render thread, and none of them waits for file I/O, decoding or
+    // the GPU: a texture simply is not ready until a later update().
+    class TextureStreamer {
+    public:
+        explicit TextureStreamer(const TextureStreamerCreateInfo &createInfo);
+        // Call Renderer::waitIdle() first, frames may still sample textures
+        ~TextureStreamer();
+
+        TextureStreamer(const TextureStreamer &) = delete;
+        TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+        // Queues path for loading and returns the texture's id, which is
+        // never reused
+        TextureId load(std::string path);
+
+        // Destroys the texture once the frames that may have drawn it have
+        // completed. Unknown ids are ignored.
+        void release(TextureId id);
+
+        // Moves textures along: takes decoded images, stages up to the
+        // upload budget, submits mip generation and marks finished
+        // textures ready. Call once per frame, before submit().
+        void update();
+
+        TextureState state(TextureId id) const;
+        bool ready(TextureId id) const {
+            return state(id) == TextureState::Ready;
+        }
+        // Size of the decoded image, zero while loading
+        VkExtent2D extent(TextureId id) const;
+        // Slot in Renderer::descriptorHeap(), NO_INDEX until the texture
+        // is ready or without a heap
+        uint32_t heapIndex(TextureId id) const;
+
+        // Draws the texture into rect from inside the render pass. Returns
+        // false and draws nothing while the texture is not ready.
+        bool draw(VkCommandBuffer commandBuffer, TextureId id,
+                  const ImageRect &rect = {});
+        // Draws the ready textures of draws after binding the pipeline
+        // once, and returns how many were drawn
+        uint32_t draw(VkCommandBuffer commandBuffer,
+                      std::span<const TextureDraw> draws);
+
+        // Binds the pipeline and the descriptor heap for drawImage()
+        void bind(VkCommandBuffer commandBuffer) const;
+        // Draws image into rect after bind(), e.g. for images the streamer
+        // does not own
+        void drawImage(VkCommandBuffer commandBuffer,
+                       const ImageBinding &image, const ImageRect &rect) const;
+
+        // Layout of set 0 of pipelineLayout(), the descriptor heap's if
+        // there is one
+        VkDescriptorSetLayout setLayout() const;
+        VkPipelineLayout pipelineLayout() const { return pipelineLayout_; }
+        VkPipeline pipeline() const { return pipeline_; }
+        VkSampler sampler() const { return sampler_; }
+
+        // Textures still on their way to ready
+        uint32_t pendingCount() const { return pendingCount_; }
+
+    private:
+        struct Texture {
+            TextureState state = TextureState::Loading;
+            // Freed once every row is staged
+            DecodedImage decoded;
+            uint32_t rowsStaged = 0;
+            uint32_t mipLevels = 1;
+            Image image;
+            VkImageView view = VK_NULL_HANDLE;
+            uint32_t heapIndex = DescriptorHeap::NO_INDEX;
+            // Set from the frame descriptors without a heap, valid in the
+            // frame numbered frameSerial
+            VkDescriptorSet frameSet = VK_NULL_HANDLE;
+            uint64_t frameSerial = 0;
+            // Upload timeline value of the last staged rows and streamer
+            // timeline value of the mip generation
+            uint64_t uploadValue = 0;
+            uint64_t mipValue = 0;
+        };
+
+        struct Request {
+            TextureId id;
+            std::string path;
+        };
+
+        struct Result {
+            TextureId id;
+            bool success;
+            DecodedImage image;
+        };
+
+        // A released texture waiting for its last users to complete
+        struct Retired {
+            Texture texture;
+            uint64_t serial;
+        };
+
+        struct CommandSlot {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            uint64_t value = 0;
+        };
+
+        static constexpr uint32_t COMMAND_BUFFER_COUNT = 4;
+
+        void decodeLoop();
+        void createTexture(Texture &texture);
+        ImageBinding binding(Texture &texture);
+        void destroyTexture(Texture &texture);
+        void releaseRetired();
+        void collectDecoded();
+        void stageRows();
+        void generateMips();
+        void recordMips(VkCommandBuffer commandBuffer,
+                        const Texture &texture) const;
+        void completeMips();
+        uint64_t completedValue() const;
+        void destroy();
+
+        Renderer *renderer_;
+        VkDevice device_;
+        ImageDecoder decoder_;
+        uint32_t maxTextures_;
+        VkDeviceSize uploadBudget_;
+        VkFormat format_;
+        // False when the format cannot be blitted with linear filtering, in
+        // which case textures get a single level
+        bool generateMipmaps_ = false;
+
+        // nullptr without descriptor indexing
+        DescriptorHeap *heap_;
+        VkDescriptorSetLayout setLayout_ = VK_NULL_HANDLE;
+        VkSampler sampler_ = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+        // Owned by the renderer's pipeline registry
+        VkPipeline pipeline_ = VK_NULL_HANDLE;
+
+        // Mip generation runs on the graphics queue since blits need it
+        VkCommandPool commandPool_ = VK_NULL_HANDLE;
+        std::vector<CommandSlot> commandSlots_;
+        uint32_t nextSlot_ = 0;
+        VkSemaphore timeline_ = VK_NULL_HANDLE;
+        uint64_t submittedValue_ = 0;
+
+        std::unordered_map<TextureId, Texture> textures_;
+        TextureId nextId_ = 0;
+        uint32_t pendingCount_ = 0;
+        std::deque<TextureId> staging_;
+        std::vector<TextureId> staged_;
+        std::vector<TextureId> generating_;
+        std::vector<TextureId> written_;
+        std::vector<Retired> retired_;
+
+        std::mutex mutex_;
+        std::condition_variable requestsChanged_;
+        std::deque<Request> requests_;
+        std::vector<Result> results_;
+        bool stopping_ = false;
+        std::vector<std::thread> workers_;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "rvivl/asset.hpp"
+#include "rvivl/image_decode.hpp"
+#include "rvivl/memory_allocator.hpp"
+#include "rvivl/texture_streamer.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    class Renderer;
+
+    // A tile of the pyramid. Level 0 is full resolution and every level
+    // above halves it, so a tile of level l covers tileSize << l image
+    // pixels in each direction.
+    struct TileKey {
+        uint32_t level = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        bool operator==(const TileKey &other) const = default;
+    };
+
+    struct TileKeyHash {
+        size_t operator()(const TileKey &key) const {
+            return std::hash<uint64_t>()((uint64_t(key.level) << 58) ^
+                                         (uint64_t(key.x) << 29) ^ key.y);
+        }
+    };
+
+    // Part of the image in level 0 pixels, end exclusive
+    struct TileRect {
+        uint32_t x0 = 0;
+        uint32_t y0 = 0;
+        uint32_t x1 = 0;
+        uint32_t y1 = 0;
+    };
+
+    // What is on screen: the image pixel at the center of the viewport and
+    // how many screen pixels one image pixel covers
+    struct TileView {
+        double centerX = 0.0;
+        double centerY = 0.0;
+        double scale = 1.0;
+        VkExtent2D viewport = {0, 0};
+    };
+
+    // Geometry of a tile pyramid. The top level fits in a single tile.
+    class TilePyramid {
+    public:
+        TilePyramid(uint32_t width, uint32_t height, uint32_t tileSize);
+
+        uint32_t width() const { return width_; }
+        uint32_t height() const { return height_; }
+        uint32_t tileSize() const { return tileSize_; }
+        uint32_t levelCount() const { return levelCount_; }
+        uint32_t topLevel() const { return levelCount_ - 1; }
+
+        uint32_t tilesX(uint32_t level) const;
+        uint32_t tilesY(uint32_t level) const;
+
+        TileRect tileRect(const TileKey &key) const;
+        // Texels the tile holds, tileSize except along the right and bottom
+        // edges
+        VkExtent2D tileExtent(const TileKey &key) const;
+
+        // Finest level that still has at least one texel per screen pixel
+        uint32_t levelFor(double scale) const;
+
+        // Appends the tiles of level that intersect the view, row by row
+        void visibleTiles(const TileView &view, uint32_t level,
+                          std::vector<TileKey> &tiles) const;
+
+    private:
+        uint32_t width_;
+        uint32_t height_;
+        uint32_t tileSize_;
+        uint32_t levelCount_;
+    };
+
+    // Maps tiles to a fixed number of slots, evicting the least recently
+    // used tile when a new one needs room. A slot is only reused once the
+    // last frame that drew it has completed, and pinned slots never are.
+    class TileCache {
+    public:
+        explicit TileCache(uint32_t slotCount);
+
+        std::optional<uint32_t> find(const TileKey &key) const;
+
+        // Marks the slot as drawn by the frame numbered serial and makes it
+        // the most recently used
+        void touch(uint32_t slot, uint64_t serial);
+
+        // Claims a slot for key that the frame numbered serial writes.
+        // Returns false if every slot is pinned or used by a frame after
+        // completedSerial.
+        bool insert(const TileKey &key, uint64_t serial,
+                    uint64_t completedSerial, bool pinned, uint32_t &slot);
+
+        // Frees the slot of key, which is handed out again first
+        void erase(const TileKey &key);
+
+        uint32_t capacity() const {
+            return static_cast<uint32_t>(slots_.size());
+        }
+        uint32_t size() const { return static_cast<uint32_t>(lookup_.size()); }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Slot {
+            TileKey key;
+            bool used = false;
+            bool pinned = false;
+            uint64_t serial = 0;
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+        };
+
+        void unlink(uint32_t slot);
+        void pushBack(uint32_t slot);
+
+        std::vector<Slot> slots_;
+        // Unpinned slots, least recently used first
+        uint32_t head_ = NONE;
+        uint32_t tail_ = NONE;
+        std::unordered_map<TileKey, uint32_t, TileKeyHash> lookup_;
+    };
+
+    // Where the tiles of an image come from. readTile() is called from
+    // loader threads, several at a time.
+    class TileSource {
+    public:
+        virtual ~TileSource() = default;
+
+        virtual const TilePyramid &pyramid() const = 0;
+
+        // Fills tile with the texels of key, sized by
+        // TilePyramid::tileExtent()
+        virtual bool readTile(const TileKey &key, DecodedImage &tile) = 0;
+    };
+
+    // Reads tiles straight out of a memory mapped binary PPM or PGM file,
+    // so the image never has to fit in memory and only the pages of the
+    // rows a tile touches are read. Coarser levels pick every
+    // (1 << level)-th pixel, which reads far less than filtering.
+    class PnmTileSource : public TileSource {
+    public:
+        // Throws if the file is missing, truncated or not a binary PPM or
+        // PGM
+        explicit PnmTileSource(std::string path, uint32_t tileSize = 256);
+
+        const TilePyramid &pyramid() const override { return pyramid_; }
+        bool readTile(const TileKey &key, DecodedImage &tile) override;
+
+    private:
+        MappedFile file_;
+        PnmHeader header_;
+        TilePyramid pyramid_;
+    };
+
+    struct TiledImageCreateInfo {
+        // Must outlive the tiled image
+        Renderer *renderer = nullptr;
+        // Supplies the pipeline and sampler
+        TextureStreamer *streamer = nullptr;
+        std::shared_ptr<TileSource> source;
+
+        // Edge of the square tile atlas in texels, which bounds GPU memory
+        // whatever the image size
+        uint32_t atlasSize = 4096;
+
+        uint32_t loadThreads = 2;
+        // Tile reads queued at once; the queue follows the view, so this
+        // bounds the decoded tiles held in memory as well
+        uint32_t maxQueuedTiles = 64;
+        // Bytes staged per update()
+        VkDeviceSize uploadBudget = 4ull << 20;
+
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    };
+
+    // Displays images larger than GPU memory or maxImageDimension2D. The
+    // tiles visible at the current zoom are read on loader threads and
+    // copied into slots of one atlas image, managed by a TileCache. Until a
+    // tile arrives its nearest loaded ancestor is drawn in its place; the
+    // top level is pinned, so there always is one once the first tile has
+    // loaded. Like TextureStreamer, nothing here blocks the render thread.
+    class TiledImage {
+    public:
+        explicit TiledImage(const TiledImageCreateInfo &createInfo);
+        // Call Renderer::waitIdle() first
+        ~TiledImage();
+
+        TiledImage(const TiledImage &) = delete;
+        TiledImage &operator=(const TiledImage &) = delete;
+
+        // Requests the tiles view needs, coarsest first, and stages loaded
+        // tiles into the atlas. Call once per frame, before draw().
+        void update(const TileView &view);
+
+        // Draws the tiles of the last update() from inside the render pass
+        void draw(VkCommandBuffer commandBuffer);
+
+        const TilePyramid &pyramid() const { return source_->pyramid(); }
+        uint32_t residentTiles() const { return cache_.size(); }
+        uint32_t cachedTileCapacity() const { return cache_.capacity(); }
+        // Visible tiles of the last update() that are not loaded yet
+        uint32_t missingTiles() const { return missingTiles_; }
+        // Tiles of the last draw() shown through a coarser ancestor
+        uint32_t fallbackTiles() const { return fallbackTiles_; }
+
+    private:
+        struct Result {
+            TileKey key;
+            bool success;
+            DecodedImage tile;
+        };
+
+        // Without a descriptor heap
+        void createDescriptorSet();
+        void loadLoop();
+        void requestTiles();
+        bool stageTile(const Result &result);
+        void destroy();
+
+        Renderer *renderer_;
+        TextureStreamer *streamer_;
+        std::shared_ptr<TileSource> source_;
+        VkDevice device_;
+        uint32_t maxQueuedTiles_;
+        VkDeviceSize uploadBudget_;
+        uint32_t atlasSize_;
+        uint32_t slotsPerRow_ = 0;
+
+        Image atlas_;
+        VkImageView atlasView_ = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool_ = VK_NULL_HANDLE;
+        // A heap slot, or a set of descriptorPool_
+        ImageBinding image_;
+
+        TileCache cache_;
+        TileView view_;
+        uint32_t viewLevel_ = 0;
+        // Coarsest level first, then row by row
+        std::vector<TileKey> wanted_;
+        std::vector<TileKey> visible_;
+        std::vector<TileKey> scratch_;
+        uint32_t missingTiles_ = 0;
+        uint32_t fallbackTiles_ = 0;
+        // Loaded tiles waiting for room in the staging ring
+        std::deque<Result> loaded_;
+        std::unordered_set<TileKey, TileKeyHash> failed_;
+
+        std::mutex mutex_;
+        std::condition_variable requestsChanged_;
+        std::deque<TileKey> requests_;
+        // Queued or being read, only touched under mutex_
+        std::unordered_set<TileKey, TileKeyHash> requested_;
+        std::vector<Result> results_;
+        bool stopping_ = false;
+        std::vector<std::thread> workers_;
+    };
+
+} // namespace rvivl
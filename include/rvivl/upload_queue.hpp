@@ -0,0 +1,171 @@
+#pragma once
+
+#include "rvivl/memory_allocator.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Offset bookkeeping for a staging ring buffer. Space is handed out in
+    // order, grouped into batches that are each tagged with the timeline
+    // value of the submission reading them, and reclaimed from the tail as
+    // those values complete.
+    class StagingRing {
+    public:
+        explicit StagingRing(VkDeviceSize capacity);
+
+        // Finds room for size bytes at the given alignment, wrapping to the
+        // start when the end of the ring is too short. Returns false if the
+        // ring is too full.
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment,
+                      VkDeviceSize &offset);
+
+        // Closes everything allocated since the last close into a batch
+        // that is released once value has completed
+        void close(uint64_t value);
+        void release(uint64_t completedValue);
+
+        // Timeline value of the oldest closed batch, 0 if there is none
+        uint64_t oldestValue() const;
+
+        VkDeviceSize capacity() const { return capacity_; }
+        VkDeviceSize bytesInUse() const { return used_; }
+        VkDeviceSize openBytes() const { return openBytes_; }
+
+    private:
+        struct Batch {
+            uint64_t value;
+            VkDeviceSize end;
+            VkDeviceSize bytes;
+        };
+
+        VkDeviceSize capacity_;
+        VkDeviceSize head_ = 0;
+        VkDeviceSize tail_ = 0;
+        VkDeviceSize used_ = 0;
+        VkDeviceSize openBytes_ = 0;
+        std::deque<Batch> batches_;
+    };
+
+    struct UploadQueueCreateInfo {
+        VkDevice device = VK_NULL_HANDLE;
+        MemoryAllocator *allocator = nullptr;
+
+        // Queue the copies are submitted to, ideally from a transfer-only
+        // family so uploads run alongside graphics work
+        VkQueue transferQueue = VK_NULL_HANDLE;
+        uint32_t transferFamily = UINT32_MAX;
+
+        // Family that consumes the uploaded data. When it differs from the
+        // transfer family, destinations are shared concurrently by both.
+        uint32_t graphicsFamily = UINT32_MAX;
+
+        VkDeviceSize stagingSize = 16ull << 20;
+    };
+
+    // Moves data into DEVICE_LOCAL memory through a persistently mapped
+    // staging ring. Writes are batched into one command buffer per flush()
+    // and completion is tracked with a timeline semaphore, so the CPU only
+    // blocks when the ring is full and consumers wait on the GPU instead.
+    class UploadQueue {
+    public:
+        static constexpr uint32_t COMMAND_BUFFER_COUNT = 4;
+
+        explicit UploadQueue(const UploadQueueCreateInfo &createInfo);
+        ~UploadQueue();
+
+        UploadQueue(const UploadQueue &) = delete;
+        UploadQueue &operator=(const UploadQueue &) = delete;
+
+        // Creates a DEVICE_LOCAL buffer and queues a copy of data into it
+        Buffer createBuffer(const void *data, VkDeviceSize size,
+                            VkBufferUsageFlags usage);
+
+        // Queues a copy into an existing buffer. Overlapping writes to the
+        // same buffer within one flush are not ordered. Nor is the copy
+        // ordered after frames in flight, so no frame past
+        // Renderer::completedSerial() may still read the range.
+        void write(const Buffer &dst, VkDeviceSize dstOffset, const void *data,
+                   VkDeviceSize size);
+
+        // Creates a DEVICE_LOCAL image shared the same way as buffers
+        Image createImage(VkImageCreateInfo imageInfo);
+
+        // Queues the transition of all of the image's mip levels from
+        // UNDEFINED to layout ahead of the next flush's copies. Images are
+        // left in that layout for their consumer. GENERAL suits images that
+        // are written while other regions are sampled.
+        void prepareImage(
+            VkImage image, uint32_t mipLevels,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // Queues a copy of size bytes into the image region, which is in
+        // layout. Unlike write() this never blocks: it returns false when
+        // the ring has no room right now, so streaming callers can retry on
+        // a later frame.
+        bool tryWriteImage(
+            VkImage image, const VkBufferImageCopy &region, const void *data,
+            VkDeviceSize size,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // Submits all queued copies and returns the timeline value that
+        // signals once they have completed
+        uint64_t flush();
+
+        bool hasPending() const {
+            return !pendingCopies_.empty() || !pendingImageCopies_.empty() ||
+                   !pendingBarriers_.empty();
+        }
+        bool isComplete(uint64_t value) const;
+        void wait(uint64_t value) const;
+
+        VkSemaphore semaphore() const { return timeline_; }
+        uint64_t submittedValue() const { return submittedValue_; }
+        VkDeviceSize stagingCapacity() const { return ring_.capacity(); }
+
+    private:
+        struct PendingCopy {
+            VkBuffer dst;
+            VkBufferCopy region;
+        };
+
+        struct PendingImageCopy {
+            VkImage dst;
+            VkImageLayout layout;
+            VkBufferImageCopy region;
+        };
+
+        struct CommandSlot {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            uint64_t value = 0;
+        };
+
+        VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize alignment);
+        void destroy();
+
+        VkDevice device_;
+        MemoryAllocator *allocator_;
+        VkQueue queue_;
+        uint32_t transferFamily_;
+        uint32_t graphicsFamily_;
+
+        Buffer staging_;
+        StagingRing ring_;
+        std::vector<PendingCopy> pendingCopies_;
+        std::vector<VkBufferCopy> regions_;
+        std::vector<PendingImageCopy> pendingImageCopies_;
+        std::vector<VkBufferImageCopy> imageRegions_;
+        std::vector<VkImageMemoryBarrier> pendingBarriers_;
+
+        VkCommandPool commandPool_ = VK_NULL_HANDLE;
+        std::vector<CommandSlot> commandSlots_;
+        uint32_t nextSlot_ = 0;
+
+        VkSemaphore timeline_ = VK_NULL_HANDLE;
+        uint64_t submittedValue_ = 0;
+    };
+
+} // namespace rvivl
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace rvivl {
+
+    // Rounds to the nearest IEEE 754 half, ties to even. Out of range
+    // values become infinity.
+    constexpr uint16_t floatToHalf(float value) {
+        uint32_t bits = std::bit_cast<uint32_t>(value);
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t exponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (exponent == 0xff) {
+            return static_cast<uint16_t>(sign | 0x7c00 |
+                                         (mantissa != 0 ? 0x200 : 0));
+        }
+
+        int32_t halfExponent = int32_t(exponent) - 127 + 15;
+        if (halfExponent >= 0x1f) {
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+
+        uint32_t half = 0;
+        uint32_t shift = 13;
+        if (halfExponent <= 0) {
+            // Subnormal, the implicit leading bit becomes explicit
+            if (halfExponent < -10) {
+                return static_cast<uint16_t>(sign);
+            }
+            mantissa |= 0x800000;
+            shift = uint32_t(14 - halfExponent);
+        } else {
+            half = uint32_t(halfExponent) << 10;
+        }
+
+        // A carry out of the mantissa correctly bumps the exponent
+        half += mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Vertex attribute types. Each is read through the VkFormat given by
+    // attributeFormat and arrives in the shader as a float vector, so
+    // shaders/vertex.vert serves every layout built from them.
+    struct Float2 {
+        float x, y;
+    };
+
+    // Half floats, for positions that need range more than precision
+    struct Half2 {
+        uint16_t x, y;
+
+        static constexpr Half2 encode(float x, float y) {
+            return {floatToHalf(x), floatToHalf(y)};
+        }
+    };
+
+    // [-1, 1] in 16 bit steps, for positions already normalized to a
+    // known range
+    struct Snorm2 {
+        int16_t x, y;
+
+        static constexpr int16_t quantize(float value) {
+            value = std::clamp(value, -1.0f, 1.0f) * 32767.0f;
+            return static_cast<int16_t>(value < 0.0f ? value - 0.5f
+                                                     : value + 0.5f);
+        }
+
+        static constexpr Snorm2 encode(float x, float y) {
+            return {quantize(x), quantize(y)};
+        }
+    };
+
+    struct Float3 {
+        float r, g, b;
+    };
+
+    // Packed 8 bit color
+    struct Unorm4 {
+        uint8_t r, g, b, a;
+
+        static constexpr uint8_t quantize(float value) {
+            return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) *
+                                            255.0f +
+                                        0.5f);
+        }
+
+        static constexpr Unorm4 encode(float r, float g, float b,
+                                       float a = 1.0f) {
+            return {quantize(r), quantize(g), quantize(b), quantize(a)};
+        }
+    };
+
+    template <typename T>
+    inline constexpr VkFormat attributeFormat = VK_FORMAT_UNDEFINED;
+    template <>
+    inline constexpr VkFormat attributeFormat<Float2> = VK_FORMAT_R32G32_SFLOAT;
+    template <>
+    inline constexpr VkFormat attributeFormat<Half2> = VK_FORMAT_R16G16_SFLOAT;
+    template <>
+    inline constexpr VkFormat attributeFormat<Snorm2> = VK_FORMAT_R16G16_SNORM;
+    template <>
+    inline constexpr VkFormat attributeFormat<Float3> =
+        VK_FORMAT_R32G32B32_SFLOAT;
+    template <>
+    inline constexpr VkFormat attributeFormat<Unorm4> =
+        VK_FORMAT_R8G8B8A8_UNORM;
+
+    // A vertex with a position at location 0 and a color at location 1.
+    // The binding and attribute descriptions are derived from the member
+    // types at compile time.
+    template <typename Position, typename Color> struct VertexLayout {
+        static_assert(attributeFormat<Position> != VK_FORMAT_UNDEFINED &&
+                          attributeFormat<Color> != VK_FORMAT_UNDEFINED,
+                      "Vertex attribute type has no format");
+
+        Position pos;
+        Color color;
+
+        static constexpr VkVertexInputBindingDescription
+        getBindingDescription() {
+            return {0, sizeof(VertexLayout), VK_VERTEX_INPUT_RATE_VERTEX};
+        }
+
+        static constexpr std::array<VkVertexInputAttributeDescription, 2>
+        getAttributeDescriptions() {
+            return {{
+                {0, 0, attributeFormat<Position>, offsetof(VertexLayout, pos)},
+                {1, 0, attributeFormat<Color>, offsetof(VertexLayout, color)},
+            }};
+        }
+    };
+
+    // Vertex layout consumed by the default pipeline, 20 bytes
+    using Vertex = VertexLayout<Float2, Float3>;
+    // Compact layouts, 8 bytes each
+    using HalfVertex = VertexLayout<Half2, Unorm4>;
+    using QuantizedVertex = VertexLayout<Snorm2, Unorm4>;
+
+    // Vertex input of a pipeline in a form that can be chosen at runtime
+    struct VertexInput {
+        VkVertexInputBindingDescription binding{};
+        std::vector<VkVertexInputAttributeDescription> attributes;
+
+        template <typename V> static VertexInput of() {
+            auto attributes = V::getAttributeDescriptions();
+            return {V::getBindingDescription(),
+                    {attributes.begin(), attributes.end()}};
+        }
+    };
+
+    // Per-instance data consumed by the instanced pipeline, advancing once
+    // per instance on binding 1
+    struct Instance {
+        // Column-major 2x2 matrix applied to the vertex position
+        float transform[4];
+        float offset[2];
+        // Multiplied with the vertex color
+        float color[4];
+
+        static constexpr uint32_t BINDING = 1;
+
+        static VkVertexInputBindingDescription getBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+            bindingDescription.binding = BINDING;
+            bindingDescription.stride = sizeof(Instance);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+            return bindingDescription;
+        }
+
+        // Locations follow those of Vertex
+        static std::array<VkVertexInputAttributeDescription, 3>
+        getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 3>
+                attributeDescriptions{};
+
+            attributeDescriptions[0].binding = BINDING;
+            attributeDescriptions[0].location = 2;
+            attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[0].offset = offsetof(Instance, transform);
+
+            attributeDescriptions[1].binding = BINDING;
+            attributeDescriptions[1].location = 3;
+            attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescriptions[1].offset = offsetof(Instance, offset);
+
+            attributeDescriptions[2].binding = BINDING;
+            attributeDescriptions[2].location = 4;
+            attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[2].offset = offsetof(Instance, color);
+
+            return attributeDescriptions;
+        }
+    };
+
+} // namespace rvivl
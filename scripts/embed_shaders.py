@@ -1,11 +1,16 @@
 #!/usr/bin/env python3
 """
-Script to embed SPIR-V shader bytecode into C++ header file
-Usage: embed_shaders.py vertex.spv fragment.spv output.h
+Embeds compiled SPIR-V shaders into a C++ source file of the rvivl library.
+Every input is named after its file name without the trailing .spv, so
+vertex.vert.spv becomes "vertex.vert". The generated file defines
+rvivl::embeddedShaders() from rvivl/shader_registry.hpp.
+Usage: embed_shaders.py output.cpp input.spv...
 """
 
-import sys
 import os
+import sys
+
+SPIRV_MAGIC = 0x07230203
 
 
 def read_spirv_file(filename):
@@ -18,83 +23,86 @@ def read_spirv_file(filename):
         raise ValueError(
             f"SPIR-V file {filename} size is not multiple of 4 bytes")
 
-    # Convert bytes to 32-bit integers
-    integers = []
-    for i in range(0, len(data), 4):
-        # Read as little-endian 32-bit integer
-        value = int.from_bytes(data[i:i+4], byteorder='little')
-        integers.append(value)
+    # Read as little-endian 32-bit integers
+    integers = [int.from_bytes(data[i:i+4], byteorder='little')
+                for i in range(0, len(data), 4)]
+    if not integers or integers[0] != SPIRV_MAGIC:
+        raise ValueError(f"{filename} is not a SPIR-V file")
 
     return integers
 
 
-def generate_header(vertex_file, fragment_file, output_file):
-    """Generate C++ header with embedded shader data"""
+def shader_name(filename):
+    """Name a shader is looked up by, e.g. vertex.vert"""
+    name = os.path.basename(filename)
+    if name.endswith('.spv'):
+        name = name[:-len('.spv')]
+    return name
 
-    vertex_data = read_spirv_file(vertex_file)
-    fragment_data = read_spirv_file(fragment_file)
 
-    header_content = f"""// Auto-generated shader data
-// Do not edit this file manually
-#pragma once
+def format_words(words):
+    """Array initializer lines, five words per line"""
+    lines = []
+    for i in range(0, len(words), 5):
+        line = ', '.join(f"0x{value:08x}" for value in words[i:i+5])
+        lines.append(f"            {line},")
+    return '\n'.join(lines)
 
-#include <vector>
-#include <cstdint>
 
-namespace Shaders {{
+def generate_source(input_files, output_file):
+    """Generate C++ source with embedded shader data"""
 
-// Vertex shader SPIR-V bytecode
-const std::vector<uint32_t> vertexShaderCode = {{
-"""
+    shaders = sorted(((shader_name(f), read_spirv_file(f))
+                      for f in input_files), key=lambda shader: shader[0])
+    names = [name for name, _ in shaders]
+    if len(set(names)) != len(names):
+        raise ValueError("Shader names are not unique")
 
-    # Add vertex shader data
-    for i, value in enumerate(vertex_data):
-        if i % 8 == 0:
-            header_content += "\n    "
-        header_content += f"0x{value:08x},"
-        if i < len(vertex_data) - 1:
-            header_content += " "
+    arrays = []
+    entries = []
+    for index, (name, words) in enumerate(shaders):
+        arrays.append(f"""        // {name}
+        alignas(16) constexpr uint32_t SHADER_{index}[] = {{
+{format_words(words)}
+        }};
+""")
+        entries.append(f'            {{"{name}", SHADER_{index}}},')
 
-    header_content += f"""
-}};
+    source = f"""// Generated by scripts/embed_shaders.py, do not edit
+#include "rvivl/shader_registry.hpp"
 
-// Fragment shader SPIR-V bytecode
-const std::vector<uint32_t> fragmentShaderCode = {{
-"""
+namespace rvivl {{
+
+    namespace {{
 
-    # Add fragment shader data
-    for i, value in enumerate(fragment_data):
-        if i % 8 == 0:
-            header_content += "\n    "
-        header_content += f"0x{value:08x},"
-        if i < len(fragment_data) - 1:
-            header_content += " "
+{chr(10).join(arrays)}
+        // Sorted by name for findEmbeddedShader()
+        constexpr EmbeddedShader SHADERS[] = {{
+{chr(10).join(entries)}
+        }};
 
-    header_content += f"""
-}};
+    }} // namespace
 
-}} // namespace Shaders
+    std::span<const EmbeddedShader> embeddedShaders() {{ return SHADERS; }}
+
+}} // namespace rvivl
 """
 
     with open(output_file, 'w') as f:
-        f.write(header_content)
+        f.write(source)
 
     print(f"Generated {output_file} with embedded shaders")
-    print(f"  Vertex shader: {len(vertex_data)} words")
-    print(f"  Fragment shader: {len(fragment_data)} words")
+    for name, words in shaders:
+        print(f"  {name}: {len(words)} words")
 
 
 if __name__ == "__main__":
-    if len(sys.argv) != 4:
-        print("Usage: embed_shaders.py vertex.spv fragment.spv output.h")
+    if len(sys.argv) < 3:
+        print("Usage: embed_shaders.py output.cpp input.spv...")
         sys.exit(1)
 
-    vertex_file = sys.argv[1]
-    fragment_file = sys.argv[2]
-    output_file = sys.argv[3]
-
     try:
-        generate_header(vertex_file, fragment_file, output_file)
+        generate_source(sys.argv[2:], sys.argv[1])
     except Exception as e:
         print(f"Error: {e}")
         sys.exit(1)
@@ -0,0 +1,20 @@
+#version 450
+
+// See rvivl::ImageRect
+layout(push_constant) uniform Rect {
+    vec4 position;
+    vec4 uv;
+} rect;
+
+layout(location = 0) out vec2 fragUV;
+
+// Two triangles covering the rect, so no vertex buffer is needed
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main() {
+    vec2 corner = CORNERS[gl_VertexIndex];
+    gl_Position = vec4(rect.position.xy + corner * rect.position.zw, 0.0, 1.0);
+    fragUV = rect.uv.xy + corner * rect.uv.zw;
+}
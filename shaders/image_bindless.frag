@@ -0,0 +1,18 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Image array of rvivl::DescriptorHeap
+layout(set = 0, binding = 0) uniform sampler2D images[];
+
+// Slot in images, after the rvivl::ImageRect the vertex shader reads
+layout(push_constant) uniform Image {
+    layout(offset = 32) uint index;
+} image;
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(images[image.index], fragUV);
+}
@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per instance, see rvivl::Instance
+layout(location = 2) in vec4 inTransform;
+layout(location = 3) in vec2 inOffset;
+layout(location = 4) in vec4 inInstanceColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    mat2 transform = mat2(inTransform.xy, inTransform.zw);
+    gl_Position = vec4(transform * inPosition + inOffset, 0.0, 1.0);
+    fragColor = inColor * inInstanceColor.rgb;
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per draw, pushed into the frame arena and bound at its dynamic offset,
+// see rvivl::FrameRing::pushUniform()
+layout(set = 0, binding = 0) uniform Transform {
+    vec4 transform;
+    vec2 offset;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    mat2 transform = mat2(draw.transform.xy, draw.transform.zw);
+    gl_Position = vec4(transform * inPosition + draw.offset, 0.0, 1.0);
+    fragColor = inColor;
+}
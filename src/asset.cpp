@@ -0,0 +1,220 @@
+#include "rvivl/asset.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rvivl {
+
+    namespace {
+
+        constexpr char ARCHIVE_MAGIC[4] = {'R', 'V', 'A', 'P'};
+        // Enough for SPIR-V words and for the staging ring's copies
+        constexpr uint64_t ENTRY_ALIGNMENT = 16;
+
+        struct ArchiveHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t entryCount;
+            uint32_t reserved;
+        };
+
+        struct ArchiveIndexEntry {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t nameOffset;
+            uint32_t nameSize;
+        };
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        template <typename T>
+        void append(std::vector<char> &file, const T &value) {
+            const char *bytes = reinterpret_cast<const char *>(&value);
+            file.insert(file.end(), bytes, bytes + sizeof(T));
+        }
+
+    } // namespace
+
+    MappedFile::MappedFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        struct stat status{};
+        if (::fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        // Empty files cannot be mapped and need no mapping
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ > 0) {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            size_ = 0;
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    std::span<const uint32_t> Asset::words() const {
+        if (bytes_.size() % sizeof(uint32_t) != 0 ||
+            reinterpret_cast<uintptr_t>(bytes_.data()) % alignof(uint32_t) !=
+                0) {
+            throw std::runtime_error("Asset is not made of 32-bit words!");
+        }
+        return {reinterpret_cast<const uint32_t *>(bytes_.data()),
+                bytes_.size() / sizeof(uint32_t)};
+    }
+
+    std::vector<char>
+    encodeAssetArchive(const std::vector<ArchiveEntry> &entries) {
+        uint64_t namesOffset = sizeof(ArchiveHeader) +
+                               entries.size() * sizeof(ArchiveIndexEntry);
+        uint64_t namesSize = 0;
+        for (const ArchiveEntry &entry : entries) {
+            namesSize += entry.name.size();
+        }
+
+        std::vector<ArchiveIndexEntry> index;
+        uint64_t nameOffset = namesOffset;
+        uint64_t dataOffset = alignUp(namesOffset + namesSize, ENTRY_ALIGNMENT);
+        for (const ArchiveEntry &entry : entries) {
+            ArchiveIndexEntry indexEntry{};
+            indexEntry.offset = dataOffset;
+            indexEntry.size = entry.data.size();
+            indexEntry.nameOffset = static_cast<uint32_t>(nameOffset);
+            indexEntry.nameSize = static_cast<uint32_t>(entry.name.size());
+            index.push_back(indexEntry);
+
+            nameOffset += entry.name.size();
+            dataOffset = alignUp(dataOffset + entry.data.size(),
+                                 ENTRY_ALIGNMENT);
+        }
+
+        ArchiveHeader header{};
+        std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        header.version = AssetArchive::FORMAT_VERSION;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+
+        std::vector<char> file;
+        file.reserve(static_cast<size_t>(dataOffset));
+        append(file, header);
+        for (const ArchiveIndexEntry &indexEntry : index) {
+            append(file, indexEntry);
+        }
+        for (const ArchiveEntry &entry : entries) {
+            file.insert(file.end(), entry.name.begin(), entry.name.end());
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            file.resize(static_cast<size_t>(index[i].offset), 0);
+            file.insert(file.end(), entries[i].data.begin(),
+                        entries[i].data.end());
+        }
+        return file;
+    }
+
+    AssetArchive::AssetArchive(const std::string &path)
+        : file_(std::make_shared<const MappedFile>(path)) {
+        std::span<const char> bytes = file_->bytes();
+
+        ArchiveHeader header{};
+        if (bytes.size() < sizeof(header)) {
+            throw std::runtime_error("Failed to read asset archive: " + path);
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) !=
+                0 ||
+            header.version != FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported asset archive: " + path);
+        }
+
+        uint64_t indexEnd = sizeof(header) + uint64_t(header.entryCount) *
+                                                 sizeof(ArchiveIndexEntry);
+        if (indexEnd > bytes.size()) {
+            throw std::runtime_error("Failed to read asset archive: " + path);
+        }
+
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            ArchiveIndexEntry entry{};
+            std::memcpy(&entry,
+                        bytes.data() + sizeof(header) +
+                            i * sizeof(ArchiveIndexEntry),
+                        sizeof(entry));
+            if (uint64_t(entry.nameOffset) + entry.nameSize > bytes.size() ||
+                entry.offset > bytes.size() ||
+                entry.size > bytes.size() - entry.offset) {
+                throw std::runtime_error("Failed to read asset archive: " +
+                                         path);
+            }
+
+            std::string name(bytes.data() + entry.nameOffset,
+                             entry.nameSize);
+            entries_[std::move(name)] = bytes.subspan(
+                static_cast<size_t>(entry.offset),
+                static_cast<size_t>(entry.size));
+        }
+    }
+
+    std::optional<Asset> AssetArchive::find(std::string_view name) const {
+        auto it = entries_.find(name);
+        if (it == entries_.end()) {
+            return std::nullopt;
+        }
+        return Asset(file_, it->second);
+    }
+
+    void AssetLibrary::addArchive(const std::string &path) {
+        archives_.emplace_back(path);
+    }
+
+    void AssetLibrary::addDirectory(std::string path) {
+        directories_.push_back(std::move(path));
+    }
+
+    std::optional<Asset> AssetLibrary::tryLoad(const std::string &name) const {
+        for (const AssetArchive &archive : archives_) {
+            if (std::optional<Asset> asset = archive.find(name)) {
+                return asset;
+            }
+        }
+
+        for (const std::string &directory : directories_) {
+            auto path = std::filesystem::path(directory) / name;
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(path, error)) {
+                continue;
+            }
+            auto file = std::make_shared<const MappedFile>(path.string());
+            std::span<const char> bytes = file->bytes();
+            return Asset(std::move(file), bytes);
+        }
+        return std::nullopt;
+    }
+
+    Asset AssetLibrary::load(const std::string &name) const {
+        std::optional<Asset> asset = tryLoad(name);
+        if (!asset) {
+            throw std::runtime_error("Failed to find asset: " + name);
+        }
+        return *asset;
+    }
+
+} // namespace rvivl
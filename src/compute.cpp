@@ -0,0 +1,188 @@
+#include "rvivl/compute.hpp"
+#include "rvivl/renderer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rvivl {
+
+    ComputePipeline::ComputePipeline(
+        const ComputePipelineCreateInfo &createInfo)
+        : renderer_(createInfo.renderer),
+          device_(createInfo.renderer->device()),
+          bindings_(createInfo.bindings),
+          pushConstantSize_(createInfo.pushConstantSize),
+          localSize_{std::max(createInfo.localSizeX, 1u),
+                     std::max(createInfo.localSizeY, 1u),
+                     std::max(createInfo.localSizeZ, 1u)} {
+        if (bindings_.size() > MAX_BINDINGS) {
+            throw std::runtime_error("Too many compute bindings!");
+        }
+
+        try {
+            VkDescriptorSetLayoutBinding layoutBindings[MAX_BINDINGS]{};
+            for (uint32_t i = 0; i < bindings_.size(); i++) {
+                layoutBindings[i].binding = i;
+                layoutBindings[i].descriptorType = bindings_[i];
+                layoutBindings[i].descriptorCount = 1;
+                layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType =
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings_.size());
+            layoutInfo.pBindings = layoutBindings;
+
+            if (vkCreateDescriptorSetLayout(device_, &layoutInfo, nullptr,
+                                            &setLayout_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create compute descriptor set layout!");
+            }
+
+            VkPushConstantRange pushConstantRange{};
+            pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            pushConstantRange.size = pushConstantSize_;
+
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+            pipelineLayoutInfo.sType =
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = 1;
+            pipelineLayoutInfo.pSetLayouts = &setLayout_;
+            if (pushConstantSize_ > 0) {
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+            }
+
+            if (vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
+                                       &pipelineLayout_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create compute pipeline layout!");
+            }
+
+            VkPipelineShaderStageCreateInfo stageInfo{};
+            stageInfo.sType =
+                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            stageInfo.module =
+                renderer_->pipelines().shaderModule(createInfo.shaderCode);
+            stageInfo.pName = "main";
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage = stageInfo;
+            pipelineInfo.layout = pipelineLayout_;
+
+            if (vkCreateComputePipelines(
+                    device_, renderer_->pipelineCache().handle(), 1,
+                    &pipelineInfo, nullptr, &pipeline_) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create compute pipeline!");
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    ComputePipeline::~ComputePipeline() { destroy(); }
+
+    void ComputePipeline::destroy() {
+        if (pipeline_ != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device_, pipeline_, nullptr);
+            pipeline_ = VK_NULL_HANDLE;
+        }
+        if (pipelineLayout_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device_, pipelineLayout_, nullptr);
+            pipelineLayout_ = VK_NULL_HANDLE;
+        }
+        if (setLayout_ != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device_, setLayout_, nullptr);
+            setLayout_ = VK_NULL_HANDLE;
+        }
+    }
+
+    void ComputePipeline::bind(VkCommandBuffer commandBuffer,
+                               std::span<const ComputeResource> resources,
+                               const void *pushConstants) const {
+        if (resources.size() != bindings_.size()) {
+            throw std::runtime_error(
+                "Compute resources do not match the bindings!");
+        }
+
+        VkDescriptorSet descriptorSet =
+            renderer_->frameDescriptors().allocate(setLayout_);
+
+        VkWriteDescriptorSet writes[MAX_BINDINGS]{};
+        VkDescriptorImageInfo imageInfos[MAX_BINDINGS]{};
+        VkDescriptorBufferInfo bufferInfos[MAX_BINDINGS]{};
+        for (uint32_t i = 0; i < resources.size(); i++) {
+            const ComputeResource &resource = resources[i];
+            if (resource.type != bindings_[i]) {
+                throw std::runtime_error(
+                    "Compute resources do not match the bindings!");
+            }
+
+            VkWriteDescriptorSet &write = writes[i];
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = i;
+            write.descriptorCount = 1;
+            write.descriptorType = resource.type;
+            if (resource.buffer != VK_NULL_HANDLE) {
+                bufferInfos[i].buffer = resource.buffer;
+                bufferInfos[i].offset = resource.offset;
+                bufferInfos[i].range = resource.range;
+                write.pBufferInfo = &bufferInfos[i];
+            } else {
+                imageInfos[i].sampler = resource.sampler;
+                imageInfos[i].imageView = resource.view;
+                imageInfos[i].imageLayout = resource.layout;
+                write.pImageInfo = &imageInfos[i];
+            }
+        }
+        vkUpdateDescriptorSets(device_,
+                               static_cast<uint32_t>(resources.size()), writes,
+                               0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipeline_);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                pipelineLayout_, 0, 1, &descriptorSet, 0,
+                                nullptr);
+        if (pushConstantSize_ > 0 && pushConstants != nullptr) {
+            vkCmdPushConstants(commandBuffer, pipelineLayout_,
+                               VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               pushConstantSize_, pushConstants);
+        }
+    }
+
+    void ComputePipeline::dispatch(VkCommandBuffer commandBuffer,
+                                   uint32_t width, uint32_t height,
+                                   uint32_t depth) const {
+        vkCmdDispatch(commandBuffer, groupCount(width, localSize_[0]),
+                      groupCount(height, localSize_[1]),
+                      groupCount(depth, localSize_[2]));
+    }
+
+    void imageBarrier(VkCommandBuffer commandBuffer, VkImage image,
+                      VkImageLayout oldLayout, VkImageLayout newLayout,
+                      VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                      VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr,
+                             0, nullptr, 1, &barrier);
+    }
+
+} // namespace rvivl
@@ -0,0 +1,380 @@
+#include "rvivl/descriptor_heap.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        VkPhysicalDeviceVulkan12Features
+        queryFeatures(VkPhysicalDevice physicalDevice) {
+            VkPhysicalDeviceVulkan12Features features12{};
+            features12.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &features12;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+            return features12;
+        }
+
+        // Update after bind sets have limits of their own, often far below
+        // the requested array sizes on mobile GPUs
+        VkPhysicalDeviceVulkan12Properties
+        queryLimits(VkPhysicalDevice physicalDevice) {
+            VkPhysicalDeviceVulkan12Properties properties12{};
+            properties12.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &properties12;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+            return properties12;
+        }
+
+        uint32_t imageLimit(const DescriptorHeapCreateInfo &createInfo) {
+            VkPhysicalDeviceVulkan12Properties limits =
+                queryLimits(createInfo.physicalDevice);
+            return std::min(
+                {createInfo.maxImages,
+                 limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                 limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                 limits.maxDescriptorSetUpdateAfterBindSamplers,
+                 limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+        }
+
+        uint32_t bufferLimit(const DescriptorHeapCreateInfo &createInfo) {
+            VkPhysicalDeviceVulkan12Properties limits =
+                queryLimits(createInfo.physicalDevice);
+            return std::min(
+                {createInfo.maxBuffers,
+                 limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                 limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        }
+
+    } // namespace
+
+    DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t capacity)
+        : capacity_(capacity) {}
+
+    uint32_t DescriptorIndexAllocator::allocate() {
+        uint32_t index = NO_INDEX;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else if (next_ < capacity_) {
+            index = next_++;
+        } else {
+            return NO_INDEX;
+        }
+        size_++;
+        return index;
+    }
+
+    void DescriptorIndexAllocator::free(uint32_t index, uint64_t serial) {
+        if (index >= next_) {
+            return;
+        }
+        retired_.push_back(Retired{index, serial});
+    }
+
+    void DescriptorIndexAllocator::release(uint64_t completedSerial) {
+        std::erase_if(retired_, [&](const Retired &retired) {
+            if (retired.serial > completedSerial) {
+                return false;
+            }
+            free_.push_back(retired.index);
+            size_--;
+            return true;
+        });
+    }
+
+    bool DescriptorHeap::supported(VkPhysicalDevice physicalDevice) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features features =
+            queryFeatures(physicalDevice);
+        return features.runtimeDescriptorArray == VK_TRUE &&
+               features.descriptorBindingPartiallyBound == VK_TRUE &&
+               features.descriptorBindingSampledImageUpdateAfterBind ==
+                   VK_TRUE &&
+               features.descriptorBindingStorageBufferUpdateAfterBind ==
+                   VK_TRUE &&
+               features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+    }
+
+    void
+    DescriptorHeap::enableFeatures(VkPhysicalDeviceVulkan12Features &features) {
+        features.runtimeDescriptorArray = VK_TRUE;
+        features.descriptorBindingPartiallyBound = VK_TRUE;
+        features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
+
+    DescriptorHeap::DescriptorHeap(const DescriptorHeapCreateInfo &createInfo)
+        : device_(createInfo.device), images_(imageLimit(createInfo)),
+          buffers_(bufferLimit(createInfo)) {
+        if (images_.capacity() == 0 || buffers_.capacity() == 0) {
+            throw std::runtime_error("Descriptor heap has no room!");
+        }
+
+        try {
+            VkDescriptorSetLayoutBinding bindings[2]{};
+            bindings[0].binding = IMAGE_BINDING;
+            bindings[0].descriptorType =
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[0].descriptorCount = images_.capacity();
+            bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+            bindings[1].binding = BUFFER_BINDING;
+            bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[1].descriptorCount = buffers_.capacity();
+            bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+            // Slots that no shader reads may hold nothing, and slots may be
+            // written while the set is bound in frames in flight as long as
+            // those frames do not read them
+            VkDescriptorBindingFlags bindingFlags[2] = {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+            };
+
+            VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+            flagsInfo.sType =
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            flagsInfo.bindingCount = 2;
+            flagsInfo.pBindingFlags = bindingFlags;
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType =
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.pNext = &flagsInfo;
+            layoutInfo.flags =
+                VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            layoutInfo.bindingCount = 2;
+            layoutInfo.pBindings = bindings;
+
+            if (vkCreateDescriptorSetLayout(device_, &layoutInfo, nullptr,
+                                            &setLayout_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create descriptor heap set layout!");
+            }
+
+            VkDescriptorPoolSize poolSizes[2]{};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[0].descriptorCount = images_.capacity();
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSizes[1].descriptorCount = buffers_.capacity();
+
+            VkDescriptorPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+            poolInfo.maxSets = 1;
+            poolInfo.poolSizeCount = 2;
+            poolInfo.pPoolSizes = poolSizes;
+
+            if (vkCreateDescriptorPool(device_, &poolInfo, nullptr,
+                                       &descriptorPool_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create descriptor heap pool!");
+            }
+
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool_;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &setLayout_;
+
+            if (vkAllocateDescriptorSets(device_, &allocInfo,
+                                         &descriptorSet_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate descriptor heap set!");
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    DescriptorHeap::~DescriptorHeap() { destroy(); }
+
+    void DescriptorHeap::destroy() {
+        // Frees the set as well
+        if (descriptorPool_ != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(device_, descriptorPool_, nullptr);
+            descriptorPool_ = VK_NULL_HANDLE;
+            descriptorSet_ = VK_NULL_HANDLE;
+        }
+        if (setLayout_ != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device_, setLayout_, nullptr);
+            setLayout_ = VK_NULL_HANDLE;
+        }
+    }
+
+    uint32_t DescriptorHeap::addImage(VkImageView view, VkSampler sampler,
+                                      VkImageLayout layout) {
+        uint32_t index = images_.allocate();
+        if (index == NO_INDEX) {
+            throw std::runtime_error("Descriptor heap is out of image slots!");
+        }
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+        imageInfo.imageView = view;
+        imageInfo.imageLayout = layout;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet_;
+        write.dstBinding = IMAGE_BINDING;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+        return index;
+    }
+
+    uint32_t DescriptorHeap::addBuffer(VkBuffer buffer, VkDeviceSize offset,
+                                       VkDeviceSize range) {
+        uint32_t index = buffers_.allocate();
+        if (index == NO_INDEX) {
+            throw std::runtime_error("Descriptor heap is out of buffer slots!");
+        }
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = buffer;
+        bufferInfo.offset = offset;
+        bufferInfo.range = range;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet_;
+        write.dstBinding = BUFFER_BINDING;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+        return index;
+    }
+
+    void DescriptorHeap::removeImage(uint32_t index, uint64_t serial) {
+        images_.free(index, serial);
+    }
+
+    void DescriptorHeap::removeBuffer(uint32_t index, uint64_t serial) {
+        buffers_.free(index, serial);
+    }
+
+    void DescriptorHeap::release(uint64_t completedSerial) {
+        images_.release(completedSerial);
+        buffers_.release(completedSerial);
+    }
+
+    void DescriptorHeap::bind(VkCommandBuffer commandBuffer,
+                              VkPipelineBindPoint bindPoint,
+                              VkPipelineLayout layout,
+                              uint32_t firstSet) const {
+        vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet, 1,
+                                &descriptorSet_, 0, nullptr);
+    }
+
+    FrameDescriptorAllocator::FrameDescriptorAllocator(
+        const FrameDescriptorAllocatorCreateInfo &createInfo)
+        : device_(createInfo.device),
+          setsPerPool_(std::max(createInfo.setsPerPool, 1u)),
+          poolSizes_(createInfo.poolSizes),
+          frames_(std::max(createInfo.frameCount, 1u)) {
+        for (VkDescriptorPoolSize &poolSize : poolSizes_) {
+            poolSize.descriptorCount *= setsPerPool_;
+        }
+    }
+
+    FrameDescriptorAllocator::~FrameDescriptorAllocator() { destroy(); }
+
+    void FrameDescriptorAllocator::destroy() {
+        for (Frame &frame : frames_) {
+            for (VkDescriptorPool pool : frame.pools) {
+                vkDestroyDescriptorPool(device_, pool, nullptr);
+            }
+            frame.pools.clear();
+            frame.used = 0;
+        }
+    }
+
+    VkDescriptorPool FrameDescriptorAllocator::createPool() {
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = setsPerPool_;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes_.size());
+        poolInfo.pPoolSizes = poolSizes_.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(device_, &poolInfo, nullptr, &pool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create frame descriptor pool!");
+        }
+        return pool;
+    }
+
+    void FrameDescriptorAllocator::beginFrame(uint32_t frameIndex) {
+        if (frameIndex >= frames_.size()) {
+            throw std::runtime_error("Frame index out of range!");
+        }
+        frameIndex_ = frameIndex;
+
+        Frame &frame = frames_[frameIndex];
+        for (uint32_t i = 0; i < frame.used; i++) {
+            vkResetDescriptorPool(device_, frame.pools[i], 0);
+        }
+        frame.used = 0;
+    }
+
+    VkDescriptorSet
+    FrameDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+        Frame &frame = frames_[frameIndex_];
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        if (frame.used > 0) {
+            allocInfo.descriptorPool = frame.pools[frame.used - 1];
+            VkResult result =
+                vkAllocateDescriptorSets(device_, &allocInfo, &descriptorSet);
+            if (result == VK_SUCCESS) {
+                return descriptorSet;
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+                result != VK_ERROR_FRAGMENTED_POOL) {
+                throw std::runtime_error(
+                    "Failed to allocate frame descriptor set!");
+            }
+        }
+
+        // The current pool is full, move on to the next one
+        if (frame.used == frame.pools.size()) {
+            frame.pools.push_back(createPool());
+        }
+        allocInfo.descriptorPool = frame.pools[frame.used++];
+        if (vkAllocateDescriptorSets(device_, &allocInfo, &descriptorSet) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to allocate frame descriptor set!");
+        }
+        return descriptorSet;
+    }
+
+} // namespace rvivl
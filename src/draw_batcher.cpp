@@ -0,0 +1,210 @@
+#include "rvivl/draw_batcher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        uint32_t indexSize(VkIndexType indexType) {
+            switch (indexType) {
+            case VK_INDEX_TYPE_UINT16:
+                return 2;
+            case VK_INDEX_TYPE_UINT32:
+                return 4;
+            default:
+                throw std::runtime_error("Unsupported index type!");
+            }
+        }
+
+    } // namespace
+
+    void DrawList::clear() {
+        for (uint32_t i = 0; i < batchCount_; i++) {
+            batches_[i].commands.clear();
+        }
+        batchCount_ = 0;
+        drawCount_ = 0;
+        lastBatch_ = 0;
+    }
+
+    void DrawList::add(VkPipeline pipeline,
+                       const VkDrawIndexedIndirectCommand &command) {
+        // Draws tend to come in runs of the same pipeline
+        uint32_t batch = lastBatch_;
+        if (batch >= batchCount_ || batches_[batch].pipeline != pipeline) {
+            batch = 0;
+            while (batch < batchCount_ &&
+                   batches_[batch].pipeline != pipeline) {
+                batch++;
+            }
+            if (batch == batchCount_) {
+                if (batchCount_ == batches_.size()) {
+                    batches_.emplace_back();
+                }
+                batches_[batch].pipeline = pipeline;
+                batchCount_++;
+            }
+        }
+
+        batches_[batch].commands.push_back(command);
+        lastBatch_ = batch;
+        drawCount_++;
+    }
+
+    DrawBatcher::DrawBatcher(const DrawBatcherCreateInfo &createInfo)
+        : allocator_(createInfo.allocator),
+          uploadQueue_(createInfo.uploadQueue),
+          frameCount_(createInfo.frameCount),
+          multiDrawIndirect_(createInfo.multiDrawIndirect),
+          vertexStride_(createInfo.vertexStride),
+          indexType_(createInfo.indexType),
+          indexSize_(indexSize(createInfo.indexType)),
+          maxDraws_(createInfo.maxDraws),
+          vertexRanges_(createInfo.vertexCapacity, 1),
+          indexRanges_(createInfo.indexCapacity, 1) {
+        if (vertexStride_ == 0) {
+            throw std::runtime_error("Draw batcher needs a vertex stride!");
+        }
+
+        // Only 65535 is guaranteed with multiDrawIndirect
+        if (multiDrawIndirect_) {
+            if (createInfo.physicalDevice == VK_NULL_HANDLE) {
+                throw std::runtime_error(
+                    "Multi-draw indirect needs the physical device!");
+            }
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(createInfo.physicalDevice,
+                                          &properties);
+            maxDrawCount_ =
+                std::max(properties.limits.maxDrawIndirectCount, 1u);
+        }
+
+        try {
+            vertexBuffer_ = uploadQueue_->createBuffer(
+                nullptr,
+                VkDeviceSize(createInfo.vertexCapacity) * vertexStride_,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+            indexBuffer_ = uploadQueue_->createBuffer(
+                nullptr, VkDeviceSize(createInfo.indexCapacity) * indexSize_,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+            indirectBuffer_ = allocator_->createBuffer(
+                VkDeviceSize(frameCount_) * maxDraws_ *
+                    sizeof(VkDrawIndexedIndirectCommand),
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    DrawBatcher::~DrawBatcher() { destroy(); }
+
+    void DrawBatcher::destroy() {
+        allocator_->destroyBuffer(indirectBuffer_);
+        allocator_->destroyBuffer(indexBuffer_);
+        allocator_->destroyBuffer(vertexBuffer_);
+    }
+
+    Mesh DrawBatcher::addMesh(const void *vertices, uint32_t vertexCount,
+                              const void *indices, uint32_t indexCount) {
+        if (vertexCount == 0 || indexCount == 0) {
+            throw std::runtime_error("Failed to add an empty mesh!");
+        }
+
+        VkDeviceSize firstVertex = 0;
+        if (!vertexRanges_.allocate(vertexCount, 1, ResourceKind::Linear,
+                                    firstVertex)) {
+            throw std::runtime_error("Failed to fit mesh vertices!");
+        }
+
+        VkDeviceSize firstIndex = 0;
+        if (!indexRanges_.allocate(indexCount, 1, ResourceKind::Linear,
+                                   firstIndex)) {
+            vertexRanges_.free(firstVertex);
+            throw std::runtime_error("Failed to fit mesh indices!");
+        }
+
+        uploadQueue_->write(vertexBuffer_, firstVertex * vertexStride_,
+                            vertices,
+                            VkDeviceSize(vertexCount) * vertexStride_);
+        uploadQueue_->write(indexBuffer_, firstIndex * indexSize_, indices,
+                            VkDeviceSize(indexCount) * indexSize_);
+
+        Mesh mesh;
+        mesh.firstIndex = static_cast<uint32_t>(firstIndex);
+        mesh.indexCount = indexCount;
+        mesh.vertexOffset = static_cast<int32_t>(firstVertex);
+        mesh.vertexCount = vertexCount;
+        return mesh;
+    }
+
+    void DrawBatcher::removeMesh(const Mesh &mesh) {
+        vertexRanges_.free(static_cast<VkDeviceSize>(mesh.vertexOffset));
+        indexRanges_.free(mesh.firstIndex);
+    }
+
+    void DrawBatcher::beginFrame(uint32_t frameIndex) {
+        if (frameIndex >= frameCount_) {
+            throw std::runtime_error("Frame index out of range!");
+        }
+        frameIndex_ = frameIndex;
+        drawList_.clear();
+    }
+
+    void DrawBatcher::draw(VkPipeline pipeline, const Mesh &mesh,
+                           uint32_t instanceCount, uint32_t firstInstance) {
+        if (drawList_.drawCount() == maxDraws_) {
+            throw std::runtime_error("Too many draws for the indirect buffer!");
+        }
+
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = mesh.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = mesh.firstIndex;
+        command.vertexOffset = mesh.vertexOffset;
+        command.firstInstance = firstInstance;
+        drawList_.add(pipeline, command);
+    }
+
+    void DrawBatcher::record(VkCommandBuffer commandBuffer) {
+        if (drawList_.drawCount() == 0) {
+            return;
+        }
+
+        constexpr VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+        auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(
+                             indirectBuffer_.allocation.mapped) +
+                         size_t(frameIndex_) * maxDraws_;
+        VkDeviceSize offset = VkDeviceSize(frameIndex_) * maxDraws_ * stride;
+
+        VkDeviceSize vertexOffset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer_.buffer,
+                               &vertexOffset);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer_.buffer, 0,
+                             indexType_);
+
+        for (const DrawList::Batch &batch : drawList_.batches()) {
+            uint32_t count = static_cast<uint32_t>(batch.commands.size());
+            memcpy(commands, batch.commands.data(), count * stride);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              batch.pipeline);
+            // One command at a time without multiDrawIndirect
+            for (uint32_t first = 0; first < count; first += maxDrawCount_) {
+                vkCmdDrawIndexedIndirect(
+                    commandBuffer, indirectBuffer_.buffer,
+                    offset + first * stride,
+                    std::min(count - first, maxDrawCount_), stride);
+            }
+
+            commands += count;
+            offset += count * stride;
+        }
+    }
+
+} // namespace rvivl
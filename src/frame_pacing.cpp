@@ -0,0 +1,206 @@
+#include "rvivl/frame_pacing.hpp"
+
+#include <algorithm>
+#include <span>
+
+namespace rvivl {
+
+    namespace {
+
+        // Preferences ahead of the FIFO fallback
+        constexpr VkPresentModeKHR BALANCED_MODES[] = {
+            VK_PRESENT_MODE_MAILBOX_KHR};
+        constexpr VkPresentModeKHR THROUGHPUT_MODES[] = {
+            VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+            VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+        // Tearing is left to an explicit IMMEDIATE override
+        constexpr VkPresentModeKHR LOW_LATENCY_MODES[] = {
+            VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+
+        // Overlapping or touching
+        bool adjacent(const VkRect2D &a, const VkRect2D &b) {
+            auto right = [](const VkRect2D &r) {
+                return int64_t(r.offset.x) + r.extent.width;
+            };
+            auto bottom = [](const VkRect2D &r) {
+                return int64_t(r.offset.y) + r.extent.height;
+            };
+            return a.offset.x <= right(b) && b.offset.x <= right(a) &&
+                   a.offset.y <= bottom(b) && b.offset.y <= bottom(a);
+        }
+
+        VkRect2D bounds(const VkRect2D &a, const VkRect2D &b) {
+            int64_t left = std::min(a.offset.x, b.offset.x);
+            int64_t top = std::min(a.offset.y, b.offset.y);
+            int64_t right = std::max(int64_t(a.offset.x) + a.extent.width,
+                                     int64_t(b.offset.x) + b.extent.width);
+            int64_t bottom =
+                std::max(int64_t(a.offset.y) + a.extent.height,
+                         int64_t(b.offset.y) + b.extent.height);
+            return {{static_cast<int32_t>(left), static_cast<int32_t>(top)},
+                    {static_cast<uint32_t>(right - left),
+                     static_cast<uint32_t>(bottom - top)}};
+        }
+
+        std::span<const VkPresentModeKHR>
+        preferredPresentModes(PacingMode mode) {
+            switch (mode) {
+            case PacingMode::Throughput:
+                return THROUGHPUT_MODES;
+            case PacingMode::LowLatency:
+                return LOW_LATENCY_MODES;
+            case PacingMode::Balanced:
+                break;
+            }
+            return BALANCED_MODES;
+        }
+
+        bool contains(const std::vector<VkPresentModeKHR> &modes,
+                      VkPresentModeKHR mode) {
+            return std::find(modes.begin(), modes.end(), mode) != modes.end();
+        }
+
+    } // namespace
+
+    uint32_t chooseFramesInFlight(const PacingPolicy &policy) {
+        uint32_t frames = policy.framesInFlight;
+        if (frames == 0) {
+            switch (policy.mode) {
+            case PacingMode::Throughput:
+                frames = 3;
+                break;
+            case PacingMode::LowLatency:
+                frames = 1;
+                break;
+            case PacingMode::Balanced:
+                frames = 2;
+                break;
+            }
+        }
+        return std::clamp(frames, 1u, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    VkPresentModeKHR
+    choosePresentMode(const PacingPolicy &policy,
+                      const std::vector<VkPresentModeKHR> &availableModes) {
+        if (policy.presentMode &&
+            contains(availableModes, *policy.presentMode)) {
+            return *policy.presentMode;
+        }
+
+        for (VkPresentModeKHR mode : preferredPresentModes(policy.mode)) {
+            if (contains(availableModes, mode)) {
+                return mode;
+            }
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    uint32_t chooseImageCount(const PacingPolicy &policy,
+                              VkPresentModeKHR presentMode,
+                              const VkSurfaceCapabilitiesKHR &capabilities) {
+        uint32_t count = policy.imageCount;
+        if (count == 0) {
+            switch (policy.mode) {
+            case PacingMode::Throughput:
+                count = capabilities.minImageCount + 2;
+                break;
+            case PacingMode::LowLatency:
+                // MAILBOX needs a spare image to replace without blocking
+                count = capabilities.minImageCount;
+                if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+                    count = std::max(count, 3u);
+                }
+                break;
+            case PacingMode::Balanced:
+                count = capabilities.minImageCount + 1;
+                break;
+            }
+        }
+
+        count = std::max(count, capabilities.minImageCount);
+        if (capabilities.maxImageCount > 0) {
+            count = std::min(count, capabilities.maxImageCount);
+        }
+        return count;
+    }
+
+    void LatencyTracker::input(Clock::time_point when) {
+        if (!pending_ || when < *pending_) {
+            pending_ = when;
+        }
+    }
+
+    void LatencyTracker::beginFrame() {
+        frameInput_ = pending_;
+        pending_.reset();
+    }
+
+    void LatencyTracker::present(Clock::time_point when) {
+        if (!frameInput_) {
+            return;
+        }
+
+        samples_[next_] = when - *frameInput_;
+        next_ = (next_ + 1) % WINDOW;
+        count_ = std::min(count_ + 1, WINDOW);
+        frameInput_.reset();
+    }
+
+    LatencyStats LatencyTracker::stats() const {
+        LatencyStats stats;
+        stats.samples = count_;
+        if (count_ == 0) {
+            return stats;
+        }
+
+        Clock::duration total{};
+        for (uint32_t i = 0; i < count_; i++) {
+            total += samples_[i];
+            stats.max = std::max(stats.max, samples_[i]);
+        }
+        stats.last = samples_[(next_ + WINDOW - 1) % WINDOW];
+        stats.average = total / count_;
+        return stats;
+    }
+
+    void DamageRegion::add(VkRect2D rect) {
+        if (full_ || rect.extent.width == 0 || rect.extent.height == 0) {
+            return;
+        }
+
+        // Merging can make the rectangle touch others it did not before
+        for (uint32_t i = 0; i < count_;) {
+            if (adjacent(rects_[i], rect)) {
+                rect = bounds(rects_[i], rect);
+                rects_[i] = rects_[--count_];
+                i = 0;
+            } else {
+                i++;
+            }
+        }
+
+        if (count_ == MAX_RECTS) {
+            for (uint32_t i = 0; i < count_; i++) {
+                rect = bounds(rects_[i], rect);
+            }
+            count_ = 0;
+        }
+        rects_[count_++] = rect;
+    }
+
+    void DamageRegion::addAll() {
+        full_ = true;
+        count_ = 0;
+    }
+
+    void DamageRegion::clear() {
+        full_ = false;
+        count_ = 0;
+    }
+
+    std::span<const VkRect2D> DamageRegion::rects() const {
+        return {rects_.data(), count_};
+    }
+
+} // namespace rvivl
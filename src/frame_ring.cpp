@@ -0,0 +1,78 @@
+#include "rvivl/frame_ring.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rvivl {
+
+    FrameRegions::FrameRegions(uint32_t frameCount, VkDeviceSize frameSize,
+                               VkDeviceSize uniformAlignment)
+        : frameCount_(frameCount), frameSize_(frameSize),
+          uniformAlignment_(std::max<VkDeviceSize>(uniformAlignment, 1)) {}
+
+    void FrameRegions::beginFrame(uint32_t frameIndex) {
+        if (frameIndex >= frameCount_) {
+            throw std::runtime_error("Frame index out of range!");
+        }
+        frameIndex_ = frameIndex;
+        head_ = 0;
+    }
+
+    bool FrameRegions::allocate(VkDeviceSize size, VkDeviceSize alignment,
+                                VkDeviceSize &offset) {
+        alignment = std::max<VkDeviceSize>(alignment, 1);
+        VkDeviceSize base = frameSize_ * frameIndex_;
+        VkDeviceSize start =
+            (base + head_ + alignment - 1) / alignment * alignment - base;
+        if (start + size > frameSize_) {
+            return false;
+        }
+        head_ = start + size;
+        offset = base + start;
+        return true;
+    }
+
+    FrameRing::FrameRing(const FrameRingCreateInfo &createInfo)
+        : allocator_(createInfo.allocator),
+          regions_(createInfo.frameCount, createInfo.frameSize,
+                   createInfo.uniformAlignment) {
+        buffer_ = allocator_->createBuffer(
+            createInfo.frameSize * createInfo.frameCount, createInfo.usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    FrameRing::~FrameRing() { allocator_->destroyBuffer(buffer_); }
+
+    void FrameRing::beginFrame(uint32_t frameIndex) {
+        regions_.beginFrame(frameIndex);
+    }
+
+    FrameAllocation FrameRing::allocate(VkDeviceSize size,
+                                        VkDeviceSize alignment) {
+        VkDeviceSize offset = 0;
+        if (!regions_.allocate(size, alignment, offset)) {
+            throw std::runtime_error("Failed to allocate from the frame ring!");
+        }
+        return at(offset);
+    }
+
+    FrameAllocation FrameRing::allocateUniform(VkDeviceSize size,
+                                               VkDeviceSize alignment) {
+        VkDeviceSize offset = 0;
+        if (!regions_.allocateUniform(size, alignment, offset)) {
+            throw std::runtime_error("Failed to allocate from the frame ring!");
+        }
+        return at(offset);
+    }
+
+    FrameAllocation FrameRing::at(VkDeviceSize offset) const {
+        FrameAllocation allocation;
+        allocation.buffer = buffer_.buffer;
+        allocation.offset = offset;
+        allocation.mapped =
+            static_cast<char *>(buffer_.allocation.mapped) + offset;
+        return allocation;
+    }
+
+} // namespace rvivl
@@ -0,0 +1,108 @@
+#include "rvivl/image_decode.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace rvivl {
+
+    namespace {
+
+        // Reads one whitespace separated header number, skipping comments
+        bool readHeaderValue(std::span<const char> data, size_t &pos,
+                             uint32_t &value) {
+            for (;;) {
+                while (pos < data.size() &&
+                       (data[pos] == ' ' || data[pos] == '\t' ||
+                        data[pos] == '\n' || data[pos] == '\r')) {
+                    pos++;
+                }
+                if (pos < data.size() && data[pos] == '#') {
+                    while (pos < data.size() && data[pos] != '\n') {
+                        pos++;
+                    }
+                    continue;
+                }
+                break;
+            }
+
+            if (pos == data.size() || data[pos] < '0' || data[pos] > '9') {
+                return false;
+            }
+            uint64_t result = 0;
+            while (pos < data.size() && data[pos] >= '0' && data[pos] <= '9') {
+                result = result * 10 + uint64_t(data[pos] - '0');
+                if (result > UINT32_MAX) {
+                    return false;
+                }
+                pos++;
+            }
+            value = static_cast<uint32_t>(result);
+            return true;
+        }
+
+    } // namespace
+
+    bool parsePnmHeader(std::span<const char> data, PnmHeader &header) {
+        if (data.size() < 2 || data[0] != 'P' ||
+            (data[1] != '5' && data[1] != '6')) {
+            return false;
+        }
+        header.channels = data[1] == '6' ? 3 : 1;
+
+        size_t pos = 2;
+        if (!readHeaderValue(data, pos, header.width) ||
+            !readHeaderValue(data, pos, header.height) ||
+            !readHeaderValue(data, pos, header.maxValue)) {
+            return false;
+        }
+        // Exactly one whitespace character separates header and pixels
+        if (pos == data.size() || header.width == 0 || header.height == 0 ||
+            header.maxValue == 0 || header.maxValue > 255) {
+            return false;
+        }
+        header.dataOffset = pos + 1;
+        return true;
+    }
+
+    bool decodePnm(std::span<const char> data, DecodedImage &image) {
+        PnmHeader header;
+        if (!parsePnmHeader(data, header)) {
+            return false;
+        }
+        uint32_t width = header.width;
+        uint32_t height = header.height;
+        uint32_t maxValue = header.maxValue;
+        uint32_t channels = header.channels;
+        size_t pos = header.dataOffset;
+
+        uint64_t pixelCount = uint64_t(width) * height;
+        if ((data.size() - pos) / channels < pixelCount) {
+            return false;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(pixelCount * 4);
+
+        const auto *src = reinterpret_cast<const uint8_t *>(data.data() + pos);
+        uint8_t *dst = image.pixels.data();
+        for (uint64_t i = 0; i < pixelCount; i++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                uint32_t value = src[channels == 3 ? c : 0];
+                // Rescale to the full 8-bit range
+                dst[c] = static_cast<uint8_t>(
+                    std::min(value, maxValue) * 255 / maxValue);
+            }
+            dst[3] = 255;
+            src += channels;
+            dst += 4;
+        }
+        return true;
+    }
+
+    uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+        return static_cast<uint32_t>(
+            std::bit_width(std::max({width, height, 1u})));
+    }
+
+} // namespace rvivl
@@ -0,0 +1,292 @@
+#include "rvivl/image_processor.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        // Push constants of the shaders in shaders/*.comp
+        struct YuvPush {
+            uint32_t offsets[4];
+            uint32_t strides[4];
+            float rows[12];
+        };
+
+        struct DownscalePush {
+            int32_t sourceSize[2];
+            int32_t outputSize[2];
+            uint32_t encodeSrgb;
+        };
+
+        struct TonemapPush {
+            int32_t size[2];
+            float exposure;
+            float whitePoint;
+            uint32_t op;
+            uint32_t encodeSrgb;
+        };
+
+        uint32_t byteOffset(VkDeviceSize offset) {
+            if (offset > UINT32_MAX) {
+                throw std::runtime_error("YUV plane offset out of range!");
+            }
+            return static_cast<uint32_t>(offset);
+        }
+
+    } // namespace
+
+    YuvFrame YuvFrame::packed(VkBuffer buffer, uint32_t width,
+                              uint32_t height, YuvLayout layout) {
+        uint32_t chromaWidth = (width + 1) / 2;
+        uint32_t chromaHeight = (height + 1) / 2;
+
+        YuvFrame frame;
+        frame.buffer = buffer;
+        frame.width = width;
+        frame.height = height;
+        frame.layout = layout;
+        frame.yStride = width;
+        frame.uOffset = VkDeviceSize(width) * height;
+        if (layout == YuvLayout::I420) {
+            frame.chromaStride = chromaWidth;
+            frame.vOffset =
+                frame.uOffset + VkDeviceSize(chromaWidth) * chromaHeight;
+        } else {
+            frame.chromaStride = chromaWidth * 2;
+            frame.vOffset = frame.uOffset + 1;
+        }
+        return frame;
+    }
+
+    VkDeviceSize YuvFrame::packedSize(uint32_t width, uint32_t height) {
+        VkDeviceSize chroma =
+            VkDeviceSize((width + 1) / 2) * ((height + 1) / 2);
+        VkDeviceSize size = VkDeviceSize(width) * height + chroma * 2;
+        return (size + 3) & ~VkDeviceSize(3);
+    }
+
+    std::array<float, 12> yuvToRgbMatrix(YuvMatrix matrix, YuvRange range) {
+        float kr = matrix == YuvMatrix::Bt601 ? 0.299f : 0.2126f;
+        float kb = matrix == YuvMatrix::Bt601 ? 0.114f : 0.0722f;
+        float kg = 1.0f - kr - kb;
+
+        // Y' = lumaScale * y + lumaBias, Pb = chromaScale * u + chromaBias
+        float lumaScale = 1.0f;
+        float lumaBias = 0.0f;
+        float chromaScale = 1.0f;
+        float chromaBias = -128.0f / 255.0f;
+        if (range == YuvRange::Limited) {
+            lumaScale = 255.0f / 219.0f;
+            lumaBias = -16.0f / 219.0f;
+            chromaScale = 255.0f / 224.0f;
+            chromaBias = -128.0f / 224.0f;
+        }
+
+        float rFromPr = 2.0f * (1.0f - kr);
+        float bFromPb = 2.0f * (1.0f - kb);
+        float gFromPb = -2.0f * kb * (1.0f - kb) / kg;
+        float gFromPr = -2.0f * kr * (1.0f - kr) / kg;
+
+        return {
+            lumaScale,
+            0.0f,
+            rFromPr * chromaScale,
+            lumaBias + rFromPr * chromaBias,
+
+            lumaScale,
+            gFromPb * chromaScale,
+            gFromPr * chromaScale,
+            lumaBias + (gFromPb + gFromPr) * chromaBias,
+
+            lumaScale,
+            bFromPb * chromaScale,
+            0.0f,
+            lumaBias + bFromPb * chromaBias,
+        };
+    }
+
+    ImageProcessor::ImageProcessor(const ImageProcessorCreateInfo &createInfo)
+        : renderer_(createInfo.renderer),
+          device_(createInfo.renderer->device()) {
+        try {
+            // Shaders use texelFetch, the sampler only has to be valid
+            VkSamplerCreateInfo samplerInfo{};
+            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            samplerInfo.magFilter = VK_FILTER_NEAREST;
+            samplerInfo.minFilter = VK_FILTER_NEAREST;
+            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+            if (vkCreateSampler(device_, &samplerInfo, nullptr, &sampler_) !=
+                VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create image processor sampler!");
+            }
+
+            ComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.renderer = renderer_;
+
+            pipelineInfo.shaderCode = embeddedShader("yuv_to_rgb.comp");
+            pipelineInfo.bindings = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                     VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+            pipelineInfo.pushConstantSize = sizeof(YuvPush);
+            yuvToRgb_ = std::make_unique<ComputePipeline>(pipelineInfo);
+
+            pipelineInfo.shaderCode = embeddedShader("downscale.comp");
+            pipelineInfo.bindings = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                     VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+            pipelineInfo.pushConstantSize = sizeof(DownscalePush);
+            downscale_ = std::make_unique<ComputePipeline>(pipelineInfo);
+
+            pipelineInfo.shaderCode = embeddedShader("tonemap.comp");
+            pipelineInfo.pushConstantSize = sizeof(TonemapPush);
+            tonemap_ = std::make_unique<ComputePipeline>(pipelineInfo);
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    ImageProcessor::~ImageProcessor() { destroy(); }
+
+    void ImageProcessor::destroy() {
+        yuvToRgb_.reset();
+        downscale_.reset();
+        tonemap_.reset();
+        if (sampler_ != VK_NULL_HANDLE) {
+            vkDestroySampler(device_, sampler_, nullptr);
+            sampler_ = VK_NULL_HANDLE;
+        }
+    }
+
+    void ImageProcessor::convertYuv(VkCommandBuffer commandBuffer,
+                                    const YuvFrame &frame,
+                                    VkImageView output) {
+        YuvPush push{};
+        push.offsets[0] = byteOffset(frame.yOffset);
+        push.offsets[1] = byteOffset(frame.uOffset);
+        push.offsets[2] = byteOffset(frame.vOffset);
+        push.offsets[3] = frame.layout == YuvLayout::Nv12 ? 2 : 1;
+        push.strides[0] = frame.yStride;
+        push.strides[1] = frame.chromaStride;
+        push.strides[2] = frame.width;
+        push.strides[3] = frame.height;
+        std::array<float, 12> rows = yuvToRgbMatrix(frame.matrix, frame.range);
+        std::copy(rows.begin(), rows.end(), push.rows);
+
+        ComputeResource resources[] = {
+            ComputeResource::storageBuffer(frame.buffer),
+            ComputeResource::storageImage(output),
+        };
+        yuvToRgb_->bind(commandBuffer, resources, &push);
+        yuvToRgb_->dispatch(commandBuffer, frame.width, frame.height);
+    }
+
+    void ImageProcessor::downscale(VkCommandBuffer commandBuffer,
+                                   VkImageView source,
+                                   VkExtent2D sourceExtent, VkImageView output,
+                                   VkExtent2D outputExtent, bool encodeSrgb,
+                                   VkImageLayout sourceLayout) {
+        DownscalePush push{};
+        push.sourceSize[0] = static_cast<int32_t>(sourceExtent.width);
+        push.sourceSize[1] = static_cast<int32_t>(sourceExtent.height);
+        push.outputSize[0] = static_cast<int32_t>(outputExtent.width);
+        push.outputSize[1] = static_cast<int32_t>(outputExtent.height);
+        push.encodeSrgb = encodeSrgb ? 1 : 0;
+
+        ComputeResource resources[] = {
+            ComputeResource::sampledImage(source, sampler_, sourceLayout),
+            ComputeResource::storageImage(output),
+        };
+        downscale_->bind(commandBuffer, resources, &push);
+        downscale_->dispatch(commandBuffer, outputExtent.width,
+                             outputExtent.height);
+    }
+
+    void ImageProcessor::tonemap(VkCommandBuffer commandBuffer,
+                                 VkImageView source, VkImageView output,
+                                 VkExtent2D extent,
+                                 const TonemapSettings &settings,
+                                 VkImageLayout sourceLayout) {
+        TonemapPush push{};
+        push.size[0] = static_cast<int32_t>(extent.width);
+        push.size[1] = static_cast<int32_t>(extent.height);
+        push.exposure = std::exp2(settings.exposure);
+        push.whitePoint = std::max(settings.whitePoint, 1e-3f);
+        push.op = static_cast<uint32_t>(settings.op);
+        push.encodeSrgb = settings.encodeSrgb ? 1 : 0;
+
+        ComputeResource resources[] = {
+            ComputeResource::sampledImage(source, sampler_, sourceLayout),
+            ComputeResource::storageImage(output),
+        };
+        tonemap_->bind(commandBuffer, resources, &push);
+        tonemap_->dispatch(commandBuffer, extent.width, extent.height);
+    }
+
+    ProcessedImage ImageProcessor::createImage(VkExtent2D extent,
+                                               VkFormat format) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT |
+                          VK_IMAGE_USAGE_SAMPLED_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Written by async compute and sampled by graphics
+        uint32_t queueFamilyIndices[] = {renderer_->graphicsFamily(),
+                                         renderer_->computeFamily()};
+        if (renderer_->asyncCompute()) {
+            imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            imageInfo.queueFamilyIndexCount = 2;
+            imageInfo.pQueueFamilyIndices = queueFamilyIndices;
+        }
+
+        ProcessedImage image;
+        image.extent = extent;
+        image.format = format;
+        image.image = renderer_->allocator().createImage(
+            imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image.image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device_, &viewInfo, nullptr, &image.view) !=
+            VK_SUCCESS) {
+            renderer_->allocator().destroyImage(image.image);
+            throw std::runtime_error(
+                "Failed to create processed image view!");
+        }
+        return image;
+    }
+
+    void ImageProcessor::destroyImage(ProcessedImage &image) {
+        if (image.view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device_, image.view, nullptr);
+            image.view = VK_NULL_HANDLE;
+        }
+        renderer_->allocator().destroyImage(image.image);
+    }
+
+} // namespace rvivl
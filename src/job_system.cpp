@@ -0,0 +1,130 @@
+#include "rvivl/job_system.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace rvivl {
+
+    JobSystem::JobSystem(uint32_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        try {
+            workers_.reserve(threadCount - 1);
+            for (uint32_t worker = 1; worker < threadCount; worker++) {
+                workers_.emplace_back(&JobSystem::workerLoop, this, worker);
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    JobSystem::~JobSystem() { stop(); }
+
+    void JobSystem::stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+    }
+
+    void JobSystem::run(uint32_t jobCount, Job job) {
+        if (jobCount == 0) {
+            return;
+        }
+
+        // Not worth waking anyone for. Errors are handled as in a
+        // threaded batch, the rest of the jobs still run.
+        if (workers_.empty() || jobCount == 1) {
+            std::exception_ptr error;
+            for (uint32_t index = 0; index < jobCount; index++) {
+                try {
+                    job(index, 0);
+                } catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            jobCount_ = jobCount;
+            nextIndex_.store(0, std::memory_order_relaxed);
+            error_ = nullptr;
+            busyWorkers_ = static_cast<uint32_t>(workers_.size());
+            generation_++;
+        }
+        wake_.notify_all();
+
+        execute(0);
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return busyWorkers_ == 0; });
+            job_ = nullptr;
+            error = std::exchange(error_, nullptr);
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void JobSystem::workerLoop(uint32_t worker) {
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] {
+                    return stopping_ || generation_ != seenGeneration;
+                });
+                if (stopping_) {
+                    return;
+                }
+                seenGeneration = generation_;
+            }
+
+            execute(worker);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busyWorkers_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+
+    void JobSystem::execute(uint32_t worker) {
+        for (;;) {
+            uint32_t index = nextIndex_.fetch_add(1, std::memory_order_relaxed);
+            if (index >= jobCount_) {
+                return;
+            }
+
+            try {
+                (*job_)(index, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+    }
+
+} // namespace rvivl
@@ -0,0 +1,430 @@
+#include "rvivl/memory_allocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace rvivl {
+
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void *mapped = nullptr;
+        uint32_t memoryType = 0;
+        // Dedicated blocks hold a single large resource and are released
+        // as soon as it is freed
+        bool dedicated = false;
+        MemoryBlockMetadata metadata;
+
+        MemoryBlock(VkDeviceSize size, VkDeviceSize granularity)
+            : metadata(size, granularity) {}
+    };
+
+    namespace {
+
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        bool onSamePage(VkDeviceSize lastByte, VkDeviceSize firstByte,
+                        VkDeviceSize pageSize) {
+            return lastByte / pageSize == firstByte / pageSize;
+        }
+
+    } // namespace
+
+    MemoryBlockMetadata::MemoryBlockMetadata(VkDeviceSize size,
+                                             VkDeviceSize granularity)
+        : size_(size), granularity_(std::max<VkDeviceSize>(granularity, 1)) {
+        ranges_.emplace(0, Range{size, ResourceKind::Linear, true});
+        freeBySize_.emplace(size, 0);
+    }
+
+    bool MemoryBlockMetadata::allocate(VkDeviceSize size,
+                                       VkDeviceSize alignment,
+                                       ResourceKind kind,
+                                       VkDeviceSize &offset) {
+        alignment = std::max<VkDeviceSize>(alignment, 1);
+
+        // Best fit: try the smallest free ranges that could hold the request
+        // first, skipping those that alignment padding pushes out of reach
+        for (auto it = freeBySize_.lower_bound(size); it != freeBySize_.end();
+             ++it) {
+            const VkDeviceSize rangeOffset = it->second;
+            const VkDeviceSize rangeEnd = rangeOffset + it->first;
+            auto node = ranges_.find(rangeOffset);
+
+            VkDeviceSize candidate = alignUp(rangeOffset, alignment);
+
+            // Free ranges are always merged, so both neighbours are in use
+            if (granularity_ > 1 && node != ranges_.begin()) {
+                auto prev = std::prev(node);
+                if (prev->second.kind != kind &&
+                    onSamePage(prev->first + prev->second.size - 1,
+                               candidate, granularity_)) {
+                    candidate = alignUp(candidate, granularity_);
+                }
+            }
+
+            if (candidate + size > rangeEnd) {
+                continue;
+            }
+
+            auto next = std::next(node);
+            if (granularity_ > 1 && next != ranges_.end() &&
+                next->second.kind != kind &&
+                onSamePage(candidate + size - 1, next->first, granularity_)) {
+                continue;
+            }
+
+            freeBySize_.erase(it);
+            ranges_.erase(node);
+
+            if (candidate > rangeOffset) {
+                ranges_.emplace(rangeOffset,
+                                Range{candidate - rangeOffset,
+                                      ResourceKind::Linear, true});
+                freeBySize_.emplace(candidate - rangeOffset, rangeOffset);
+            }
+            ranges_.emplace(candidate, Range{size, kind, false});
+            if (candidate + size < rangeEnd) {
+                insertFree(candidate + size, rangeEnd - (candidate + size));
+            }
+
+            bytesInUse_ += size;
+            allocationCount_++;
+            offset = candidate;
+            return true;
+        }
+
+        return false;
+    }
+
+    void MemoryBlockMetadata::free(VkDeviceSize offset) {
+        auto node = ranges_.find(offset);
+        if (node == ranges_.end() || node->second.free) {
+            throw std::runtime_error("Freeing memory that is not allocated!");
+        }
+
+        bytesInUse_ -= node->second.size;
+        allocationCount_--;
+
+        VkDeviceSize freeOffset = node->first;
+        VkDeviceSize freeSize = node->second.size;
+
+        auto next = std::next(node);
+        if (next != ranges_.end() && next->second.free) {
+            eraseFree(next->first, next->second.size);
+            freeSize += next->second.size;
+            ranges_.erase(next);
+        }
+
+        if (node != ranges_.begin()) {
+            auto prev = std::prev(node);
+            if (prev->second.free) {
+                eraseFree(prev->first, prev->second.size);
+                freeOffset = prev->first;
+                freeSize += prev->second.size;
+                ranges_.erase(prev);
+            }
+        }
+
+        ranges_.erase(node);
+        insertFree(freeOffset, freeSize);
+    }
+
+    VkDeviceSize MemoryBlockMetadata::largestFreeRange() const {
+        return freeBySize_.empty() ? 0 : freeBySize_.rbegin()->first;
+    }
+
+    void MemoryBlockMetadata::insertFree(VkDeviceSize offset,
+                                         VkDeviceSize size) {
+        ranges_.insert_or_assign(offset,
+                                 Range{size, ResourceKind::Linear, true});
+        freeBySize_.emplace(size, offset);
+    }
+
+    void MemoryBlockMetadata::eraseFree(VkDeviceSize offset,
+                                        VkDeviceSize size) {
+        auto [first, last] = freeBySize_.equal_range(size);
+        for (auto it = first; it != last; ++it) {
+            if (it->second == offset) {
+                freeBySize_.erase(it);
+                return;
+            }
+        }
+    }
+
+    MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice,
+                                     VkDevice device, VkDeviceSize blockSize)
+        : device_(device), blockSize_(blockSize) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity_ = properties.limits.bufferImageGranularity;
+        maxAllocationCount_ = properties.limits.maxMemoryAllocationCount;
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice,
+                                            &memoryProperties_);
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        for (auto &typeBlocks : blocks_) {
+            for (auto &block : typeBlocks) {
+                vkFreeMemory(device_, block->memory, nullptr);
+            }
+        }
+    }
+
+    uint32_t
+    MemoryAllocator::findMemoryType(uint32_t typeFilter,
+                                    VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (memoryProperties_.memoryTypes[i].propertyFlags &
+                 properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    VkDeviceSize MemoryAllocator::preferredBlockSize(uint32_t memoryType) const {
+        // Small heaps (e.g. the 256 MiB BAR window) get smaller blocks so a
+        // single block does not claim a large share of them
+        uint32_t heapIndex = memoryProperties_.memoryTypes[memoryType].heapIndex;
+        VkDeviceSize heapSize = memoryProperties_.memoryHeaps[heapIndex].size;
+        return std::min(blockSize_, std::max<VkDeviceSize>(heapSize / 8, 1));
+    }
+
+    MemoryBlock *MemoryAllocator::createBlock(uint32_t memoryType,
+                                              VkDeviceSize size,
+                                              bool dedicated) {
+        if (deviceMemoryCount_ >= maxAllocationCount_) {
+            throw std::runtime_error(
+                "Device memory allocation limit reached!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        auto block = std::make_unique<MemoryBlock>(size, bufferImageGranularity_);
+        block->memoryType = memoryType;
+        block->dedicated = dedicated;
+
+        VkResult result =
+            vkAllocateMemory(device_, &allocInfo, nullptr, &block->memory);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to allocate device memory block! Error code: " +
+                std::to_string(result));
+        }
+
+        if (memoryProperties_.memoryTypes[memoryType].propertyFlags &
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(device_, block->memory, 0, VK_WHOLE_SIZE, 0,
+                            &block->mapped) != VK_SUCCESS) {
+                vkFreeMemory(device_, block->memory, nullptr);
+                throw std::runtime_error("Failed to map device memory block!");
+            }
+        }
+
+        deviceMemoryCount_++;
+        blocks_[memoryType].push_back(std::move(block));
+        return blocks_[memoryType].back().get();
+    }
+
+    void MemoryAllocator::destroyBlock(MemoryBlock *block) {
+        auto &typeBlocks = blocks_[block->memoryType];
+        auto it = std::find_if(typeBlocks.begin(), typeBlocks.end(),
+                               [block](const std::unique_ptr<MemoryBlock> &b) {
+                                   return b.get() == block;
+                               });
+        vkFreeMemory(device_, block->memory, nullptr);
+        deviceMemoryCount_--;
+        typeBlocks.erase(it);
+    }
+
+    Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                         VkMemoryPropertyFlags properties,
+                                         ResourceKind kind) {
+        uint32_t memoryType =
+            findMemoryType(requirements.memoryTypeBits, properties);
+        VkDeviceSize blockSize = preferredBlockSize(memoryType);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        MemoryBlock *block = nullptr;
+        VkDeviceSize offset = 0;
+
+        if (requirements.size > blockSize / 2) {
+            block = createBlock(memoryType, requirements.size, true);
+            block->metadata.allocate(requirements.size, requirements.alignment,
+                                     kind, offset);
+        } else {
+            for (auto &candidate : blocks_[memoryType]) {
+                if (!candidate->dedicated &&
+                    candidate->metadata.allocate(requirements.size,
+                                                 requirements.alignment, kind,
+                                                 offset)) {
+                    block = candidate.get();
+                    break;
+                }
+            }
+
+            if (block == nullptr) {
+                block = createBlock(memoryType, blockSize, false);
+                block->metadata.allocate(requirements.size,
+                                         requirements.alignment, kind, offset);
+            }
+        }
+
+        Allocation allocation;
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.size = requirements.size;
+        allocation.mapped =
+            block->mapped ? static_cast<char *>(block->mapped) + offset
+                          : nullptr;
+        allocation.block = block;
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation &allocation) {
+        if (allocation.block == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        MemoryBlock *block = allocation.block;
+        block->metadata.free(allocation.offset);
+
+        // Keep one empty block per memory type around so that a scene which
+        // repeatedly frees and recreates resources does not thrash the driver
+        if (block->metadata.empty()) {
+            bool keep = !block->dedicated &&
+                        std::none_of(blocks_[block->memoryType].begin(),
+                                     blocks_[block->memoryType].end(),
+                                     [block](const auto &other) {
+                                         return other.get() != block &&
+                                                !other->dedicated &&
+                                                other->metadata.empty();
+                                     });
+            if (!keep) {
+                destroyBlock(block);
+            }
+        }
+
+        allocation = Allocation{};
+    }
+
+    Buffer MemoryAllocator::createBuffer(VkDeviceSize size,
+                                         VkBufferUsageFlags usage,
+                                         VkMemoryPropertyFlags properties) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        return createBuffer(bufferInfo, properties);
+    }
+
+    Buffer MemoryAllocator::createBuffer(const VkBufferCreateInfo &bufferInfo,
+                                         VkMemoryPropertyFlags properties) {
+        Buffer result;
+        result.size = bufferInfo.size;
+
+        if (vkCreateBuffer(device_, &bufferInfo, nullptr, &result.buffer) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device_, result.buffer, &memRequirements);
+
+        try {
+            result.allocation =
+                allocate(memRequirements, properties, ResourceKind::Linear);
+        } catch (...) {
+            vkDestroyBuffer(device_, result.buffer, nullptr);
+            throw;
+        }
+
+        vkBindBufferMemory(device_, result.buffer, result.allocation.memory,
+                           result.allocation.offset);
+        return result;
+    }
+
+    void MemoryAllocator::destroyBuffer(Buffer &buffer) {
+        if (buffer.buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device_, buffer.buffer, nullptr);
+        }
+        free(buffer.allocation);
+        buffer = Buffer{};
+    }
+
+    Image MemoryAllocator::createImage(const VkImageCreateInfo &imageInfo,
+                                       VkMemoryPropertyFlags properties) {
+        Image result;
+
+        if (vkCreateImage(device_, &imageInfo, nullptr, &result.image) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device_, result.image, &memRequirements);
+
+        ResourceKind kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR
+                                ? ResourceKind::Linear
+                                : ResourceKind::Optimal;
+        try {
+            result.allocation = allocate(memRequirements, properties, kind);
+        } catch (...) {
+            vkDestroyImage(device_, result.image, nullptr);
+            throw;
+        }
+
+        vkBindImageMemory(device_, result.image, result.allocation.memory,
+                          result.allocation.offset);
+        return result;
+    }
+
+    void MemoryAllocator::destroyImage(Image &image) {
+        if (image.image != VK_NULL_HANDLE) {
+            vkDestroyImage(device_, image.image, nullptr);
+        }
+        free(image.allocation);
+        image = Image{};
+    }
+
+    AllocatorStats MemoryAllocator::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        AllocatorStats stats;
+        VkDeviceSize freeBytes = 0;
+        for (const auto &typeBlocks : blocks_) {
+            for (const auto &block : typeBlocks) {
+                const MemoryBlockMetadata &metadata = block->metadata;
+                stats.blockCount++;
+                stats.allocationCount += metadata.allocationCount();
+                stats.bytesReserved += metadata.size();
+                stats.bytesInUse += metadata.bytesInUse();
+                stats.largestFreeRange =
+                    std::max(stats.largestFreeRange, metadata.largestFreeRange());
+                freeBytes += metadata.size() - metadata.bytesInUse();
+            }
+        }
+
+        if (freeBytes > 0) {
+            stats.fragmentation =
+                1.0f - float(stats.largestFreeRange) / float(freeBytes);
+        }
+        return stats;
+    }
+
+} // namespace rvivl
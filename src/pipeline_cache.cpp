@@ -0,0 +1,196 @@
+#include "rvivl/pipeline_cache.hpp"
+#include "rvivl/hash.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace rvivl {
+
+    namespace {
+
+        constexpr char FILE_MAGIC[4] = {'R', 'V', 'P', 'C'};
+
+        // Enough to catch truncated or partially written files
+        uint64_t checksum(const char *data, size_t size) {
+            return fnv1a(data, size);
+        }
+
+        template <typename T>
+        void append(std::vector<char> &out, const T &value) {
+            const char *bytes = reinterpret_cast<const char *>(&value);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        bool read(const std::vector<char> &in, size_t &offset, T &value) {
+            if (in.size() - offset < sizeof(T)) {
+                return false;
+            }
+            memcpy(&value, in.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+    } // namespace
+
+    PipelineCacheKey PipelineCacheKey::query(VkPhysicalDevice physicalDevice) {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        PipelineCacheKey key;
+        key.vendorID = properties.properties.vendorID;
+        key.deviceID = properties.properties.deviceID;
+        key.driverVersion = properties.properties.driverVersion;
+        memcpy(key.pipelineCacheUUID.data(),
+               properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+        memcpy(key.driverUUID.data(), idProperties.driverUUID, VK_UUID_SIZE);
+        return key;
+    }
+
+    std::vector<char> encodePipelineCacheFile(const PipelineCacheKey &key,
+                                              const std::vector<char> &data) {
+        std::vector<char> file;
+        file.insert(file.end(), std::begin(FILE_MAGIC), std::end(FILE_MAGIC));
+        append(file, PipelineCache::FORMAT_VERSION);
+        append(file, key.vendorID);
+        append(file, key.deviceID);
+        append(file, key.driverVersion);
+        append(file, key.pipelineCacheUUID);
+        append(file, key.driverUUID);
+        append(file, uint64_t(data.size()));
+        append(file, checksum(data.data(), data.size()));
+        file.insert(file.end(), data.begin(), data.end());
+        return file;
+    }
+
+    bool decodePipelineCacheFile(const PipelineCacheKey &key,
+                                 const std::vector<char> &file,
+                                 std::vector<char> &data) {
+        size_t offset = 0;
+        char magic[4];
+        uint32_t version = 0;
+        PipelineCacheKey fileKey;
+        uint64_t dataSize = 0;
+        uint64_t dataChecksum = 0;
+
+        if (!read(file, offset, magic) || !read(file, offset, version) ||
+            !read(file, offset, fileKey.vendorID) ||
+            !read(file, offset, fileKey.deviceID) ||
+            !read(file, offset, fileKey.driverVersion) ||
+            !read(file, offset, fileKey.pipelineCacheUUID) ||
+            !read(file, offset, fileKey.driverUUID) ||
+            !read(file, offset, dataSize) ||
+            !read(file, offset, dataChecksum)) {
+            return false;
+        }
+
+        if (memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+            version != PipelineCache::FORMAT_VERSION || !(fileKey == key) ||
+            file.size() - offset != dataSize ||
+            checksum(file.data() + offset, dataSize) != dataChecksum) {
+            return false;
+        }
+
+        data.assign(file.begin() + offset, file.end());
+        return true;
+    }
+
+    PipelineCache::PipelineCache(VkPhysicalDevice physicalDevice,
+                                 VkDevice device, std::string path)
+        : device_(device), path_(std::move(path)),
+          key_(PipelineCacheKey::query(physicalDevice)) {
+        std::vector<char> data;
+        if (!path_.empty()) {
+            std::ifstream file(path_, std::ios::binary);
+            if (file) {
+                std::vector<char> contents(
+                    (std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+                loaded_ = decodePipelineCacheFile(key_, contents, data);
+            }
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = loaded_ ? data.size() : 0;
+        cacheInfo.pInitialData = loaded_ ? data.data() : nullptr;
+
+        VkResult result =
+            vkCreatePipelineCache(device_, &cacheInfo, nullptr, &cache_);
+        if (result != VK_SUCCESS && loaded_) {
+            // The driver has the final say on its own data, start over
+            loaded_ = false;
+            cacheInfo.initialDataSize = 0;
+            cacheInfo.pInitialData = nullptr;
+            result =
+                vkCreatePipelineCache(device_, &cacheInfo, nullptr, &cache_);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+    }
+
+    PipelineCache::~PipelineCache() {
+        if (cache_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(device_, cache_, nullptr);
+        }
+    }
+
+    void PipelineCache::save() const {
+        if (path_.empty()) {
+            return;
+        }
+
+        size_t dataSize = 0;
+        std::vector<char> data;
+        VkResult result =
+            vkGetPipelineCacheData(device_, cache_, &dataSize, nullptr);
+        if (result == VK_SUCCESS) {
+            data.resize(dataSize);
+            result = vkGetPipelineCacheData(device_, cache_, &dataSize,
+                                            data.data());
+            data.resize(dataSize);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to get pipeline cache data!");
+        }
+
+        std::vector<char> contents = encodePipelineCacheFile(key_, data);
+
+        // Write next to the target and rename over it, so a crash midway
+        // never leaves a half written cache behind
+        std::filesystem::path target(path_);
+        std::filesystem::path temporary = target;
+        temporary += ".tmp";
+
+        std::error_code error;
+        if (target.has_parent_path()) {
+            std::filesystem::create_directories(target.parent_path(), error);
+        }
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(contents.data(),
+                       static_cast<std::streamsize>(contents.size()));
+            if (!file) {
+                throw std::runtime_error("Failed to write pipeline cache!");
+            }
+        }
+
+        std::filesystem::rename(temporary, target, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            throw std::runtime_error("Failed to write pipeline cache!");
+        }
+    }
+
+} // namespace rvivl
@@ -0,0 +1,384 @@
+#include "rvivl/pipeline_registry.hpp"
+#include "rvivl/hash.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace rvivl {
+
+    uint64_t PipelineDesc::hash() const {
+        uint64_t result = stateHash();
+        hashCombine(result, vertexShader);
+        hashCombine(result, fragmentShader);
+        hashCombine(result, layout);
+        hashCombine(result, renderPass);
+        return result;
+    }
+
+    uint64_t PipelineDesc::stateHash() const {
+        uint64_t result = FNV_OFFSET_BASIS;
+        hashCombine(result, vertexBindings.size());
+        for (const auto &binding : vertexBindings) {
+            hashCombine(result, binding.binding);
+            hashCombine(result, binding.stride);
+            hashCombine(result, binding.inputRate);
+        }
+        hashCombine(result, vertexAttributes.size());
+        for (const auto &attribute : vertexAttributes) {
+            hashCombine(result, attribute.location);
+            hashCombine(result, attribute.binding);
+            hashCombine(result, attribute.format);
+            hashCombine(result, attribute.offset);
+        }
+
+        hashCombine(result, topology);
+        hashCombine(result, polygonMode);
+        hashCombine(result, cullMode);
+        hashCombine(result, frontFace);
+        hashCombine(result, samples);
+
+        hashCombine(result, blendEnable);
+        hashCombine(result, srcColorBlendFactor);
+        hashCombine(result, dstColorBlendFactor);
+        hashCombine(result, colorBlendOp);
+        hashCombine(result, srcAlphaBlendFactor);
+        hashCombine(result, dstAlphaBlendFactor);
+        hashCombine(result, alphaBlendOp);
+        hashCombine(result, colorWriteMask);
+
+        hashCombine(result, renderPass != VK_NULL_HANDLE);
+        hashCombine(result, subpass);
+        hashCombine(result, colorFormat);
+        return result;
+    }
+
+    bool PipelineDesc::operator==(const PipelineDesc &other) const {
+        auto sameBinding = [](const VkVertexInputBindingDescription &a,
+                              const VkVertexInputBindingDescription &b) {
+            return a.binding == b.binding && a.stride == b.stride &&
+                   a.inputRate == b.inputRate;
+        };
+        auto sameAttribute = [](const VkVertexInputAttributeDescription &a,
+                                const VkVertexInputAttributeDescription &b) {
+            return a.location == b.location && a.binding == b.binding &&
+                   a.format == b.format && a.offset == b.offset;
+        };
+
+        return vertexShader == other.vertexShader &&
+               fragmentShader == other.fragmentShader &&
+               std::equal(vertexBindings.begin(), vertexBindings.end(),
+                          other.vertexBindings.begin(),
+                          other.vertexBindings.end(), sameBinding) &&
+               std::equal(vertexAttributes.begin(), vertexAttributes.end(),
+                          other.vertexAttributes.begin(),
+                          other.vertexAttributes.end(), sameAttribute) &&
+               topology == other.topology &&
+               polygonMode == other.polygonMode &&
+               cullMode == other.cullMode && frontFace == other.frontFace &&
+               samples == other.samples && blendEnable == other.blendEnable &&
+               srcColorBlendFactor == other.srcColorBlendFactor &&
+               dstColorBlendFactor == other.dstColorBlendFactor &&
+               colorBlendOp == other.colorBlendOp &&
+               srcAlphaBlendFactor == other.srcAlphaBlendFactor &&
+               dstAlphaBlendFactor == other.dstAlphaBlendFactor &&
+               alphaBlendOp == other.alphaBlendOp &&
+               colorWriteMask == other.colorWriteMask &&
+               layout == other.layout && renderPass == other.renderPass &&
+               subpass == other.subpass && colorFormat == other.colorFormat;
+    }
+
+    PipelineRegistry::PipelineRegistry(VkDevice device,
+                                       VkPipelineCache pipelineCache)
+        : device_(device), pipelineCache_(pipelineCache),
+          compiler_(&PipelineRegistry::compileLoop, this) {}
+
+    PipelineRegistry::~PipelineRegistry() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        queueChanged_.notify_all();
+        compiler_.join();
+
+        for (auto &[desc, entry] : entries_) {
+            if (entry->pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device_, entry->pipeline, nullptr);
+            }
+        }
+        for (auto &[code, module] : shaderModules_) {
+            vkDestroyShaderModule(device_, module, nullptr);
+        }
+    }
+
+    VkPipeline PipelineRegistry::get(const PipelineDesc &desc) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        Entry *entry = nullptr;
+        auto it = entries_.find(desc);
+        if (it == entries_.end()) {
+            auto inserted = entries_.emplace(desc, std::make_unique<Entry>());
+            entry = inserted.first->second.get();
+            entry->desc = &inserted.first->first;
+        } else {
+            entry = it->second.get();
+            stateChanged_.wait(
+                lock, [entry] { return entry->state != State::Creating; });
+
+            if (entry->state == State::Ready) {
+                return entry->pipeline;
+            }
+            if (entry->state == State::Failed) {
+                throw std::runtime_error("Failed to create graphics pipeline!");
+            }
+        }
+
+        // New, or still queued for the background thread, which skips
+        // entries that are no longer queued when it gets to them
+        entry->state = State::Creating;
+        lock.unlock();
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = createPipeline(desc);
+        } catch (...) {
+            lock.lock();
+            entry->state = State::Failed;
+            stateChanged_.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        entry->pipeline = pipeline;
+        entry->state = State::Ready;
+        stateChanged_.notify_all();
+        return pipeline;
+    }
+
+    VkPipeline PipelineRegistry::tryGet(const PipelineDesc &desc) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(desc);
+        if (it == entries_.end() || it->second->state != State::Ready) {
+            return VK_NULL_HANDLE;
+        }
+        return it->second->pipeline;
+    }
+
+    void PipelineRegistry::prefetch(const PipelineDesc &desc) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (entries_.contains(desc)) {
+                return;
+            }
+
+            auto inserted = entries_.emplace(desc, std::make_unique<Entry>());
+            Entry *entry = inserted.first->second.get();
+            entry->desc = &inserted.first->first;
+            queue_.push_back(entry);
+        }
+        queueChanged_.notify_one();
+    }
+
+    size_t PipelineRegistry::pipelineCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    void PipelineRegistry::compileLoop() {
+        for (;;) {
+            Entry *entry = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                queueChanged_.wait(
+                    lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+
+                entry = queue_.front();
+                queue_.pop_front();
+                if (entry->state != State::Queued) {
+                    continue;
+                }
+                entry->state = State::Creating;
+            }
+
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            State state = State::Ready;
+            try {
+                pipeline = createPipeline(*entry->desc);
+            } catch (const std::exception &) {
+                // Reported by get(), which is where the pipeline is needed
+                state = State::Failed;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entry->pipeline = pipeline;
+                entry->state = state;
+            }
+            stateChanged_.notify_all();
+        }
+    }
+
+    VkShaderModule
+    PipelineRegistry::shaderModule(std::span<const uint32_t> code) {
+        std::string_view key(reinterpret_cast<const char *>(code.data()),
+                             code.size_bytes());
+
+        std::lock_guard<std::mutex> lock(shaderMutex_);
+        auto it = shaderModules_.find(key);
+        if (it != shaderModules_.end()) {
+            return it->second;
+        }
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size_bytes();
+        createInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(device_, &createInfo, nullptr,
+                                 &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shader module!");
+        }
+
+        shaderModules_.emplace(std::string(key), shaderModule);
+        codeHashes_.emplace(shaderModule, fnv1a(key.data(), key.size()));
+        return shaderModule;
+    }
+
+    uint64_t PipelineRegistry::stableHash(const PipelineDesc &desc) const {
+        uint64_t result = desc.stateHash();
+
+        std::lock_guard<std::mutex> lock(shaderMutex_);
+        for (VkShaderModule module : {desc.vertexShader, desc.fragmentShader}) {
+            auto it = codeHashes_.find(module);
+            if (it == codeHashes_.end()) {
+                throw std::runtime_error(
+                    "Shader module is not from the pipeline registry!");
+            }
+            hashCombine(result, it->second);
+        }
+        return result;
+    }
+
+    VkPipeline
+    PipelineRegistry::createPipeline(const PipelineDesc &desc) const {
+        VkPipelineShaderStageCreateInfo shaderStages[2]{};
+        shaderStages[0].sType =
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = desc.vertexShader;
+        shaderStages[0].pName = "main";
+        shaderStages[1].sType =
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = desc.fragmentShader;
+        shaderStages[1].pName = "main";
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount =
+            static_cast<uint32_t>(desc.vertexBindings.size());
+        vertexInputInfo.pVertexBindingDescriptions =
+            desc.vertexBindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount =
+            static_cast<uint32_t>(desc.vertexAttributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions =
+            desc.vertexAttributes.data();
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = desc.topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        // Viewport and scissor are set per frame, so pipelines survive
+        // resizes
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                          VK_DYNAMIC_STATE_SCISSOR};
+
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = desc.polygonMode;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = desc.cullMode;
+        rasterizer.frontFace = desc.frontFace;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = desc.samples;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = desc.colorWriteMask;
+        colorBlendAttachment.blendEnable =
+            desc.blendEnable ? VK_TRUE : VK_FALSE;
+        colorBlendAttachment.srcColorBlendFactor = desc.srcColorBlendFactor;
+        colorBlendAttachment.dstColorBlendFactor = desc.dstColorBlendFactor;
+        colorBlendAttachment.colorBlendOp = desc.colorBlendOp;
+        colorBlendAttachment.srcAlphaBlendFactor = desc.srcAlphaBlendFactor;
+        colorBlendAttachment.dstAlphaBlendFactor = desc.dstAlphaBlendFactor;
+        colorBlendAttachment.alphaBlendOp = desc.alphaBlendOp;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.logicOp = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        VkPipelineRenderingCreateInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &desc.colorFormat;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        if (desc.renderPass == VK_NULL_HANDLE) {
+            pipelineInfo.pNext = &renderingInfo;
+        }
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = desc.layout;
+        pipelineInfo.renderPass = desc.renderPass;
+        pipelineInfo.subpass = desc.subpass;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (vkCreateGraphicsPipelines(device_, pipelineCache_, 1,
+                                      &pipelineInfo, nullptr,
+                                      &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create graphics pipeline!");
+        }
+        return pipeline;
+    }
+
+} // namespace rvivl
@@ -0,0 +1,335 @@
+#include "rvivl/profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        // Numbers threads in the order they first record a scope, which
+        // reads better in a trace than hashed thread ids
+        uint32_t threadNumber() {
+            static std::atomic<uint32_t> next{0};
+            thread_local uint32_t number = next.fetch_add(1);
+            return number;
+        }
+
+        void writeJsonString(std::ostream &out, const char *text) {
+            out << '"';
+            for (const char *c = text; *c != '\0'; c++) {
+                switch (*c) {
+                case '"':
+                    out << "\\\"";
+                    break;
+                case '\\':
+                    out << "\\\\";
+                    break;
+                case '\n':
+                    out << "\\n";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                                      static_cast<unsigned char>(*c));
+                        out << escaped;
+                    } else {
+                        out << *c;
+                    }
+                }
+            }
+            out << '"';
+        }
+
+        // Trace times are in microseconds
+        void writeMicroseconds(std::ostream &out, uint64_t nanoseconds) {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%llu.%03llu",
+                          static_cast<unsigned long long>(nanoseconds / 1000),
+                          static_cast<unsigned long long>(nanoseconds % 1000));
+            out << text;
+        }
+
+    } // namespace
+
+    Profiler::Profiler(const ProfilerCreateInfo &createInfo)
+        : enabled_(createInfo.enabled), start_(Clock::now()),
+          device_(createInfo.device),
+          maxGpuScopes_(createInfo.maxGpuScopes),
+          events_(createInfo.enabled ? std::max(createInfo.maxEvents, 1u)
+                                     : 0) {
+        if (!enabled_ || device_ == VK_NULL_HANDLE || maxGpuScopes_ == 0) {
+            return;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(createInfo.physicalDevice, &properties);
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(createInfo.physicalDevice,
+                                                 &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(
+            createInfo.physicalDevice, &familyCount, families.data());
+
+        uint32_t validBits = createInfo.queueFamily < familyCount
+                                 ? families[createInfo.queueFamily]
+                                       .timestampValidBits
+                                 : 0;
+        if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+            return;
+        }
+        timestampPeriod_ = properties.limits.timestampPeriod;
+        timestampMask_ =
+            validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = createInfo.frameCount * maxGpuScopes_ * 2;
+
+        if (vkCreateQueryPool(device_, &poolInfo, nullptr, &queryPool_) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+
+        frames_.resize(createInfo.frameCount);
+        for (FrameQueries &frame : frames_) {
+            frame.scopes.resize(maxGpuScopes_);
+        }
+        timestamps_.resize(size_t(maxGpuScopes_) * 2);
+    }
+
+    Profiler::~Profiler() { destroy(); }
+
+    void Profiler::destroy() {
+        if (queryPool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_, queryPool_, nullptr);
+            queryPool_ = VK_NULL_HANDLE;
+        }
+    }
+
+    uint64_t Profiler::now() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start_)
+                .count());
+    }
+
+    void Profiler::beginFrame(VkCommandBuffer commandBuffer,
+                              uint32_t frameIndex, uint64_t serial) {
+        if (queryPool_ == VK_NULL_HANDLE) {
+            return;
+        }
+        if (frameIndex >= frames_.size()) {
+            throw std::runtime_error("Frame index out of range!");
+        }
+
+        FrameQueries &frame = frames_[frameIndex];
+        readFrame(frame, frameIndex);
+
+        frame.serial = serial;
+        frame.submitted = 0;
+        frame.scopeCount = 0;
+        frameIndex_ = frameIndex;
+        vkCmdResetQueryPool(commandBuffer, queryPool_,
+                            frameIndex * maxGpuScopes_ * 2,
+                            maxGpuScopes_ * 2);
+    }
+
+    void Profiler::endFrame() {
+        if (frameIndex_ == UINT32_MAX) {
+            return;
+        }
+        frames_[frameIndex_].submitted = now();
+        frameIndex_ = UINT32_MAX;
+    }
+
+    uint32_t Profiler::beginGpuScope(VkCommandBuffer commandBuffer,
+                                     const char *name) {
+        if (frameIndex_ == UINT32_MAX) {
+            return NO_SCOPE;
+        }
+        FrameQueries &frame = frames_[frameIndex_];
+        if (frame.scopeCount == maxGpuScopes_) {
+            return NO_SCOPE;
+        }
+
+        uint32_t scope = frame.scopeCount++;
+        frame.scopes[scope] = {name, false};
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            queryPool_,
+                            (frameIndex_ * maxGpuScopes_ + scope) * 2);
+        return scope;
+    }
+
+    void Profiler::endGpuScope(VkCommandBuffer commandBuffer,
+                               uint32_t scope) {
+        if (scope == NO_SCOPE || frameIndex_ == UINT32_MAX) {
+            return;
+        }
+
+        frames_[frameIndex_].scopes[scope].ended = true;
+        vkCmdWriteTimestamp(commandBuffer,
+                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool_,
+                            (frameIndex_ * maxGpuScopes_ + scope) * 2 + 1);
+    }
+
+    void Profiler::readFrame(FrameQueries &frame, uint32_t frameIndex) {
+        // Nothing was submitted, e.g. the slot is still unused
+        if (frame.submitted == 0 || frame.scopeCount == 0) {
+            return;
+        }
+
+        // The slot's frame has completed, so the results are available
+        // without VK_QUERY_RESULT_WAIT_BIT. Scopes that were never ended
+        // leave their end query unwritten and the call reports
+        // VK_NOT_READY, but still returns the written ones.
+        uint32_t queryCount = frame.scopeCount * 2;
+        VkResult result = vkGetQueryPoolResults(
+            device_, queryPool_, frameIndex * maxGpuScopes_ * 2, queryCount,
+            queryCount * sizeof(uint64_t), timestamps_.data(),
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            return;
+        }
+
+        auto toNanoseconds = [&](uint64_t ticks) {
+            return static_cast<int64_t>(
+                static_cast<double>(ticks & timestampMask_) *
+                timestampPeriod_);
+        };
+
+        int64_t first = INT64_MAX;
+        int64_t last = INT64_MIN;
+        for (uint32_t i = 0; i < frame.scopeCount; i++) {
+            if (frame.scopes[i].ended) {
+                first = std::min(first, toNanoseconds(timestamps_[i * 2]));
+                last = std::max(last, toNanoseconds(timestamps_[i * 2 + 1]));
+            }
+        }
+        if (first > last) {
+            return;
+        }
+
+        gpuOffset_ = std::max(gpuOffset_,
+                              static_cast<int64_t>(frame.submitted) - first);
+        lastGpuFrameTime_ = static_cast<uint64_t>(last - first);
+        lastGpuFrame_ = frame.serial;
+
+        for (uint32_t i = 0; i < frame.scopeCount; i++) {
+            const GpuScope &scope = frame.scopes[i];
+            if (!scope.ended) {
+                continue;
+            }
+
+            int64_t begin = toNanoseconds(timestamps_[i * 2]) + gpuOffset_;
+            int64_t end = toNanoseconds(timestamps_[i * 2 + 1]) + gpuOffset_;
+            ProfileEvent event;
+            event.name = scope.name;
+            event.track = ProfileTrack::Gpu;
+            event.frame = frame.serial;
+            event.begin = static_cast<uint64_t>(std::max<int64_t>(begin, 0));
+            event.end = static_cast<uint64_t>(std::max(end, begin));
+            addEvent(event);
+        }
+    }
+
+    void Profiler::addCpuScope(const char *name, Clock::time_point begin,
+                               Clock::time_point end) {
+        if (!enabled_) {
+            return;
+        }
+
+        auto since = [&](Clock::time_point time) {
+            return static_cast<uint64_t>(std::max<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(time -
+                                                                     start_)
+                    .count(),
+                0));
+        };
+
+        ProfileEvent event;
+        event.name = name;
+        event.track = ProfileTrack::Cpu;
+        event.thread = threadNumber();
+        event.begin = since(begin);
+        event.end = since(end);
+        addEvent(event);
+    }
+
+    void Profiler::addEvent(const ProfileEvent &event) {
+        if (!enabled_) {
+            return;
+        }
+
+        std::lock_guard lock(mutex_);
+        size_t index = (eventHead_ + eventCount_) % events_.size();
+        events_[index] = event;
+        if (eventCount_ < events_.size()) {
+            eventCount_++;
+        } else {
+            eventHead_ = (eventHead_ + 1) % events_.size();
+        }
+    }
+
+    std::vector<ProfileEvent> Profiler::events() const {
+        std::lock_guard lock(mutex_);
+        std::vector<ProfileEvent> result;
+        result.reserve(eventCount_);
+        for (size_t i = 0; i < eventCount_; i++) {
+            result.push_back(events_[(eventHead_ + i) % events_.size()]);
+        }
+        return result;
+    }
+
+    void Profiler::clear() {
+        std::lock_guard lock(mutex_);
+        eventHead_ = 0;
+        eventCount_ = 0;
+    }
+
+    std::chrono::nanoseconds Profiler::lastGpuFrameTime() const {
+        return std::chrono::nanoseconds(lastGpuFrameTime_);
+    }
+
+    void Profiler::writeChromeTrace(std::ostream &out) const {
+        std::vector<ProfileEvent> recorded = events();
+
+        // CPU threads and the GPU queue show up as two processes
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"args\":{\"name\":\"CPU\"}},\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,"
+               "\"args\":{\"name\":\"GPU\"}}";
+
+        for (const ProfileEvent &event : recorded) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name != nullptr ? event.name : "");
+            out << ",\"ph\":\"X\",\"pid\":"
+                << (event.track == ProfileTrack::Gpu ? 2 : 1)
+                << ",\"tid\":" << event.thread << ",\"ts\":";
+            writeMicroseconds(out, event.begin);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end - event.begin);
+            if (event.frame != 0) {
+                out << ",\"args\":{\"frame\":" << event.frame << "}";
+            }
+            out << "}";
+        }
+        out << "\n]}\n";
+    }
+
+    void Profiler::saveChromeTrace(const std::string &path) const {
+        std::ofstream file(path, std::ios::trunc);
+        writeChromeTrace(file);
+        if (!file) {
+            throw std::runtime_error("Failed to write trace file: " + path);
+        }
+    }
+
+} // namespace rvivl
@@ -0,0 +1,776 @@
+#include "rvivl/render_graph.hpp"
+#include "rvivl/renderer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        template <typename From, typename To> struct FlagPair {
+            From from;
+            To to;
+        };
+
+        constexpr FlagPair<VkPipelineStageFlags2, VkPipelineStageFlags>
+            STAGE_PAIRS[] = {
+                {VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT},
+                {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT},
+                {VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT,
+                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT},
+                {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT},
+                {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT},
+                {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
+                {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT},
+                {VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT},
+                {VK_PIPELINE_STAGE_2_COPY_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT},
+                {VK_PIPELINE_STAGE_2_BLIT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT},
+                {VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT},
+                {VK_PIPELINE_STAGE_2_HOST_BIT, VK_PIPELINE_STAGE_HOST_BIT},
+                {VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+                 VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT},
+                {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT},
+        };
+
+        // The sampled and storage flags are synchronization2 refinements of
+        // the shader access flags
+        constexpr FlagPair<VkAccessFlags2, VkAccessFlags> ACCESS_PAIRS[] = {
+            {VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT},
+            {VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_SHADER_READ_BIT},
+            {VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_SHADER_READ_BIT},
+            {VK_ACCESS_2_SHADER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT},
+            {VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT},
+            {VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT,
+             VK_ACCESS_COLOR_ATTACHMENT_READ_BIT},
+            {VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT},
+            {VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT},
+            {VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT},
+            {VK_ACCESS_2_HOST_READ_BIT, VK_ACCESS_HOST_READ_BIT},
+            {VK_ACCESS_2_MEMORY_READ_BIT, VK_ACCESS_MEMORY_READ_BIT},
+            {VK_ACCESS_2_MEMORY_WRITE_BIT, VK_ACCESS_MEMORY_WRITE_BIT},
+        };
+
+        template <typename From, typename To, size_t N>
+        To convertFlags(From flags, const FlagPair<From, To> (&pairs)[N]) {
+            To converted = 0;
+            for (const auto &pair : pairs) {
+                if ((flags & pair.from) == pair.from) {
+                    converted |= pair.to;
+                }
+            }
+            return converted;
+        }
+
+        // An image's accesses since its last write, as the barrier
+        // placement tracks them
+        struct ImageState {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+            // Reads that already wait for the write
+            VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+        };
+
+        // Adds the barrier, if any, that an access described by usage
+        // needs after the accesses in state, and advances state
+        void placeBarrier(RenderGraphImage image, ImageState &state,
+                          const ImageUsageInfo &usage,
+                          std::vector<RenderGraphBarrier> &barriers) {
+            RenderGraphBarrier barrier;
+            barrier.image = image;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = usage.layout;
+
+            if (usage.write || usage.layout != state.layout) {
+                // Writes and layout changes wait for every earlier access
+                barrier.srcStages = state.writeStages | state.readStages;
+                barrier.srcAccess = state.writeAccess;
+                barrier.dstStages = usage.stages;
+                barrier.dstAccess = usage.access;
+                if (barrier.srcStages != VK_PIPELINE_STAGE_2_NONE ||
+                    usage.layout != state.layout) {
+                    barriers.push_back(barrier);
+                }
+
+                // A layout change is a write later accesses have to wait
+                // for, but it has nothing to make available
+                state.layout = usage.layout;
+                state.writeStages = usage.stages;
+                state.writeAccess =
+                    usage.write ? usage.access : VK_ACCESS_2_NONE;
+                state.readStages =
+                    usage.write ? VK_PIPELINE_STAGE_2_NONE : usage.stages;
+                state.readAccess =
+                    usage.write ? VK_ACCESS_2_NONE : usage.access;
+                return;
+            }
+
+            if (state.writeStages == VK_PIPELINE_STAGE_2_NONE ||
+                ((usage.stages & ~state.readStages) == 0 &&
+                 (usage.access & ~state.readAccess) == 0)) {
+                // Nothing to wait for, or an earlier barrier already covers
+                // the read
+                state.readStages |= usage.stages;
+                state.readAccess |= usage.access;
+                return;
+            }
+
+            // Widen the write's barrier to the new reader
+            barrier.srcStages = state.writeStages;
+            barrier.srcAccess = state.writeAccess;
+            barrier.dstStages = state.readStages | usage.stages;
+            barrier.dstAccess = state.readAccess | usage.access;
+            barriers.push_back(barrier);
+            state.readStages = barrier.dstStages;
+            state.readAccess = barrier.dstAccess;
+        }
+
+    } // namespace
+
+    ImageUsageInfo imageUsageInfo(ImageUsage usage) {
+        ImageUsageInfo info;
+        switch (usage) {
+        case ImageUsage::None:
+            break;
+        case ImageUsage::ColorAttachment:
+            info.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+            info.access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                          VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+            info.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            info.write = true;
+            break;
+        case ImageUsage::SampledFragment:
+            info.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+            info.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            info.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            info.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+            break;
+        case ImageUsage::SampledCompute:
+            info.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            info.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            info.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            info.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+            break;
+        case ImageUsage::StorageRead:
+            info.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            info.access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+            info.layout = VK_IMAGE_LAYOUT_GENERAL;
+            info.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+            break;
+        case ImageUsage::StorageWrite:
+            info.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            info.access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+            info.layout = VK_IMAGE_LAYOUT_GENERAL;
+            info.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+            info.write = true;
+            break;
+        case ImageUsage::TransferSrc:
+            info.stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            info.access = VK_ACCESS_2_TRANSFER_READ_BIT;
+            info.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            info.imageUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            break;
+        case ImageUsage::TransferDst:
+            info.stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            info.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            info.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            info.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            info.write = true;
+            break;
+        case ImageUsage::Present:
+            // The semaphore handed to the present orders it after the frame
+            info.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            break;
+        }
+        return info;
+    }
+
+    VkPipelineStageFlags legacyStages(VkPipelineStageFlags2 stages) {
+        return convertFlags(stages, STAGE_PAIRS);
+    }
+
+    VkAccessFlags legacyAccess(VkAccessFlags2 access) {
+        return convertFlags(access, ACCESS_PAIRS);
+    }
+
+    AliasPlan planAliasing(std::span<const TransientImageLifetime> images) {
+        AliasPlan plan;
+        plan.slot.assign(images.size(), 0);
+        plan.previous.assign(images.size(), AliasPlan::NO_IMAGE);
+
+        std::vector<uint32_t> order(images.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return images[a].requirements.size >
+                                    images[b].requirements.size;
+                         });
+
+        std::vector<std::vector<uint32_t>> occupants;
+        for (uint32_t i : order) {
+            const TransientImageLifetime &image = images[i];
+            auto overlaps = [&](uint32_t other) {
+                return images[other].first <= image.last &&
+                       image.first <= images[other].last;
+            };
+
+            uint32_t slot = 0;
+            for (; slot < plan.slots.size(); slot++) {
+                if ((plan.slots[slot].memoryTypeBits &
+                     image.requirements.memoryTypeBits) != 0 &&
+                    std::none_of(occupants[slot].begin(),
+                                 occupants[slot].end(), overlaps)) {
+                    break;
+                }
+            }
+
+            if (slot == plan.slots.size()) {
+                plan.slots.push_back(image.requirements);
+                occupants.emplace_back();
+            } else {
+                VkMemoryRequirements &slotRequirements = plan.slots[slot];
+                slotRequirements.size =
+                    std::max(slotRequirements.size, image.requirements.size);
+                slotRequirements.alignment = std::max(
+                    slotRequirements.alignment, image.requirements.alignment);
+                slotRequirements.memoryTypeBits &=
+                    image.requirements.memoryTypeBits;
+            }
+            occupants[slot].push_back(i);
+            plan.slot[i] = slot;
+        }
+
+        for (std::vector<uint32_t> &slotImages : occupants) {
+            std::sort(slotImages.begin(), slotImages.end(),
+                      [&](uint32_t a, uint32_t b) {
+                          return images[a].first < images[b].first;
+                      });
+            for (size_t i = 1; i < slotImages.size(); i++) {
+                plan.previous[slotImages[i]] = slotImages[i - 1];
+            }
+        }
+        return plan;
+    }
+
+    RenderGraph::RenderGraph(const RenderGraphCreateInfo &createInfo)
+        : renderer_(createInfo.renderer) {
+        if (renderer_ != nullptr) {
+            device_ = renderer_->device();
+        }
+    }
+
+    RenderGraph::~RenderGraph() { destroy(); }
+
+    void RenderGraph::destroy() {
+        for (Physical &physical : retired_) {
+            destroyPhysical(physical);
+        }
+        retired_.clear();
+        destroyPhysical(physical_);
+    }
+
+    void RenderGraph::destroyPhysical(Physical &physical) {
+        for (VkImageView view : physical.views) {
+            if (view != VK_NULL_HANDLE) {
+                vkDestroyImageView(device_, view, nullptr);
+            }
+        }
+        for (VkImage image : physical.images) {
+            if (image != VK_NULL_HANDLE) {
+                vkDestroyImage(device_, image, nullptr);
+            }
+        }
+        for (Allocation &allocation : physical.memory) {
+            renderer_->allocator().free(allocation);
+        }
+        physical = {};
+    }
+
+    void RenderGraph::releaseRetired() {
+        uint64_t completed = renderer_->completedSerial();
+        std::erase_if(retired_, [&](Physical &physical) {
+            if (physical.serial > completed) {
+                return false;
+            }
+            destroyPhysical(physical);
+            return true;
+        });
+    }
+
+    RenderGraphImage RenderGraph::createImage(std::string name,
+                                              VkExtent2D extent,
+                                              VkFormat format) {
+        ImageDecl image;
+        image.name = std::move(name);
+        image.extent = extent;
+        image.format = format;
+        images_.push_back(std::move(image));
+        return static_cast<RenderGraphImage>(images_.size() - 1);
+    }
+
+    RenderGraphImage RenderGraph::importImage(std::string name, VkImage image,
+                                              VkImageView view,
+                                              VkExtent2D extent,
+                                              ImageUsage before,
+                                              ImageUsage after) {
+        ImageDecl decl;
+        decl.name = std::move(name);
+        decl.extent = extent;
+        decl.imported = true;
+        decl.before = before;
+        decl.after = after;
+        decl.image = image;
+        decl.view = view;
+        images_.push_back(std::move(decl));
+        return static_cast<RenderGraphImage>(images_.size() - 1);
+    }
+
+    void RenderGraph::addPass(std::string name,
+                              std::span<const ImageAccess> accesses,
+                              Record record, bool sideEffects) {
+        for (const ImageAccess &access : accesses) {
+            if (access.image >= images_.size()) {
+                throw std::runtime_error("Unknown render graph image!");
+            }
+        }
+
+        PassDecl pass;
+        pass.name = std::move(name);
+        pass.accesses.assign(accesses.begin(), accesses.end());
+        pass.record = std::move(record);
+        pass.sideEffects = sideEffects;
+        passes_.push_back(std::move(pass));
+    }
+
+    CompiledRenderGraph RenderGraph::compile() const {
+        // Accesses of one image in a pass merged into one
+        struct PassUse {
+            RenderGraphImage image;
+            ImageUsageInfo usage;
+            bool reads;
+        };
+        std::vector<std::vector<PassUse>> uses(passes_.size());
+        for (size_t p = 0; p < passes_.size(); p++) {
+            for (const ImageAccess &access : passes_[p].accesses) {
+                if (access.usage == ImageUsage::None) {
+                    continue;
+                }
+                ImageUsageInfo usage = imageUsageInfo(access.usage);
+                auto use = std::find_if(
+                    uses[p].begin(), uses[p].end(),
+                    [&](const PassUse &u) { return u.image == access.image; });
+                if (use == uses[p].end()) {
+                    uses[p].push_back({access.image, usage, !usage.write});
+                    continue;
+                }
+                if (use->usage.layout != usage.layout) {
+                    throw std::runtime_error(
+                        "Conflicting layouts for an image in one pass!");
+                }
+                use->usage.stages |= usage.stages;
+                use->usage.access |= usage.access;
+                use->usage.imageUsage |= usage.imageUsage;
+                use->usage.write = use->usage.write || usage.write;
+                use->reads = use->reads || !usage.write;
+            }
+        }
+
+        // Walk back from the outputs, keeping the passes whose writes are
+        // read later. A pass that only writes an image ends the interest
+        // in what came before.
+        std::vector<bool> live(passes_.size(), false);
+        std::vector<bool> needed(images_.size(), false);
+        for (size_t p = passes_.size(); p-- > 0;) {
+            bool isLive = passes_[p].sideEffects;
+            for (const PassUse &use : uses[p]) {
+                if (use.usage.write &&
+                    (images_[use.image].imported || needed[use.image])) {
+                    isLive = true;
+                }
+            }
+            if (!isLive) {
+                continue;
+            }
+            live[p] = true;
+            for (const PassUse &use : uses[p]) {
+                needed[use.image] = use.reads;
+            }
+        }
+
+        CompiledRenderGraph compiled;
+        compiled.lifetimes.resize(images_.size());
+
+        std::vector<ImageState> states(images_.size());
+        for (size_t i = 0; i < images_.size(); i++) {
+            if (!images_[i].imported) {
+                continue;
+            }
+            // Whatever came before the graph is ordered by the submission,
+            // so its accesses only need waiting for, not making visible
+            ImageUsageInfo before = imageUsageInfo(images_[i].before);
+            states[i].layout = before.layout;
+            if (before.write) {
+                states[i].writeStages = before.stages;
+                states[i].writeAccess = before.access;
+            } else {
+                states[i].readStages = before.stages;
+                states[i].readAccess = before.access;
+            }
+        }
+
+        for (size_t p = 0; p < passes_.size(); p++) {
+            if (!live[p]) {
+                continue;
+            }
+            CompiledRenderGraph::Pass pass;
+            pass.pass = static_cast<uint32_t>(p);
+            pass.firstBarrier = static_cast<uint32_t>(compiled.barriers.size());
+            uint32_t passIndex = static_cast<uint32_t>(compiled.passes.size());
+
+            for (const PassUse &use : uses[p]) {
+                CompiledRenderGraph::Lifetime &lifetime =
+                    compiled.lifetimes[use.image];
+                size_t barrierCount = compiled.barriers.size();
+                placeBarrier(use.image, states[use.image], use.usage,
+                             compiled.barriers);
+
+                if (lifetime.first == CompiledRenderGraph::UNUSED) {
+                    lifetime.first = passIndex;
+                    if (compiled.barriers.size() > barrierCount) {
+                        lifetime.firstBarrier =
+                            static_cast<uint32_t>(barrierCount);
+                    }
+                }
+                lifetime.last = passIndex;
+                lifetime.imageUsage |= use.usage.imageUsage;
+                lifetime.accessStages |= use.usage.stages;
+                if (use.usage.write) {
+                    lifetime.writeAccess |= use.usage.access;
+                }
+            }
+
+            pass.barrierCount =
+                static_cast<uint32_t>(compiled.barriers.size()) -
+                pass.firstBarrier;
+            compiled.passes.push_back(pass);
+        }
+
+        compiled.finalBarrier = static_cast<uint32_t>(compiled.barriers.size());
+        for (size_t i = 0; i < images_.size(); i++) {
+            if (!images_[i].imported || images_[i].after == ImageUsage::None ||
+                compiled.lifetimes[i].first == CompiledRenderGraph::UNUSED) {
+                continue;
+            }
+            placeBarrier(static_cast<RenderGraphImage>(i), states[i],
+                         imageUsageInfo(images_[i].after), compiled.barriers);
+        }
+        compiled.finalBarrierCount =
+            static_cast<uint32_t>(compiled.barriers.size()) -
+            compiled.finalBarrier;
+        return compiled;
+    }
+
+    void RenderGraph::realize(CompiledRenderGraph &compiled) {
+        // Transient images some live pass uses
+        std::vector<TransientKey> keys;
+        std::vector<uint32_t> declared;
+        transientIndex_.assign(images_.size(), AliasPlan::NO_IMAGE);
+        for (size_t i = 0; i < images_.size(); i++) {
+            const CompiledRenderGraph::Lifetime &lifetime =
+                compiled.lifetimes[i];
+            if (images_[i].imported ||
+                lifetime.first == CompiledRenderGraph::UNUSED) {
+                continue;
+            }
+            transientIndex_[i] = static_cast<uint32_t>(keys.size());
+            declared.push_back(static_cast<uint32_t>(i));
+            keys.push_back({images_[i].extent, images_[i].format,
+                            lifetime.imageUsage, lifetime.first,
+                            lifetime.last});
+        }
+
+        if (keys != physical_.keys) {
+            // The last frames may still use the old images
+            if (!physical_.keys.empty()) {
+                physical_.serial = renderer_->submittedSerial() + 1;
+                retired_.push_back(std::move(physical_));
+                physical_ = {};
+            }
+
+            try {
+                std::vector<TransientImageLifetime> lifetimes(keys.size());
+                for (size_t t = 0; t < keys.size(); t++) {
+                    VkImageCreateInfo imageInfo{};
+                    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                    imageInfo.format = keys[t].format;
+                    imageInfo.extent = {keys[t].extent.width,
+                                        keys[t].extent.height, 1};
+                    imageInfo.mipLevels = 1;
+                    imageInfo.arrayLayers = 1;
+                    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                    imageInfo.usage = keys[t].usage;
+                    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+                    VkImage image = VK_NULL_HANDLE;
+                    if (vkCreateImage(device_, &imageInfo, nullptr, &image) !=
+                        VK_SUCCESS) {
+                        throw std::runtime_error(
+                            "Failed to create transient image!");
+                    }
+                    physical_.images.push_back(image);
+
+                    lifetimes[t].first = keys[t].first;
+                    lifetimes[t].last = keys[t].last;
+                    vkGetImageMemoryRequirements(device_, image,
+                                                 &lifetimes[t].requirements);
+                    physical_.unaliasedBytes += lifetimes[t].requirements.size;
+                }
+
+                physical_.plan = planAliasing(lifetimes);
+                for (const VkMemoryRequirements &slot :
+                     physical_.plan.slots) {
+                    physical_.memory.push_back(renderer_->allocator().allocate(
+                        slot, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        ResourceKind::Optimal));
+                }
+                physical_.slotStages.assign(physical_.plan.slots.size(),
+                                            VK_PIPELINE_STAGE_2_NONE);
+                physical_.slotAccess.assign(physical_.plan.slots.size(),
+                                            VK_ACCESS_2_NONE);
+
+                for (size_t t = 0; t < keys.size(); t++) {
+                    const Allocation &memory =
+                        physical_.memory[physical_.plan.slot[t]];
+                    if (vkBindImageMemory(device_, physical_.images[t],
+                                          memory.memory,
+                                          memory.offset) != VK_SUCCESS) {
+                        throw std::runtime_error(
+                            "Failed to bind transient image memory!");
+                    }
+
+                    VkImageViewCreateInfo viewInfo{};
+                    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                    viewInfo.image = physical_.images[t];
+                    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                    viewInfo.format = keys[t].format;
+                    viewInfo.subresourceRange.aspectMask =
+                        VK_IMAGE_ASPECT_COLOR_BIT;
+                    viewInfo.subresourceRange.levelCount = 1;
+                    viewInfo.subresourceRange.layerCount = 1;
+
+                    VkImageView view = VK_NULL_HANDLE;
+                    if (vkCreateImageView(device_, &viewInfo, nullptr,
+                                          &view) != VK_SUCCESS) {
+                        throw std::runtime_error(
+                            "Failed to create transient image view!");
+                    }
+                    physical_.views.push_back(view);
+                }
+                physical_.keys = std::move(keys);
+            } catch (...) {
+                destroyPhysical(physical_);
+                throw;
+            }
+        }
+
+        // Each image starts in UNDEFINED, so its first barrier only has to
+        // wait for the accesses of the image that had the memory before,
+        // in this execution or the last one
+        const AliasPlan &plan = physical_.plan;
+        std::vector<bool> followed(declared.size(), false);
+        for (size_t t = 0; t < declared.size(); t++) {
+            const CompiledRenderGraph::Lifetime &lifetime =
+                compiled.lifetimes[declared[t]];
+            uint32_t slot = plan.slot[t];
+            VkPipelineStageFlags2 stages = physical_.slotStages[slot];
+            VkAccessFlags2 access = physical_.slotAccess[slot];
+            if (plan.previous[t] != AliasPlan::NO_IMAGE) {
+                const CompiledRenderGraph::Lifetime &previous =
+                    compiled.lifetimes[declared[plan.previous[t]]];
+                stages = previous.accessStages;
+                access = previous.writeAccess;
+                followed[plan.previous[t]] = true;
+            }
+            if (lifetime.firstBarrier != CompiledRenderGraph::UNUSED) {
+                RenderGraphBarrier &barrier =
+                    compiled.barriers[lifetime.firstBarrier];
+                barrier.srcStages |= stages;
+                barrier.srcAccess |= access;
+            }
+        }
+        for (size_t t = 0; t < declared.size(); t++) {
+            if (!followed[t]) {
+                const CompiledRenderGraph::Lifetime &lifetime =
+                    compiled.lifetimes[declared[t]];
+                physical_.slotStages[plan.slot[t]] = lifetime.accessStages;
+                physical_.slotAccess[plan.slot[t]] = lifetime.writeAccess;
+            }
+        }
+    }
+
+    void RenderGraph::recordBarriers(
+        VkCommandBuffer commandBuffer,
+        std::span<const RenderGraphBarrier> barriers) {
+        if (barriers.empty()) {
+            return;
+        }
+
+        VkImageSubresourceRange range{};
+        range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        range.levelCount = VK_REMAINING_MIP_LEVELS;
+        range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+        if (PFN_vkCmdPipelineBarrier2 pipelineBarrier2 =
+                renderer_->cmdPipelineBarrier2()) {
+            std::vector<VkImageMemoryBarrier2> imageBarriers(barriers.size());
+            for (size_t i = 0; i < barriers.size(); i++) {
+                const RenderGraphBarrier &barrier = barriers[i];
+                VkImageMemoryBarrier2 &imageBarrier = imageBarriers[i];
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                imageBarrier.srcStageMask = barrier.srcStages;
+                imageBarrier.srcAccessMask = barrier.srcAccess;
+                imageBarrier.dstStageMask = barrier.dstStages;
+                imageBarrier.dstAccessMask = barrier.dstAccess;
+                imageBarrier.oldLayout = barrier.oldLayout;
+                imageBarrier.newLayout = barrier.newLayout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = image(barrier.image);
+                imageBarrier.subresourceRange = range;
+            }
+
+            VkDependencyInfo dependencyInfo{};
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependencyInfo.imageMemoryBarrierCount =
+                static_cast<uint32_t>(imageBarriers.size());
+            dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+            pipelineBarrier2(commandBuffer, &dependencyInfo);
+            return;
+        }
+
+        // One vkCmdPipelineBarrier takes a single pair of stage masks for
+        // the whole batch
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkImageMemoryBarrier> imageBarriers(barriers.size());
+        for (size_t i = 0; i < barriers.size(); i++) {
+            const RenderGraphBarrier &barrier = barriers[i];
+            srcStages |= legacyStages(barrier.srcStages);
+            dstStages |= legacyStages(barrier.dstStages);
+
+            VkImageMemoryBarrier &imageBarrier = imageBarriers[i];
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = legacyAccess(barrier.srcAccess);
+            imageBarrier.dstAccessMask = legacyAccess(barrier.dstAccess);
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = image(barrier.image);
+            imageBarrier.subresourceRange = range;
+        }
+        if (srcStages == 0) {
+            srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        if (dstStages == 0) {
+            dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0,
+                             nullptr, 0, nullptr,
+                             static_cast<uint32_t>(imageBarriers.size()),
+                             imageBarriers.data());
+    }
+
+    void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+        if (renderer_ == nullptr) {
+            throw std::runtime_error("Render graph has no renderer!");
+        }
+
+        CompiledRenderGraph compiled = compile();
+        releaseRetired();
+        realize(compiled);
+
+        std::span<const RenderGraphBarrier> barriers(compiled.barriers);
+        stats_ = {};
+        for (const CompiledRenderGraph::Pass &pass : compiled.passes) {
+            recordBarriers(commandBuffer,
+                           barriers.subspan(pass.firstBarrier,
+                                            pass.barrierCount));
+            stats_.barrierBatches += pass.barrierCount > 0 ? 1 : 0;
+            passes_[pass.pass].record(commandBuffer, *this);
+        }
+        recordBarriers(commandBuffer,
+                       barriers.subspan(compiled.finalBarrier,
+                                        compiled.finalBarrierCount));
+        stats_.barrierBatches += compiled.finalBarrierCount > 0 ? 1 : 0;
+        physical_.serial = renderer_->submittedSerial() + 1;
+
+        stats_.passes = static_cast<uint32_t>(compiled.passes.size());
+        stats_.culledPasses =
+            static_cast<uint32_t>(passes_.size() - compiled.passes.size());
+        stats_.imageBarriers = static_cast<uint32_t>(compiled.barriers.size());
+        stats_.transientImages =
+            static_cast<uint32_t>(physical_.images.size());
+        stats_.memorySlots = static_cast<uint32_t>(physical_.memory.size());
+        for (const VkMemoryRequirements &slot : physical_.plan.slots) {
+            stats_.transientBytes += slot.size;
+        }
+        stats_.unaliasedBytes = physical_.unaliasedBytes;
+
+        images_.clear();
+        passes_.clear();
+    }
+
+    VkImage RenderGraph::image(RenderGraphImage image) const {
+        if (image >= images_.size()) {
+            throw std::runtime_error("Unknown render graph image!");
+        }
+        if (images_[image].imported) {
+            return images_[image].image;
+        }
+        if (image >= transientIndex_.size() ||
+            transientIndex_[image] == AliasPlan::NO_IMAGE) {
+            throw std::runtime_error("Render graph image is not in use!");
+        }
+        return physical_.images[transientIndex_[image]];
+    }
+
+    VkImageView RenderGraph::view(RenderGraphImage image) const {
+        if (image >= images_.size()) {
+            throw std::runtime_error("Unknown render graph image!");
+        }
+        if (images_[image].imported) {
+            return images_[image].view;
+        }
+        if (image >= transientIndex_.size() ||
+            transientIndex_[image] == AliasPlan::NO_IMAGE) {
+            throw std::runtime_error("Render graph image is not in use!");
+        }
+        return physical_.views[transientIndex_[image]];
+    }
+
+    VkExtent2D RenderGraph::extent(RenderGraphImage image) const {
+        if (image >= images_.size()) {
+            throw std::runtime_error("Unknown render graph image!");
+        }
+        return images_[image].extent;
+    }
+
+} // namespace rvivl
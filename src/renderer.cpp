@@ -0,0 +1,1713 @@
+#include "rvivl/renderer.hpp"
+#include "rvivl/vertex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace rvivl {
+
+    namespace {
+
+        struct QueueFamilyIndices {
+            uint32_t graphicsFamily = UINT32_MAX;
+            uint32_t presentFamily = UINT32_MAX;
+            // Falls back to the graphics family without a transfer-only one
+            uint32_t transferFamily = UINT32_MAX;
+            // Likewise without a compute family that lacks graphics
+            uint32_t computeFamily = UINT32_MAX;
+            // Headless rendering has no surface to present to
+            bool needsPresent = true;
+
+            bool isComplete() const {
+                return graphicsFamily != UINT32_MAX &&
+                       (!needsPresent || presentFamily != UINT32_MAX);
+            }
+        };
+
+        QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device,
+                                             VkSurfaceKHR surface) {
+            QueueFamilyIndices indices;
+            indices.needsPresent = surface != VK_NULL_HANDLE;
+
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
+                                                     nullptr);
+
+            std::vector<VkQueueFamilyProperties> queueFamilies(
+                queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(
+                device, &queueFamilyCount, queueFamilies.data());
+
+            for (uint32_t i = 0; i < queueFamilyCount; i++) {
+                VkQueueFlags flags = queueFamilies[i].queueFlags;
+                // Compute passes are recorded into the frame's command
+                // buffer. Every implementation has a family with both.
+                if ((flags & VK_QUEUE_GRAPHICS_BIT) &&
+                    (flags & VK_QUEUE_COMPUTE_BIT) &&
+                    indices.graphicsFamily == UINT32_MAX) {
+                    indices.graphicsFamily = i;
+                }
+
+                // A family with transfer but neither graphics nor compute
+                // usually maps to the copy engines
+                if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+                    !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+                    indices.transferFamily == UINT32_MAX) {
+                    indices.transferFamily = i;
+                }
+
+                // Compute without graphics runs on separate hardware
+                // queues where the device has them
+                if ((flags & VK_QUEUE_COMPUTE_BIT) &&
+                    !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+                    indices.computeFamily == UINT32_MAX) {
+                    indices.computeFamily = i;
+                }
+
+                if (indices.needsPresent &&
+                    indices.presentFamily == UINT32_MAX) {
+                    VkBool32 presentSupport = false;
+                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
+                                                         &presentSupport);
+                    if (presentSupport) {
+                        indices.presentFamily = i;
+                    }
+                }
+            }
+
+            if (indices.transferFamily == UINT32_MAX) {
+                indices.transferFamily = indices.graphicsFamily;
+            }
+            if (indices.computeFamily == UINT32_MAX) {
+                indices.computeFamily = indices.graphicsFamily;
+            }
+
+            return indices;
+        }
+
+        VkSemaphore createTimeline(VkDevice device) {
+            VkSemaphoreTypeCreateInfo typeInfo{};
+            typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = &typeInfo;
+
+            VkSemaphore timeline = VK_NULL_HANDLE;
+            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr,
+                                  &timeline) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create timeline semaphore!");
+            }
+            return timeline;
+        }
+
+        void waitTimeline(VkDevice device, VkSemaphore timeline,
+                          uint64_t value) {
+            if (value == 0) {
+                return;
+            }
+
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &timeline;
+            waitInfo.pValues = &value;
+
+            vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+        }
+
+        struct SwapChainSupportDetails {
+            VkSurfaceCapabilitiesKHR capabilities;
+            std::vector<VkSurfaceFormatKHR> formats;
+            std::vector<VkPresentModeKHR> presentModes;
+        };
+
+        SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device,
+                                                      VkSurfaceKHR surface) {
+            SwapChainSupportDetails details;
+
+            vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface,
+                                                      &details.capabilities);
+
+            uint32_t formatCount = 0;
+            vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount,
+                                                 nullptr);
+            details.formats.resize(formatCount);
+            vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount,
+                                                 details.formats.data());
+
+            uint32_t presentModeCount = 0;
+            vkGetPhysicalDeviceSurfacePresentModesKHR(
+                device, surface, &presentModeCount, nullptr);
+            details.presentModes.resize(presentModeCount);
+            vkGetPhysicalDeviceSurfacePresentModesKHR(
+                device, surface, &presentModeCount,
+                details.presentModes.data());
+
+            return details;
+        }
+
+        VkSurfaceFormatKHR chooseSwapSurfaceFormat(
+            const std::vector<VkSurfaceFormatKHR> &availableFormats) {
+            for (const auto &availableFormat : availableFormats) {
+                if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB &&
+                    availableFormat.colorSpace ==
+                        VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+                    return availableFormat;
+                }
+            }
+
+            return availableFormats[0];
+        }
+
+        VkExtent2D
+        chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities,
+                         const std::function<VkExtent2D()> &drawableExtent) {
+            if (capabilities.currentExtent.width !=
+                std::numeric_limits<uint32_t>::max()) {
+                return capabilities.currentExtent;
+            }
+
+            VkExtent2D actualExtent = drawableExtent();
+            actualExtent.width =
+                std::clamp(actualExtent.width, capabilities.minImageExtent.width,
+                           capabilities.maxImageExtent.width);
+            actualExtent.height = std::clamp(
+                actualExtent.height, capabilities.minImageExtent.height,
+                capabilities.maxImageExtent.height);
+            return actualExtent;
+        }
+
+        // Uploads and frame synchronization rely on Vulkan 1.2 timeline
+        // semaphores
+        bool supportsTimelineSemaphores(VkPhysicalDevice device) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device, &properties);
+            if (properties.apiVersion < VK_API_VERSION_1_2) {
+                return false;
+            }
+
+            VkPhysicalDeviceVulkan12Features features12{};
+            features12.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &features12;
+            vkGetPhysicalDeviceFeatures2(device, &features);
+
+            return features12.timelineSemaphore == VK_TRUE;
+        }
+
+        bool
+        supportsDeviceExtensions(VkPhysicalDevice device,
+                                 const std::vector<const char *> &extensions) {
+            uint32_t extensionCount = 0;
+            vkEnumerateDeviceExtensionProperties(device, nullptr,
+                                                 &extensionCount, nullptr);
+            std::vector<VkExtensionProperties> availableExtensions(
+                extensionCount);
+            vkEnumerateDeviceExtensionProperties(
+                device, nullptr, &extensionCount, availableExtensions.data());
+
+            for (const char *requiredExtension : extensions) {
+                bool found = std::any_of(
+                    availableExtensions.begin(), availableExtensions.end(),
+                    [&](const VkExtensionProperties &extension) {
+                        return strcmp(requiredExtension,
+                                      extension.extensionName) == 0;
+                    });
+                if (!found) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Whether a Vulkan 1.3 feature is core, only available through its
+        // KHR extension or missing
+        enum class FeatureSupport { None, Core, Extension };
+
+        FeatureSupport queryDynamicRenderingSupport(VkPhysicalDevice device) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device, &properties);
+
+            bool core = properties.apiVersion >= VK_API_VERSION_1_3;
+            bool extension = supportsDeviceExtensions(
+                device, {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME});
+            if (!core && !extension) {
+                return FeatureSupport::None;
+            }
+
+            VkPhysicalDeviceDynamicRenderingFeatures dynamicRendering{};
+            dynamicRendering.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &dynamicRendering;
+            vkGetPhysicalDeviceFeatures2(device, &features);
+
+            if (dynamicRendering.dynamicRendering != VK_TRUE) {
+                return FeatureSupport::None;
+            }
+            return core ? FeatureSupport::Core : FeatureSupport::Extension;
+        }
+
+        FeatureSupport querySynchronization2Support(VkPhysicalDevice device) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device, &properties);
+
+            bool core = properties.apiVersion >= VK_API_VERSION_1_3;
+            bool extension = supportsDeviceExtensions(
+                device, {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME});
+            if (!core && !extension) {
+                return FeatureSupport::None;
+            }
+
+            VkPhysicalDeviceSynchronization2Features synchronization2{};
+            synchronization2.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &synchronization2;
+            vkGetPhysicalDeviceFeatures2(device, &features);
+
+            if (synchronization2.synchronization2 != VK_TRUE) {
+                return FeatureSupport::None;
+            }
+            return core ? FeatureSupport::Core : FeatureSupport::Extension;
+        }
+
+    } // namespace
+
+    Renderer::Renderer(const RendererCreateInfo &createInfo)
+        : drawableExtent_(createInfo.drawableExtent),
+          clearColor_(createInfo.clearColor), headless_(createInfo.headless),
+          enableReadback_(createInfo.headless && createInfo.enableReadback),
+          dynamicRendering_(createInfo.dynamicRendering),
+          descriptorIndexing_(createInfo.bindless),
+          pacing_(createInfo.pacing),
+          framesInFlight_(chooseFramesInFlight(createInfo.pacing)) {
+        try {
+            createInstance(createInfo);
+            pickPhysicalDevice();
+            createLogicalDevice();
+            createUploadQueue(createInfo);
+            createPipelineCache(createInfo);
+            if (headless_) {
+                createOffscreenImages(createInfo);
+            } else {
+                createSwapchain();
+            }
+            createImageViews();
+            createRenderPass();
+            createPipeline(createInfo);
+            createFramebuffers();
+            createCommandPool();
+            createProfiler(createInfo);
+            createDescriptors();
+            createFrameArena(createInfo);
+            jobs_ = std::make_unique<JobSystem>(createInfo.recordingThreads);
+            createFrameData();
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    Renderer::~Renderer() { destroy(); }
+
+    void Renderer::createInstance(const RendererCreateInfo &createInfo) {
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = createInfo.applicationName;
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.pEngineName = "rvivl";
+        appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
+        appInfo.apiVersion = VK_API_VERSION_1_3;
+
+        VkInstanceCreateInfo instanceInfo{};
+        instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &appInfo;
+        instanceInfo.enabledExtensionCount =
+            static_cast<uint32_t>(createInfo.instanceExtensions.size());
+        instanceInfo.ppEnabledExtensionNames =
+            createInfo.instanceExtensions.data();
+
+        VkResult result = vkCreateInstance(&instanceInfo, nullptr, &instance_);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to create Vulkan instance! Error code: " +
+                std::to_string(result));
+        }
+
+        if (headless_) {
+            return;
+        }
+
+        if (!createInfo.createSurface) {
+            throw std::runtime_error("No surface factory provided!");
+        }
+        surface_ = createInfo.createSurface(instance_);
+        if (surface_ == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to create Vulkan surface!");
+        }
+    }
+
+    void Renderer::pickPhysicalDevice() {
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(instance_, &deviceCount, nullptr);
+        if (deviceCount == 0) {
+            throw std::runtime_error("Failed to find GPUs with Vulkan support!");
+        }
+
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(instance_, &deviceCount, devices.data());
+
+        if (!headless_) {
+            deviceExtensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
+        for (const auto &device : devices) {
+            QueueFamilyIndices indices = findQueueFamilies(device, surface_);
+            if (!indices.isComplete() ||
+                !supportsDeviceExtensions(device, deviceExtensions_) ||
+                !supportsTimelineSemaphores(device)) {
+                continue;
+            }
+
+            if (!headless_) {
+                SwapChainSupportDetails swapChainSupport =
+                    querySwapChainSupport(device, surface_);
+                if (swapChainSupport.formats.empty() ||
+                    swapChainSupport.presentModes.empty()) {
+                    continue;
+                }
+            }
+
+            // Falls back to a render pass where unsupported
+            if (dynamicRendering_) {
+                FeatureSupport support = queryDynamicRenderingSupport(device);
+                dynamicRendering_ = support != FeatureSupport::None;
+                if (support == FeatureSupport::Extension) {
+                    deviceExtensions_.push_back(
+                        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+                }
+            }
+
+            // Optional, RenderGraph falls back to vkCmdPipelineBarrier
+            FeatureSupport synchronization2 =
+                querySynchronization2Support(device);
+            synchronization2_ = synchronization2 != FeatureSupport::None;
+            if (synchronization2 == FeatureSupport::Extension) {
+                deviceExtensions_.push_back(
+                    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+            }
+
+            // Optional, endFrame() presents whole images without it
+            incrementalPresent_ =
+                !headless_ &&
+                supportsDeviceExtensions(
+                    device, {VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME});
+            if (incrementalPresent_) {
+                deviceExtensions_.push_back(
+                    VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+            }
+
+            // Falls back to per-frame descriptor pools where unsupported
+            descriptorIndexing_ =
+                descriptorIndexing_ && DescriptorHeap::supported(device);
+
+            physicalDevice_ = device;
+            graphicsFamily_ = indices.graphicsFamily;
+            presentFamily_ = headless_ ? indices.graphicsFamily
+                                       : indices.presentFamily;
+            transferFamily_ = indices.transferFamily;
+            computeFamily_ = indices.computeFamily;
+            return;
+        }
+
+        throw std::runtime_error("Failed to find a suitable GPU!");
+    }
+
+    void Renderer::createLogicalDevice() {
+        std::vector<uint32_t> uniqueQueueFamilies = {
+            graphicsFamily_, presentFamily_, transferFamily_, computeFamily_};
+        std::sort(uniqueQueueFamilies.begin(), uniqueQueueFamilies.end());
+        uniqueQueueFamilies.erase(
+            std::unique(uniqueQueueFamilies.begin(), uniqueQueueFamilies.end()),
+            uniqueQueueFamilies.end());
+
+        float queuePriority = 1.0f;
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+        for (uint32_t queueFamily : uniqueQueueFamilies) {
+            VkDeviceQueueCreateInfo queueCreateInfo{};
+            queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreateInfo.queueFamilyIndex = queueFamily;
+            queueCreateInfo.queueCount = 1;
+            queueCreateInfo.pQueuePriorities = &queuePriority;
+            queueCreateInfos.push_back(queueCreateInfo);
+        }
+
+        // Optional features used by DrawBatcher when present
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice_, &supportedFeatures);
+
+        VkPhysicalDeviceFeatures deviceFeatures{};
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance =
+            supportedFeatures.drawIndirectFirstInstance;
+
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.timelineSemaphore = VK_TRUE;
+        if (descriptorIndexing_) {
+            DescriptorHeap::enableFeatures(features12);
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        VkPhysicalDeviceSynchronization2Features synchronization2Features{};
+        synchronization2Features.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+        synchronization2Features.synchronization2 = VK_TRUE;
+
+        void **next = &features12.pNext;
+        if (dynamicRendering_) {
+            *next = &dynamicRenderingFeatures;
+            next = &dynamicRenderingFeatures.pNext;
+        }
+        if (synchronization2_) {
+            *next = &synchronization2Features;
+        }
+
+        VkDeviceCreateInfo deviceCreateInfo{};
+        deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceCreateInfo.pNext = &features12;
+        deviceCreateInfo.queueCreateInfoCount =
+            static_cast<uint32_t>(queueCreateInfos.size());
+        deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+        deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
+        deviceCreateInfo.enabledExtensionCount =
+            static_cast<uint32_t>(deviceExtensions_.size());
+        deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions_.data();
+
+        VkResult result =
+            vkCreateDevice(physicalDevice_, &deviceCreateInfo, nullptr, &device_);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to create logical device! Error code: " +
+                std::to_string(result));
+        }
+        enabledFeatures_ = deviceFeatures;
+
+        vkGetDeviceQueue(device_, graphicsFamily_, 0, &graphicsQueue_);
+        vkGetDeviceQueue(device_, presentFamily_, 0, &presentQueue_);
+        vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
+        vkGetDeviceQueue(device_, computeFamily_, 0, &computeQueue_);
+
+        if (dynamicRendering_) {
+            // Core in Vulkan 1.3, otherwise only the KHR entry points exist
+            cmdBeginRendering_ = reinterpret_cast<PFN_vkCmdBeginRendering>(
+                vkGetDeviceProcAddr(device_, "vkCmdBeginRendering"));
+            cmdEndRendering_ = reinterpret_cast<PFN_vkCmdEndRendering>(
+                vkGetDeviceProcAddr(device_, "vkCmdEndRendering"));
+            if (cmdBeginRendering_ == nullptr || cmdEndRendering_ == nullptr) {
+                cmdBeginRendering_ = reinterpret_cast<PFN_vkCmdBeginRendering>(
+                    vkGetDeviceProcAddr(device_, "vkCmdBeginRenderingKHR"));
+                cmdEndRendering_ = reinterpret_cast<PFN_vkCmdEndRendering>(
+                    vkGetDeviceProcAddr(device_, "vkCmdEndRenderingKHR"));
+            }
+            if (cmdBeginRendering_ == nullptr || cmdEndRendering_ == nullptr) {
+                throw std::runtime_error(
+                    "Failed to load dynamic rendering commands!");
+            }
+        }
+
+        if (synchronization2_) {
+            cmdPipelineBarrier2_ = reinterpret_cast<PFN_vkCmdPipelineBarrier2>(
+                vkGetDeviceProcAddr(device_, "vkCmdPipelineBarrier2"));
+            if (cmdPipelineBarrier2_ == nullptr) {
+                cmdPipelineBarrier2_ =
+                    reinterpret_cast<PFN_vkCmdPipelineBarrier2>(
+                        vkGetDeviceProcAddr(device_,
+                                            "vkCmdPipelineBarrier2KHR"));
+            }
+            synchronization2_ = cmdPipelineBarrier2_ != nullptr;
+        }
+
+        allocator_ = std::make_unique<MemoryAllocator>(physicalDevice_, device_);
+    }
+
+    void Renderer::createUploadQueue(const RendererCreateInfo &createInfo) {
+        UploadQueueCreateInfo uploadInfo{};
+        uploadInfo.device = device_;
+        uploadInfo.allocator = allocator_.get();
+        uploadInfo.transferQueue = transferQueue_;
+        uploadInfo.transferFamily = transferFamily_;
+        uploadInfo.graphicsFamily = graphicsFamily_;
+        uploadInfo.stagingSize = createInfo.stagingSize;
+
+        uploadQueue_ = std::make_unique<UploadQueue>(uploadInfo);
+    }
+
+    void Renderer::createPipelineCache(const RendererCreateInfo &createInfo) {
+        pipelineCache_ = std::make_unique<PipelineCache>(
+            physicalDevice_, device_, createInfo.pipelineCachePath);
+    }
+
+    void Renderer::createSwapchain() {
+        SwapChainSupportDetails swapChainSupport =
+            querySwapChainSupport(physicalDevice_, surface_);
+
+        VkSurfaceFormatKHR surfaceFormat =
+            chooseSwapSurfaceFormat(swapChainSupport.formats);
+        VkPresentModeKHR presentMode =
+            choosePresentMode(pacing_, swapChainSupport.presentModes);
+        VkExtent2D extent =
+            chooseSwapExtent(swapChainSupport.capabilities, drawableExtent_);
+
+        uint32_t imageCount = chooseImageCount(pacing_, presentMode,
+                                               swapChainSupport.capabilities);
+
+        VkSwapchainCreateInfoKHR swapchainCreateInfo{};
+        swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        swapchainCreateInfo.surface = surface_;
+        swapchainCreateInfo.minImageCount = imageCount;
+        swapchainCreateInfo.imageFormat = surfaceFormat.format;
+        swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
+        swapchainCreateInfo.imageExtent = extent;
+        swapchainCreateInfo.imageArrayLayers = 1;
+        swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+        uint32_t queueFamilyIndices[] = {graphicsFamily_, presentFamily_};
+        if (graphicsFamily_ != presentFamily_) {
+            swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+            swapchainCreateInfo.queueFamilyIndexCount = 2;
+            swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
+        } else {
+            swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+
+        swapchainCreateInfo.preTransform =
+            swapChainSupport.capabilities.currentTransform;
+        swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        swapchainCreateInfo.presentMode = presentMode;
+        swapchainCreateInfo.clipped = VK_TRUE;
+        // Lets the driver hand over resources from the swapchain being
+        // replaced, which stays valid until it is destroyed
+        swapchainCreateInfo.oldSwapchain = swapchain_;
+
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        if (vkCreateSwapchainKHR(device_, &swapchainCreateInfo, nullptr,
+                                 &swapchain) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create swap chain!");
+        }
+        swapchain_ = swapchain;
+
+        vkGetSwapchainImagesKHR(device_, swapchain_, &imageCount, nullptr);
+        images_.resize(imageCount);
+        vkGetSwapchainImagesKHR(device_, swapchain_, &imageCount,
+                                images_.data());
+
+        colorFormat_ = surfaceFormat.format;
+        presentMode_ = presentMode;
+        extent_ = extent;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        renderFinished_.resize(images_.size(), VK_NULL_HANDLE);
+        for (auto &semaphore : renderFinished_) {
+            if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr,
+                                  &semaphore) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create render finished semaphore!");
+            }
+        }
+    }
+
+    void Renderer::createOffscreenImages(const RendererCreateInfo &createInfo) {
+        colorFormat_ = createInfo.colorFormat;
+        extent_ = createInfo.extent;
+
+        // One image per frame in flight, so the frame's serial also guards
+        // the image against being overwritten while it is still being read
+        // back
+        offscreenImages_.resize(framesInFlight_);
+        images_.resize(framesInFlight_, VK_NULL_HANDLE);
+
+        for (uint32_t i = 0; i < framesInFlight_; i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = colorFormat_;
+            imageInfo.extent = {extent_.width, extent_.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            offscreenImages_[i] = allocator_->createImage(
+                imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            images_[i] = offscreenImages_[i].image;
+        }
+    }
+
+    void Renderer::createImageViews() {
+        imageViews_.resize(images_.size(), VK_NULL_HANDLE);
+        for (size_t i = 0; i < images_.size(); i++) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = images_[i];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = colorFormat_;
+            viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device_, &viewInfo, nullptr,
+                                  &imageViews_[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create image views!");
+            }
+        }
+    }
+
+    void Renderer::createRenderPass() {
+        if (dynamicRendering_) {
+            return;
+        }
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = colorFormat_;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Headless images end up as the source of the readback copy
+        colorAttachment.finalLayout = headless_
+                                          ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                          : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+
+        VkSubpassDependency dependencies[2]{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        // Make the color writes visible to the readback copy
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = enableReadback_ ? 2 : 1;
+        renderPassInfo.pDependencies = dependencies;
+
+        if (vkCreateRenderPass(device_, &renderPassInfo, nullptr,
+                               &renderPass_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render pass!");
+        }
+    }
+
+    void Renderer::createPipeline(const RendererCreateInfo &createInfo) {
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 0;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+        if (vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
+                                   &pipelineLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+
+        pipelines_ = std::make_unique<PipelineRegistry>(
+            device_, pipelineCache_->handle());
+
+        pipelineDesc_.vertexShader =
+            pipelines_->shaderModule(createInfo.vertexShaderCode);
+        pipelineDesc_.fragmentShader =
+            pipelines_->shaderModule(createInfo.fragmentShaderCode);
+        pipelineDesc_.vertexBindings = {createInfo.vertexInput.binding};
+        pipelineDesc_.vertexAttributes = createInfo.vertexInput.attributes;
+        pipelineDesc_.layout = pipelineLayout_;
+        pipelineDesc_.renderPass = renderPass_;
+        pipelineDesc_.colorFormat = colorFormat_;
+
+        pipeline_ = pipelines_->get(pipelineDesc_);
+
+        if (!createInfo.instancedVertexShaderCode.empty()) {
+            auto instanceAttributes = Instance::getAttributeDescriptions();
+
+            PipelineDesc instancedDesc = pipelineDesc_;
+            instancedDesc.vertexShader =
+                pipelines_->shaderModule(createInfo.instancedVertexShaderCode);
+            instancedDesc.vertexBindings.push_back(
+                Instance::getBindingDescription());
+            instancedDesc.vertexAttributes.insert(
+                instancedDesc.vertexAttributes.end(),
+                instanceAttributes.begin(), instanceAttributes.end());
+
+            instancedPipeline_ = pipelines_->get(instancedDesc);
+        }
+    }
+
+    void Renderer::createFramebuffers() {
+        if (dynamicRendering_) {
+            return;
+        }
+
+        framebuffers_.resize(imageViews_.size(), VK_NULL_HANDLE);
+        for (size_t i = 0; i < imageViews_.size(); i++) {
+            VkImageView attachments[] = {imageViews_[i]};
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = renderPass_;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = attachments;
+            framebufferInfo.width = extent_.width;
+            framebufferInfo.height = extent_.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(device_, &framebufferInfo, nullptr,
+                                    &framebuffers_[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create framebuffer!");
+            }
+        }
+    }
+
+    void Renderer::createCommandPool() {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = graphicsFamily_;
+
+        if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool_) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create command pool!");
+        }
+
+        poolInfo.queueFamilyIndex = computeFamily_;
+        if (vkCreateCommandPool(device_, &poolInfo, nullptr,
+                                &computeCommandPool_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute command pool!");
+        }
+    }
+
+    void Renderer::createFrameData() {
+        frames_.resize(framesInFlight_);
+
+        frameTimeline_ = createTimeline(device_);
+        computeTimeline_ = createTimeline(device_);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (auto &frame : frames_) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = commandPool_;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(device_, &allocInfo,
+                                         &frame.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate command buffers!");
+            }
+
+            allocInfo.commandPool = computeCommandPool_;
+            if (vkAllocateCommandBuffers(device_, &allocInfo,
+                                         &frame.computeCommandBuffer) !=
+                VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate compute command buffers!");
+            }
+
+            // Acquire cannot signal a timeline semaphore, so windowed
+            // frames keep a binary one
+            if (!headless_ &&
+                vkCreateSemaphore(device_, &semaphoreInfo, nullptr,
+                                  &frame.imageAvailable) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create synchronization objects for a frame!");
+            }
+
+            frame.workers.resize(jobs_->threadCount());
+            for (auto &worker : frame.workers) {
+                VkCommandPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                poolInfo.queueFamilyIndex = graphicsFamily_;
+
+                if (vkCreateCommandPool(device_, &poolInfo, nullptr,
+                                        &worker.pool) != VK_SUCCESS) {
+                    throw std::runtime_error(
+                        "Failed to create worker command pool!");
+                }
+            }
+            frame.secondaries.reserve(jobs_->threadCount() * 2);
+
+            if (enableReadback_) {
+                frame.readback = createBuffer(
+                    VkDeviceSize(extent_.width) * extent_.height * 4,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            }
+        }
+    }
+
+    void Renderer::createProfiler(const RendererCreateInfo &createInfo) {
+        ProfilerCreateInfo profilerInfo{};
+        profilerInfo.physicalDevice = physicalDevice_;
+        profilerInfo.device = device_;
+        profilerInfo.queueFamily = graphicsFamily_;
+        profilerInfo.frameCount = framesInFlight_;
+        profilerInfo.enabled = createInfo.profiling;
+
+        profiler_ = std::make_unique<Profiler>(profilerInfo);
+    }
+
+    void Renderer::createDescriptors() {
+        FrameDescriptorAllocatorCreateInfo frameInfo{};
+        frameInfo.device = device_;
+        frameInfo.frameCount = framesInFlight_;
+        frameDescriptors_ =
+            std::make_unique<FrameDescriptorAllocator>(frameInfo);
+
+        if (descriptorIndexing_) {
+            DescriptorHeapCreateInfo heapInfo{};
+            heapInfo.physicalDevice = physicalDevice_;
+            heapInfo.device = device_;
+            descriptorHeap_ = std::make_unique<DescriptorHeap>(heapInfo);
+        }
+    }
+
+    void Renderer::createFrameArena(const RendererCreateInfo &createInfo) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
+
+        FrameRingCreateInfo arenaInfo{};
+        arenaInfo.allocator = allocator_.get();
+        arenaInfo.frameCount = framesInFlight_;
+        arenaInfo.frameSize = createInfo.frameArenaSize;
+        arenaInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        arenaInfo.uniformAlignment =
+            properties.limits.minUniformBufferOffsetAlignment;
+
+        frameArena_ = std::make_unique<FrameRing>(arenaInfo);
+    }
+
+    bool Renderer::recreateSwapchain() {
+        swapchainDirty_ = true;
+
+        // A minimized window has nothing to present to until it is restored
+        VkSurfaceCapabilitiesKHR capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice_, surface_,
+                                                  &capabilities);
+        VkExtent2D extent = chooseSwapExtent(capabilities, drawableExtent_);
+        if (extent.width == 0 || extent.height == 0) {
+            return false;
+        }
+
+        // Everything submitted so far may still render to or present the
+        // old images, the next submission is the first that cannot
+        RetiredSwapchain retired;
+        retired.swapchain = swapchain_;
+        retired.imageViews = std::exchange(imageViews_, {});
+        retired.framebuffers = std::exchange(framebuffers_, {});
+        retired.renderFinished = std::exchange(renderFinished_, {});
+        retired.serial = submitSerial_ + 1;
+        images_.clear();
+
+        // The old swapchain is retired once the new one replaces it. If
+        // none could be created it is still swapchain_, which destroy()
+        // takes care of, so the retired entry must not hold it too.
+        auto retire = [&] {
+            if (swapchain_ == retired.swapchain) {
+                retired.swapchain = VK_NULL_HANDLE;
+            }
+            retiredSwapchains_.push_back(std::move(retired));
+        };
+        try {
+            createSwapchain();
+        } catch (...) {
+            retire();
+            throw;
+        }
+        retire();
+
+        createImageViews();
+        createFramebuffers();
+
+        swapchainDirty_ = false;
+        return true;
+    }
+
+    void Renderer::releaseRetiredSwapchains() {
+        std::erase_if(retiredSwapchains_, [&](RetiredSwapchain &retired) {
+            if (retired.serial > completedSerial_) {
+                return false;
+            }
+
+            for (auto framebuffer : retired.framebuffers) {
+                vkDestroyFramebuffer(device_, framebuffer, nullptr);
+            }
+            for (auto imageView : retired.imageViews) {
+                vkDestroyImageView(device_, imageView, nullptr);
+            }
+            for (auto semaphore : retired.renderFinished) {
+                vkDestroySemaphore(device_, semaphore, nullptr);
+            }
+            vkDestroySwapchainKHR(device_, retired.swapchain, nullptr);
+            return true;
+        });
+    }
+
+    void Renderer::destroy() {
+        jobs_.reset();
+
+        if (device_ != VK_NULL_HANDLE) {
+            vkDeviceWaitIdle(device_);
+
+            completedSerial_ = submitSerial_;
+            releaseRetiredSwapchains();
+
+            for (auto &frame : frames_) {
+                for (auto &worker : frame.workers) {
+                    if (worker.pool != VK_NULL_HANDLE) {
+                        vkDestroyCommandPool(device_, worker.pool, nullptr);
+                    }
+                }
+                if (frame.imageAvailable != VK_NULL_HANDLE) {
+                    vkDestroySemaphore(device_, frame.imageAvailable, nullptr);
+                }
+                destroyBuffer(frame.readback);
+            }
+            frames_.clear();
+            for (VkSemaphore *timeline : {&frameTimeline_, &computeTimeline_}) {
+                if (*timeline != VK_NULL_HANDLE) {
+                    vkDestroySemaphore(device_, *timeline, nullptr);
+                    *timeline = VK_NULL_HANDLE;
+                }
+            }
+            profiler_.reset();
+            descriptorHeap_.reset();
+            frameDescriptors_.reset();
+            frameArena_.reset();
+
+            if (commandPool_ != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device_, commandPool_, nullptr);
+            }
+            if (computeCommandPool_ != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device_, computeCommandPool_, nullptr);
+            }
+            for (auto framebuffer : framebuffers_) {
+                if (framebuffer != VK_NULL_HANDLE) {
+                    vkDestroyFramebuffer(device_, framebuffer, nullptr);
+                }
+            }
+            framebuffers_.clear();
+
+            // Joins the background compiler before the cache is saved
+            pipelines_.reset();
+            pipeline_ = VK_NULL_HANDLE;
+            instancedPipeline_ = VK_NULL_HANDLE;
+            if (pipelineCache_) {
+                // Losing the cache only costs the next startup its compile
+                // time, so a failed save is not worth failing shutdown for
+                try {
+                    pipelineCache_->save();
+                } catch (const std::exception &) {
+                }
+                pipelineCache_.reset();
+            }
+            if (pipelineLayout_ != VK_NULL_HANDLE) {
+                vkDestroyPipelineLayout(device_, pipelineLayout_, nullptr);
+            }
+            if (renderPass_ != VK_NULL_HANDLE) {
+                vkDestroyRenderPass(device_, renderPass_, nullptr);
+            }
+
+            for (auto semaphore : renderFinished_) {
+                if (semaphore != VK_NULL_HANDLE) {
+                    vkDestroySemaphore(device_, semaphore, nullptr);
+                }
+            }
+            renderFinished_.clear();
+            for (auto imageView : imageViews_) {
+                if (imageView != VK_NULL_HANDLE) {
+                    vkDestroyImageView(device_, imageView, nullptr);
+                }
+            }
+            imageViews_.clear();
+            if (swapchain_ != VK_NULL_HANDLE) {
+                vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+            }
+            images_.clear();
+            for (auto &image : offscreenImages_) {
+                allocator_->destroyImage(image);
+            }
+            offscreenImages_.clear();
+
+            uploadQueue_.reset();
+            allocator_.reset();
+
+            vkDestroyDevice(device_, nullptr);
+            device_ = VK_NULL_HANDLE;
+        }
+
+        if (instance_ != VK_NULL_HANDLE) {
+            if (surface_ != VK_NULL_HANDLE) {
+                vkDestroySurfaceKHR(instance_, surface_, nullptr);
+            }
+            vkDestroyInstance(instance_, nullptr);
+            instance_ = VK_NULL_HANDLE;
+        }
+    }
+
+    bool Renderer::beginFrame(VkSubpassContents contents) {
+        if (!beginFrame(contents, [](VkCommandBuffer) {})) {
+            return false;
+        }
+        // Nothing was recorded ahead of the render pass
+        uploadWaitStages_ = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        return true;
+    }
+
+    bool Renderer::beginFrame(
+        VkSubpassContents contents,
+        FunctionRef<void(VkCommandBuffer commandBuffer)> beforeRendering) {
+        CpuScope scope(*profiler_, "beginFrame");
+        FrameData &frame = frames_[currentFrame_];
+
+        // Wait for the previous use of this frame slot to finish. The
+        // timeline counts completed submissions, so reading it back also
+        // picks up the frames that finished after this slot's.
+        waitTimeline(device_, frameTimeline_, frame.serial);
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device_, frameTimeline_, &completed);
+        completedSerial_ = std::max(completedSerial_, completed);
+        releaseRetiredSwapchains();
+        frameDescriptors_->beginFrame(currentFrame_);
+        frameArena_->beginFrame(currentFrame_);
+        if (descriptorHeap_) {
+            descriptorHeap_->release(completedSerial_);
+        }
+
+        if (headless_) {
+            imageIndex_ = currentFrame_;
+        } else {
+            if (swapchainDirty_ && !recreateSwapchain()) {
+                return false;
+            }
+
+            VkResult result = vkAcquireNextImageKHR(
+                device_, swapchain_, UINT64_MAX, frame.imageAvailable,
+                VK_NULL_HANDLE, &imageIndex_);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                // The semaphore was left unsignalled, so it can be used
+                // again with the new swapchain
+                if (!recreateSwapchain()) {
+                    return false;
+                }
+                result = vkAcquireNextImageKHR(
+                    device_, swapchain_, UINT64_MAX, frame.imageAvailable,
+                    VK_NULL_HANDLE, &imageIndex_);
+            }
+
+            if (result == VK_SUBOPTIMAL_KHR) {
+                // Still presentable, replace it after this frame
+                swapchainDirty_ = true;
+            } else if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                swapchainDirty_ = true;
+                return false;
+            } else if (result != VK_SUCCESS) {
+                throw std::runtime_error("Failed to acquire swap chain image!");
+            }
+        }
+
+        // Input marked from here on is too late for this frame
+        latency_.beginFrame();
+
+        vkResetCommandBuffer(frame.commandBuffer, 0);
+        computeRecording_ = false;
+        computeWait_ = 0;
+        // Dispatches and copies from beforeRendering may read this frame's
+        // uploads too
+        uploadWaitStages_ = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                            VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+        // Secondaries of this slot are done too, recycle them all at once
+        for (auto &worker : frame.workers) {
+            if (worker.used > 0) {
+                vkResetCommandPool(device_, worker.pool, 0);
+                worker.used = 0;
+            }
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(frame.commandBuffer, &beginInfo) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording command buffer!");
+        }
+
+        // The slot's frame has completed, so its timestamps are ready
+        profiler_->beginFrame(frame.commandBuffer, currentFrame_,
+                              submitSerial_ + 1);
+        frameScope_ = profiler_->beginGpuScope(frame.commandBuffer, "frame");
+
+        beforeRendering(frame.commandBuffer);
+
+        if (dynamicRendering_) {
+            beginRendering(frame.commandBuffer, contents);
+        } else {
+            VkClearValue clearColor{};
+            clearColor.color = clearColor_;
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass_;
+            renderPassInfo.framebuffer = framebuffers_[imageIndex_];
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = extent_;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearColor;
+
+            vkCmdBeginRenderPass(frame.commandBuffer, &renderPassInfo,
+                                 contents);
+        }
+        subpassContents_ = contents;
+
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewport(frame.commandBuffer);
+        }
+        return true;
+    }
+
+    void Renderer::recordParallel(
+        uint32_t drawCount,
+        FunctionRef<void(VkCommandBuffer, uint32_t, uint32_t)> record) {
+        if (subpassContents_ != VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+            throw std::runtime_error(
+                "Frame was not begun for secondary command buffers!");
+        }
+        if (drawCount == 0) {
+            return;
+        }
+
+        CpuScope scope(*profiler_, "recordParallel");
+        FrameData &frame = frames_[currentFrame_];
+
+        // A couple of slices per thread lets fast threads pick up the slack
+        // of slow ones
+        uint32_t sliceCount = std::clamp(drawCount / MIN_DRAWS_PER_SLICE, 1u,
+                                         jobs_->threadCount() * 2);
+        frame.secondaries.resize(sliceCount);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType =
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass_;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer =
+            dynamicRendering_ ? VK_NULL_HANDLE : framebuffers_[imageIndex_];
+
+        VkCommandBufferInheritanceRenderingInfo renderingInheritance{};
+        renderingInheritance.sType =
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        renderingInheritance.colorAttachmentCount = 1;
+        renderingInheritance.pColorAttachmentFormats = &colorFormat_;
+        renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        if (dynamicRendering_) {
+            inheritanceInfo.pNext = &renderingInheritance;
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                          VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        jobs_->run(sliceCount, [&](uint32_t slice, uint32_t worker) {
+            VkCommandBuffer commandBuffer =
+                acquireSecondary(frame.workers[worker]);
+
+            if (vkBeginCommandBuffer(commandBuffer, &beginInfo) !=
+                VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to begin recording secondary command buffer!");
+            }
+
+            // Secondaries inherit no dynamic state from the primary
+            setViewport(commandBuffer);
+
+            uint32_t first =
+                static_cast<uint32_t>(uint64_t(drawCount) * slice / sliceCount);
+            uint32_t last = static_cast<uint32_t>(uint64_t(drawCount) *
+                                                  (slice + 1) / sliceCount);
+            record(commandBuffer, first, last - first);
+
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to record secondary command buffer!");
+            }
+
+            frame.secondaries[slice] = commandBuffer;
+        });
+
+        vkCmdExecuteCommands(frame.commandBuffer, sliceCount,
+                             frame.secondaries.data());
+    }
+
+    void Renderer::beginRendering(VkCommandBuffer commandBuffer,
+                                  VkSubpassContents contents) {
+        // What the render pass did through its initial layout and
+        // dependency. Waiting on color output chains with the acquire
+        // semaphore wait.
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = images_[imageIndex_];
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = imageViews_[imageIndex_];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue.color = clearColor_;
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+            renderingInfo.flags =
+                VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        }
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = extent_;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        cmdBeginRendering_(commandBuffer, &renderingInfo);
+    }
+
+    void Renderer::endRendering(VkCommandBuffer commandBuffer) {
+        cmdEndRendering_(commandBuffer);
+
+        // Headless images go on to the readback copy, swapchain images to
+        // the presentation engine
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = headless_ ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                      : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = images_[imageIndex_];
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             headless_ ? VK_PIPELINE_STAGE_TRANSFER_BIT
+                                       : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void Renderer::setViewport(VkCommandBuffer commandBuffer) const {
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)extent_.width;
+        viewport.height = (float)extent_.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = extent_;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+
+    VkCommandBuffer Renderer::acquireSecondary(WorkerCommands &worker) {
+        if (worker.used < worker.commandBuffers.size()) {
+            return worker.commandBuffers[worker.used++];
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = worker.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to allocate secondary command buffer!");
+        }
+
+        worker.commandBuffers.push_back(commandBuffer);
+        worker.used++;
+        return commandBuffer;
+    }
+
+    VkCommandBuffer Renderer::beginAsyncCompute() {
+        if (computeRecording_ || computeWait_ > 0) {
+            throw std::runtime_error(
+                "Async compute was already begun this frame!");
+        }
+
+        // The slot's last graphics submission waited for the compute work
+        // recorded here, so beginFrame() has waited for it too
+        FrameData &frame = frames_[currentFrame_];
+        vkResetCommandBuffer(frame.computeCommandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(frame.computeCommandBuffer, &beginInfo) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording compute command buffer!");
+        }
+        computeRecording_ = true;
+        return frame.computeCommandBuffer;
+    }
+
+    void Renderer::submitAsyncCompute(VkPipelineStageFlags consumerStage) {
+        if (!computeRecording_) {
+            throw std::runtime_error("No async compute is being recorded!");
+        }
+        CpuScope scope(*profiler_, "submitAsyncCompute");
+        FrameData &frame = frames_[currentFrame_];
+        computeRecording_ = false;
+
+        if (vkEndCommandBuffer(frame.computeCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to record compute command buffer!");
+        }
+
+        // Compute may read what was uploaded so far
+        VkSemaphore waitSemaphore = uploadQueue_->semaphore();
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        uint64_t waitValue = uploadQueue_->flush();
+        uint64_t signalValue = computeSerial_ + 1;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &waitValue;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &waitSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &frame.computeCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &computeTimeline_;
+
+        if (vkQueueSubmit(computeQueue_, 1, &submitInfo, VK_NULL_HANDLE) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to submit compute command buffer!");
+        }
+
+        computeSerial_ = signalValue;
+        computeWait_ = signalValue;
+        computeWaitStage_ = consumerStage;
+    }
+
+    void Renderer::submit() {
+        CpuScope scope(*profiler_, "submit");
+        FrameData &frame = frames_[currentFrame_];
+
+        if (computeRecording_) {
+            submitAsyncCompute();
+        }
+
+        if (dynamicRendering_) {
+            endRendering(frame.commandBuffer);
+        } else {
+            vkCmdEndRenderPass(frame.commandBuffer);
+        }
+
+        if (enableReadback_) {
+            VkBufferImageCopy region{};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = {extent_.width, extent_.height, 1};
+
+            vkCmdCopyImageToBuffer(frame.commandBuffer, images_[imageIndex_],
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   frame.readback.buffer, 1, &region);
+
+            VkBufferMemoryBarrier hostBarrier{};
+            hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            hostBarrier.buffer = frame.readback.buffer;
+            hostBarrier.size = VK_WHOLE_SIZE;
+
+            vkCmdPipelineBarrier(frame.commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                                 &hostBarrier, 0, nullptr);
+        }
+
+        profiler_->endGpuScope(frame.commandBuffer, frameScope_);
+        frameScope_ = Profiler::NO_SCOPE;
+
+        if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record command buffer!");
+        }
+
+        // Vertex input onwards waits for uploads, and so do compute and
+        // transfer commands when beforeRendering may have recorded some.
+        // Only the clear is left to overlap them.
+        uint64_t uploadValue = uploadQueue_->flush();
+
+        VkSemaphore waitSemaphores[3];
+        VkPipelineStageFlags waitStages[3];
+        uint64_t waitValues[3] = {0, 0, 0};
+        uint32_t waitCount = 0;
+
+        if (!headless_) {
+            waitSemaphores[waitCount] = frame.imageAvailable;
+            waitStages[waitCount] =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            waitCount++;
+        }
+        if (uploadValue > 0) {
+            waitSemaphores[waitCount] = uploadQueue_->semaphore();
+            waitStages[waitCount] = uploadWaitStages_;
+            waitValues[waitCount] = uploadValue;
+            waitCount++;
+        }
+        if (computeWait_ > 0) {
+            waitSemaphores[waitCount] = computeTimeline_;
+            waitStages[waitCount] = computeWaitStage_;
+            waitValues[waitCount] = computeWait_;
+            waitCount++;
+        }
+
+        // The frame timeline reaches the frame's serial once it completes
+        uint64_t serial = submitSerial_ + 1;
+        VkSemaphore signalSemaphores[2] = {frameTimeline_, VK_NULL_HANDLE};
+        uint64_t signalValues[2] = {serial, 0};
+        uint32_t signalCount = 1;
+        if (!headless_) {
+            signalSemaphores[signalCount++] = renderFinished_[imageIndex_];
+        }
+
+        // Binary semaphores ignore their entry in the value arrays
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+        timelineInfo.signalSemaphoreValueCount = signalCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = waitCount;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &frame.commandBuffer;
+        submitInfo.signalSemaphoreCount = signalCount;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+
+        if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit draw command buffer!");
+        }
+
+        submitSerial_ = serial;
+        frame.serial = serial;
+        lastSubmittedFrame_ = currentFrame_;
+        profiler_->endFrame();
+    }
+
+    void Renderer::endFrame(std::span<const VkRect2D> damage) {
+        CpuScope scope(*profiler_, "endFrame");
+        if (headless_) {
+            latency_.present(LatencyTracker::Clock::now());
+            currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+            return;
+        }
+
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &renderFinished_[imageIndex_];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &swapchain_;
+        presentInfo.pImageIndices = &imageIndex_;
+
+        // Damage clipped to the image. A present without regions, or with
+        // a region of no rectangles, updates the whole image.
+        VkRectLayerKHR rectangles[DamageRegion::MAX_RECTS];
+        VkPresentRegionKHR region{};
+        region.pRectangles = rectangles;
+        VkPresentRegionsKHR regions{};
+        regions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+        regions.swapchainCount = 1;
+        regions.pRegions = &region;
+        if (incrementalPresent_ && !damage.empty() &&
+            damage.size() <= DamageRegion::MAX_RECTS) {
+            for (const VkRect2D &rect : damage) {
+                int64_t left = std::max<int64_t>(rect.offset.x, 0);
+                int64_t top = std::max<int64_t>(rect.offset.y, 0);
+                int64_t right = std::min<int64_t>(
+                    int64_t(rect.offset.x) + rect.extent.width,
+                    extent_.width);
+                int64_t bottom = std::min<int64_t>(
+                    int64_t(rect.offset.y) + rect.extent.height,
+                    extent_.height);
+                if (right <= left || bottom <= top) {
+                    continue;
+                }
+                VkRectLayerKHR &rectangle =
+                    rectangles[region.rectangleCount++];
+                rectangle.offset = {static_cast<int32_t>(left),
+                                    static_cast<int32_t>(top)};
+                rectangle.extent = {static_cast<uint32_t>(right - left),
+                                    static_cast<uint32_t>(bottom - top)};
+                rectangle.layer = 0;
+            }
+            // Damage entirely off the image presents it whole
+            if (region.rectangleCount > 0) {
+                presentInfo.pNext = &regions;
+            }
+        }
+
+        // The frame slot advances either way, a rejected present still
+        // consumes the wait on renderFinished
+        VkResult result = vkQueuePresentKHR(presentQueue_, &presentInfo);
+        latency_.present(LatencyTracker::Clock::now());
+        currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            swapchainDirty_ = true;
+        } else if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to present swap chain image!");
+        }
+    }
+
+    void Renderer::readback(void *pixels) {
+        if (!enableReadback_) {
+            throw std::runtime_error("Readback is not enabled!");
+        }
+        if (lastSubmittedFrame_ == UINT32_MAX) {
+            throw std::runtime_error("No frame has been submitted yet!");
+        }
+
+        FrameData &frame = frames_[lastSubmittedFrame_];
+        waitTimeline(device_, frameTimeline_, frame.serial);
+        memcpy(pixels, frame.readback.allocation.mapped,
+               (size_t)frame.readback.size);
+    }
+
+    VkCommandBuffer Renderer::commandBuffer() const {
+        return frames_[currentFrame_].commandBuffer;
+    }
+
+    void Renderer::waitIdle() const { vkDeviceWaitIdle(device_); }
+
+    Buffer Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                  VkMemoryPropertyFlags properties) {
+        return allocator_->createBuffer(size, usage, properties);
+    }
+
+    void Renderer::destroyBuffer(Buffer &buffer) {
+        allocator_->destroyBuffer(buffer);
+    }
+
+} // namespace rvivl
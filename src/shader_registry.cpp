@@ -0,0 +1,33 @@
+#include "rvivl/shader_registry.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace rvivl {
+
+    std::optional<std::span<const uint32_t>>
+    findEmbeddedShader(std::string_view name) {
+        std::span<const EmbeddedShader> shaders = embeddedShaders();
+        auto it = std::lower_bound(
+            shaders.begin(), shaders.end(), name,
+            [](const EmbeddedShader &shader, std::string_view key) {
+                return shader.name < key;
+            });
+        if (it == shaders.end() || it->name != name) {
+            return std::nullopt;
+        }
+        return it->code;
+    }
+
+    std::span<const uint32_t> embeddedShader(std::string_view name) {
+        std::optional<std::span<const uint32_t>> code =
+            findEmbeddedShader(name);
+        if (!code) {
+            throw std::runtime_error("Failed to find embedded shader: " +
+                                     std::string(name));
+        }
+        return *code;
+    }
+
+} // namespace rvivl
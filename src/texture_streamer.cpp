@@ -0,0 +1,756 @@
+#include "rvivl/texture_streamer.hpp"
+#include "rvivl/asset.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        VkImageMemoryBarrier mipBarrier(VkImage image, uint32_t firstLevel,
+                                        uint32_t levelCount,
+                                        VkImageLayout oldLayout,
+                                        VkImageLayout newLayout,
+                                        VkAccessFlags srcAccess,
+                                        VkAccessFlags dstAccess) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            barrier.oldLayout = oldLayout;
+            barrier.newLayout = newLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = firstLevel;
+            barrier.subresourceRange.levelCount = levelCount;
+            barrier.subresourceRange.layerCount = 1;
+            return barrier;
+        }
+
+        int32_t mipExtent(uint32_t extent, uint32_t level) {
+            return static_cast<int32_t>(std::max(extent >> level, 1u));
+        }
+
+    } // namespace
+
+    static_assert(sizeof(ImageRect) == 32,
+                  "ImageRect must match the push constants of image.vert");
+
+    TextureStreamer::TextureStreamer(
+        const TextureStreamerCreateInfo &createInfo)
+        : renderer_(createInfo.renderer),
+          device_(createInfo.renderer->device()),
+          decoder_(createInfo.decoder), maxTextures_(createInfo.maxTextures),
+          uploadBudget_(createInfo.uploadBudget), format_(createInfo.format),
+          heap_(createInfo.renderer->descriptorHeap()) {
+        VkFormatProperties formatProperties{};
+        vkGetPhysicalDeviceFormatProperties(renderer_->physicalDevice(),
+                                            format_, &formatProperties);
+        VkFormatFeatureFlags blitFeatures =
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        generateMipmaps_ = (formatProperties.optimalTilingFeatures &
+                            blitFeatures) == blitFeatures;
+
+        try {
+            // With a heap the textures live in its image array instead
+            if (heap_ == nullptr) {
+                VkDescriptorSetLayoutBinding binding{};
+                binding.binding = 0;
+                binding.descriptorType =
+                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                binding.descriptorCount = 1;
+                binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+                VkDescriptorSetLayoutCreateInfo layoutInfo{};
+                layoutInfo.sType =
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                layoutInfo.bindingCount = 1;
+                layoutInfo.pBindings = &binding;
+
+                if (vkCreateDescriptorSetLayout(device_, &layoutInfo, nullptr,
+                                                &setLayout_) != VK_SUCCESS) {
+                    throw std::runtime_error(
+                        "Failed to create texture descriptor set layout!");
+                }
+            }
+
+            VkSamplerCreateInfo samplerInfo{};
+            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            samplerInfo.magFilter = VK_FILTER_LINEAR;
+            samplerInfo.minFilter = VK_FILTER_LINEAR;
+            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+            if (vkCreateSampler(device_, &samplerInfo, nullptr, &sampler_) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("Failed to create texture sampler!");
+            }
+
+            // The rect for the vertex shader, then the heap slot for the
+            // fragment shader
+            VkPushConstantRange pushConstantRanges[2]{};
+            pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+            pushConstantRanges[0].size = sizeof(ImageRect);
+            pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+            pushConstantRanges[1].offset = sizeof(ImageRect);
+            pushConstantRanges[1].size = sizeof(uint32_t);
+
+            VkDescriptorSetLayout setLayout = this->setLayout();
+
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+            pipelineLayoutInfo.sType =
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = 1;
+            pipelineLayoutInfo.pSetLayouts = &setLayout;
+            pipelineLayoutInfo.pushConstantRangeCount = heap_ ? 2 : 1;
+            pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
+
+            if (vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
+                                       &pipelineLayout_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create texture pipeline layout!");
+            }
+
+            // Corners come from gl_VertexIndex, so there is no vertex input
+            PipelineDesc desc = renderer_->pipelineDesc();
+            std::span<const uint32_t> vertexCode =
+                createInfo.vertexShaderCode.empty()
+                    ? embeddedShader("image.vert")
+                    : createInfo.vertexShaderCode;
+            std::span<const uint32_t> fragmentCode =
+                createInfo.fragmentShaderCode.empty()
+                    ? embeddedShader(heap_ ? "image_bindless.frag"
+                                           : "image.frag")
+                    : createInfo.fragmentShaderCode;
+            desc.vertexShader =
+                renderer_->pipelines().shaderModule(vertexCode);
+            desc.fragmentShader =
+                renderer_->pipelines().shaderModule(fragmentCode);
+            desc.vertexBindings.clear();
+            desc.vertexAttributes.clear();
+            desc.cullMode = VK_CULL_MODE_NONE;
+            desc.layout = pipelineLayout_;
+            pipeline_ = renderer_->pipelines().get(desc);
+
+            VkCommandPoolCreateInfo commandPoolInfo{};
+            commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            commandPoolInfo.flags =
+                VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            commandPoolInfo.queueFamilyIndex = renderer_->graphicsFamily();
+
+            if (vkCreateCommandPool(device_, &commandPoolInfo, nullptr,
+                                    &commandPool_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create texture command pool!");
+            }
+
+            std::vector<VkCommandBuffer> commandBuffers(COMMAND_BUFFER_COUNT);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = commandPool_;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = COMMAND_BUFFER_COUNT;
+
+            if (vkAllocateCommandBuffers(device_, &allocInfo,
+                                         commandBuffers.data()) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate texture command buffers!");
+            }
+
+            commandSlots_.resize(COMMAND_BUFFER_COUNT);
+            for (uint32_t i = 0; i < COMMAND_BUFFER_COUNT; i++) {
+                commandSlots_[i].commandBuffer = commandBuffers[i];
+            }
+
+            VkSemaphoreTypeCreateInfo typeInfo{};
+            typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = &typeInfo;
+
+            if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr,
+                                  &timeline_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create texture timeline semaphore!");
+            }
+
+            uint32_t threadCount = std::max(createInfo.decodeThreads, 1u);
+            for (uint32_t i = 0; i < threadCount; i++) {
+                workers_.emplace_back(&TextureStreamer::decodeLoop, this);
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    TextureStreamer::~TextureStreamer() { destroy(); }
+
+    void TextureStreamer::destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        requestsChanged_.notify_all();
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+
+        // Copies into our images may still be queued or running
+        UploadQueue &uploadQueue = renderer_->uploadQueue();
+        uploadQueue.wait(uploadQueue.flush());
+
+        if (timeline_ != VK_NULL_HANDLE) {
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &timeline_;
+            waitInfo.pValues = &submittedValue_;
+            vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+        }
+
+        for (auto &[id, texture] : textures_) {
+            destroyTexture(texture);
+        }
+        textures_.clear();
+        for (Retired &retired : retired_) {
+            destroyTexture(retired.texture);
+        }
+        retired_.clear();
+
+        if (timeline_ != VK_NULL_HANDLE) {
+            vkDestroySemaphore(device_, timeline_, nullptr);
+            timeline_ = VK_NULL_HANDLE;
+        }
+        if (commandPool_ != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device_, commandPool_, nullptr);
+            commandPool_ = VK_NULL_HANDLE;
+        }
+        commandSlots_.clear();
+        if (pipelineLayout_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device_, pipelineLayout_, nullptr);
+            pipelineLayout_ = VK_NULL_HANDLE;
+        }
+        if (sampler_ != VK_NULL_HANDLE) {
+            vkDestroySampler(device_, sampler_, nullptr);
+            sampler_ = VK_NULL_HANDLE;
+        }
+        if (setLayout_ != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device_, setLayout_, nullptr);
+            setLayout_ = VK_NULL_HANDLE;
+        }
+    }
+
+    TextureId TextureStreamer::load(std::string path) {
+        if (textures_.size() + retired_.size() >= maxTextures_) {
+            throw std::runtime_error("Too many textures!");
+        }
+
+        TextureId id = nextId_++;
+        textures_.emplace(id, Texture{});
+        pendingCount_++;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(Request{id, std::move(path)});
+        }
+        requestsChanged_.notify_one();
+        return id;
+    }
+
+    void TextureStreamer::release(TextureId id) {
+        auto it = textures_.find(id);
+        if (it == textures_.end()) {
+            return;
+        }
+
+        Texture &texture = it->second;
+        if (texture.state == TextureState::Loading ||
+            texture.state == TextureState::Uploading) {
+            pendingCount_--;
+        }
+        std::erase(staging_, id);
+        std::erase(staged_, id);
+        std::erase(generating_, id);
+
+        // The frame being recorded may have drawn it as well
+        retired_.push_back(
+            Retired{std::move(texture), renderer_->submittedSerial() + 1});
+        textures_.erase(it);
+    }
+
+    void TextureStreamer::update() {
+        releaseRetired();
+        completeMips();
+        collectDecoded();
+        stageRows();
+        generateMips();
+    }
+
+    TextureState TextureStreamer::state(TextureId id) const {
+        auto it = textures_.find(id);
+        return it == textures_.end() ? TextureState::Failed : it->second.state;
+    }
+
+    VkExtent2D TextureStreamer::extent(TextureId id) const {
+        auto it = textures_.find(id);
+        if (it == textures_.end() || it->second.image.image == VK_NULL_HANDLE) {
+            return {0, 0};
+        }
+        return {it->second.decoded.width, it->second.decoded.height};
+    }
+
+    uint32_t TextureStreamer::heapIndex(TextureId id) const {
+        auto it = textures_.find(id);
+        if (it == textures_.end() || it->second.state != TextureState::Ready) {
+            return DescriptorHeap::NO_INDEX;
+        }
+        return it->second.heapIndex;
+    }
+
+    VkDescriptorSetLayout TextureStreamer::setLayout() const {
+        return heap_ ? heap_->setLayout() : setLayout_;
+    }
+
+    ImageBinding TextureStreamer::binding(Texture &texture) {
+        ImageBinding image;
+        if (heap_) {
+            image.heapIndex = texture.heapIndex;
+            return image;
+        }
+
+        // One set per texture and frame, however often it is drawn
+        uint64_t serial = renderer_->submittedSerial() + 1;
+        if (texture.frameSerial != serial) {
+            texture.frameSet =
+                renderer_->frameDescriptors().allocate(setLayout_);
+            texture.frameSerial = serial;
+
+            VkDescriptorImageInfo descriptorImage{};
+            descriptorImage.sampler = sampler_;
+            descriptorImage.imageView = texture.view;
+            descriptorImage.imageLayout =
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = texture.frameSet;
+            write.dstBinding = 0;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &descriptorImage;
+            vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+        }
+        image.descriptorSet = texture.frameSet;
+        return image;
+    }
+
+    bool TextureStreamer::draw(VkCommandBuffer commandBuffer, TextureId id,
+                               const ImageRect &rect) {
+        TextureDraw single{id, rect};
+        return draw(commandBuffer, {&single, 1}) == 1;
+    }
+
+    uint32_t TextureStreamer::draw(VkCommandBuffer commandBuffer,
+                                   std::span<const TextureDraw> draws) {
+        uint32_t drawn = 0;
+        for (const TextureDraw &draw : draws) {
+            auto it = textures_.find(draw.id);
+            if (it == textures_.end() ||
+                it->second.state != TextureState::Ready) {
+                continue;
+            }
+            if (drawn++ == 0) {
+                bind(commandBuffer);
+            }
+            drawImage(commandBuffer, binding(it->second), draw.rect);
+        }
+        return drawn;
+    }
+
+    void TextureStreamer::bind(VkCommandBuffer commandBuffer) const {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipeline_);
+        if (heap_) {
+            heap_->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        pipelineLayout_);
+        }
+    }
+
+    void TextureStreamer::drawImage(VkCommandBuffer commandBuffer,
+                                    const ImageBinding &image,
+                                    const ImageRect &rect) const {
+        if (heap_) {
+            vkCmdPushConstants(commandBuffer, pipelineLayout_,
+                               VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(ImageRect),
+                               sizeof(uint32_t), &image.heapIndex);
+        } else {
+            vkCmdBindDescriptorSets(commandBuffer,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    pipelineLayout_, 0, 1,
+                                    &image.descriptorSet, 0, nullptr);
+        }
+        vkCmdPushConstants(commandBuffer, pipelineLayout_,
+                           VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ImageRect),
+                           &rect);
+        vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+    }
+
+    void TextureStreamer::decodeLoop() {
+        for (;;) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                requestsChanged_.wait(
+                    lock, [this] { return stopping_ || !requests_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                request = std::move(requests_.front());
+                requests_.pop_front();
+            }
+
+            Result result{request.id, false, {}};
+            try {
+                // The decoder reads straight from the page cache
+                MappedFile file(request.path);
+                result.success = decoder_(file.bytes(), result.image);
+            } catch (...) {
+                result.success = false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_.push_back(std::move(result));
+        }
+    }
+
+    void TextureStreamer::createTexture(Texture &texture) {
+        const DecodedImage &decoded = texture.decoded;
+        texture.mipLevels =
+            generateMipmaps_ ? mipLevelCount(decoded.width, decoded.height)
+                             : 1;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format_;
+        imageInfo.extent = {decoded.width, decoded.height, 1};
+        imageInfo.mipLevels = texture.mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        texture.image = renderer_->uploadQueue().createImage(imageInfo);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = texture.image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format_;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = texture.mipLevels;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device_, &viewInfo, nullptr, &texture.view) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create texture image view!");
+        }
+
+        // Nothing samples the slot before the texture is ready, so it can
+        // be written right away
+        if (heap_) {
+            texture.heapIndex =
+                heap_->addImage(texture.view, sampler_,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+
+        // The transition goes out with the next flush, whoever makes it
+        UploadQueue &uploadQueue = renderer_->uploadQueue();
+        uploadQueue.prepareImage(texture.image.image, texture.mipLevels);
+        texture.uploadValue = uploadQueue.submittedValue() + 1;
+    }
+
+    void TextureStreamer::destroyTexture(Texture &texture) {
+        // Only called once the frames that drew the texture have completed
+        if (texture.heapIndex != DescriptorHeap::NO_INDEX) {
+            heap_->removeImage(texture.heapIndex,
+                               renderer_->completedSerial());
+            texture.heapIndex = DescriptorHeap::NO_INDEX;
+        }
+        if (texture.view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device_, texture.view, nullptr);
+            texture.view = VK_NULL_HANDLE;
+        }
+        renderer_->allocator().destroyImage(texture.image);
+    }
+
+    void TextureStreamer::releaseRetired() {
+        uint64_t completedSerial = renderer_->completedSerial();
+        uint64_t completed = completedValue();
+        UploadQueue &uploadQueue = renderer_->uploadQueue();
+
+        std::erase_if(retired_, [&](Retired &retired) {
+            const Texture &texture = retired.texture;
+            if (retired.serial > completedSerial ||
+                texture.mipValue > completed ||
+                !uploadQueue.isComplete(texture.uploadValue)) {
+                return false;
+            }
+            destroyTexture(retired.texture);
+            return true;
+        });
+    }
+
+    void TextureStreamer::collectDecoded() {
+        std::vector<Result> results;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results.swap(results_);
+        }
+
+        // A row must fit in one band of the staging ring
+        VkDeviceSize maxRowBytes =
+            renderer_->uploadQueue().stagingCapacity() / 2;
+        for (Result &result : results) {
+            auto it = textures_.find(result.id);
+            if (it == textures_.end()) {
+                // Released while it was decoding
+                continue;
+            }
+
+            Texture &texture = it->second;
+            if (!result.success ||
+                VkDeviceSize(result.image.width) * 4 > maxRowBytes) {
+                texture.state = TextureState::Failed;
+                pendingCount_--;
+                continue;
+            }
+
+            texture.decoded = std::move(result.image);
+            createTexture(texture);
+            texture.state = TextureState::Uploading;
+            staging_.push_back(result.id);
+        }
+    }
+
+    void TextureStreamer::stageRows() {
+        UploadQueue &uploadQueue = renderer_->uploadQueue();
+        // Bands of at most half the ring leave room for other uploads
+        VkDeviceSize bandLimit =
+            std::min(uploadBudget_, uploadQueue.stagingCapacity() / 2);
+        VkDeviceSize budget = uploadBudget_;
+
+        written_.clear();
+        while (!staging_.empty() && budget > 0) {
+            TextureId id = staging_.front();
+            Texture &texture = textures_.at(id);
+            DecodedImage &decoded = texture.decoded;
+
+            VkDeviceSize rowBytes = VkDeviceSize(decoded.width) * 4;
+            uint32_t rows = static_cast<uint32_t>(std::clamp<VkDeviceSize>(
+                std::min(bandLimit, budget) / rowBytes, 1,
+                decoded.height - texture.rowsStaged));
+
+            VkBufferImageCopy region{};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, static_cast<int32_t>(texture.rowsStaged),
+                                  0};
+            region.imageExtent = {decoded.width, rows, 1};
+
+            VkDeviceSize size = rowBytes * rows;
+            if (!uploadQueue.tryWriteImage(
+                    texture.image.image, region,
+                    decoded.pixels.data() + rowBytes * texture.rowsStaged,
+                    size)) {
+                // The ring is busy, carry on next frame
+                break;
+            }
+
+            written_.push_back(id);
+            budget -= std::min(budget, size);
+            texture.rowsStaged += rows;
+            if (texture.rowsStaged == decoded.height) {
+                decoded.pixels = {};
+                staging_.pop_front();
+                staged_.push_back(id);
+            }
+        }
+
+        if (written_.empty()) {
+            return;
+        }
+        uint64_t value = uploadQueue.flush();
+        for (TextureId id : written_) {
+            textures_.at(id).uploadValue = value;
+        }
+    }
+
+    void TextureStreamer::generateMips() {
+        if (staged_.empty()) {
+            return;
+        }
+
+        // Rather than wait for a busy slot, try again next frame
+        CommandSlot &slot = commandSlots_[nextSlot_];
+        if (slot.value > completedValue()) {
+            return;
+        }
+        nextSlot_ = (nextSlot_ + 1) % COMMAND_BUFFER_COUNT;
+
+        vkResetCommandBuffer(slot.commandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording texture command buffer!");
+        }
+
+        uint64_t uploadValue = 0;
+        for (TextureId id : staged_) {
+            const Texture &texture = textures_.at(id);
+            recordMips(slot.commandBuffer, texture);
+            uploadValue = std::max(uploadValue, texture.uploadValue);
+        }
+
+        if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to record texture command buffer!");
+        }
+
+        uint64_t signalValue = submittedValue_ + 1;
+        VkSemaphore uploadSemaphore = renderer_->uploadQueue().semaphore();
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &uploadValue;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &uploadSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &slot.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline_;
+
+        if (vkQueueSubmit(renderer_->graphicsQueue(), 1, &submitInfo,
+                          VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to submit texture command buffer!");
+        }
+
+        submittedValue_ = signalValue;
+        slot.value = signalValue;
+        for (TextureId id : staged_) {
+            textures_.at(id).mipValue = signalValue;
+            generating_.push_back(id);
+        }
+        staged_.clear();
+    }
+
+    void TextureStreamer::recordMips(VkCommandBuffer commandBuffer,
+                                     const Texture &texture) const {
+        VkImage image = texture.image.image;
+        uint32_t width = texture.decoded.width;
+        uint32_t height = texture.decoded.height;
+
+        // Each level is blitted from the one above it, which has to be
+        // turned into a transfer source first
+        for (uint32_t level = 1; level < texture.mipLevels; level++) {
+            VkImageMemoryBarrier barrier = mipBarrier(
+                image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                                 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.layerCount = 1;
+            blit.srcOffsets[1] = {mipExtent(width, level - 1),
+                                  mipExtent(height, level - 1), 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.layerCount = 1;
+            blit.dstOffsets[1] = {mipExtent(width, level),
+                                  mipExtent(height, level), 1};
+
+            vkCmdBlitImage(commandBuffer, image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                           VK_FILTER_LINEAR);
+        }
+
+        // Every level but the last is a transfer source by now. The
+        // barriers also order later frames' sampling on this queue.
+        VkImageMemoryBarrier barriers[2];
+        uint32_t barrierCount = 0;
+        uint32_t last = texture.mipLevels - 1;
+        if (last > 0) {
+            barriers[barrierCount++] = mipBarrier(
+                image, 0, last, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
+        }
+        barriers[barrierCount++] = mipBarrier(
+            image, last, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                             nullptr, 0, nullptr, barrierCount, barriers);
+    }
+
+    void TextureStreamer::completeMips() {
+        uint64_t completed = completedValue();
+        std::erase_if(generating_, [&](TextureId id) {
+            Texture &texture = textures_.at(id);
+            if (texture.mipValue > completed) {
+                return false;
+            }
+            texture.state = TextureState::Ready;
+            pendingCount_--;
+            return true;
+        });
+    }
+
+    uint64_t TextureStreamer::completedValue() const {
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_, &completed);
+        return completed;
+    }
+
+} // namespace rvivl
@@ -0,0 +1,609 @@
+#include "rvivl/tiled_image.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        PnmHeader parsePnmFile(std::span<const char> data) {
+            PnmHeader header;
+            if (!parsePnmHeader(data, header)) {
+                throw std::runtime_error("Failed to read image header!");
+            }
+            uint64_t pixelBytes =
+                uint64_t(header.width) * header.height * header.channels;
+            if (data.size() - header.dataOffset < pixelBytes) {
+                throw std::runtime_error("Image file is truncated!");
+            }
+            return header;
+        }
+
+        uint32_t atlasEdge(const TiledImageCreateInfo &createInfo) {
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(
+                createInfo.renderer->physicalDevice(), &properties);
+
+            uint32_t tileSize = createInfo.source->pyramid().tileSize();
+            uint32_t edge = std::min(createInfo.atlasSize,
+                                     properties.limits.maxImageDimension2D);
+            edge = edge / tileSize * tileSize;
+            if (edge == 0) {
+                throw std::runtime_error("Tile atlas is smaller than a tile!");
+            }
+            return edge;
+        }
+
+    } // namespace
+
+    TilePyramid::TilePyramid(uint32_t width, uint32_t height,
+                             uint32_t tileSize)
+        : width_(width), height_(height), tileSize_(tileSize),
+          levelCount_(1) {
+        if (width == 0 || height == 0 || tileSize == 0) {
+            throw std::runtime_error("Invalid tile pyramid!");
+        }
+        while ((uint64_t(tileSize) << (levelCount_ - 1)) <
+               std::max(width, height)) {
+            levelCount_++;
+        }
+    }
+
+    uint32_t TilePyramid::tilesX(uint32_t level) const {
+        uint64_t span = uint64_t(tileSize_) << level;
+        return static_cast<uint32_t>((width_ + span - 1) / span);
+    }
+
+    uint32_t TilePyramid::tilesY(uint32_t level) const {
+        uint64_t span = uint64_t(tileSize_) << level;
+        return static_cast<uint32_t>((height_ + span - 1) / span);
+    }
+
+    TileRect TilePyramid::tileRect(const TileKey &key) const {
+        uint64_t span = uint64_t(tileSize_) << key.level;
+        uint64_t x0 = key.x * span;
+        uint64_t y0 = key.y * span;
+
+        TileRect rect;
+        rect.x0 = static_cast<uint32_t>(std::min<uint64_t>(x0, width_));
+        rect.y0 = static_cast<uint32_t>(std::min<uint64_t>(y0, height_));
+        rect.x1 = static_cast<uint32_t>(std::min<uint64_t>(x0 + span, width_));
+        rect.y1 =
+            static_cast<uint32_t>(std::min<uint64_t>(y0 + span, height_));
+        return rect;
+    }
+
+    VkExtent2D TilePyramid::tileExtent(const TileKey &key) const {
+        TileRect rect = tileRect(key);
+        uint32_t step = 1u << key.level;
+        return {(rect.x1 - rect.x0 + step - 1) >> key.level,
+                (rect.y1 - rect.y0 + step - 1) >> key.level};
+    }
+
+    uint32_t TilePyramid::levelFor(double scale) const {
+        if (!(scale < 1.0)) {
+            return 0;
+        }
+        double level = std::floor(std::log2(1.0 / scale));
+        return static_cast<uint32_t>(
+            std::min(level, static_cast<double>(topLevel())));
+    }
+
+    void TilePyramid::visibleTiles(const TileView &view, uint32_t level,
+                                   std::vector<TileKey> &tiles) const {
+        if (view.scale <= 0.0) {
+            return;
+        }
+
+        double halfWidth = view.viewport.width / (2.0 * view.scale);
+        double halfHeight = view.viewport.height / (2.0 * view.scale);
+        double x0 = std::max(view.centerX - halfWidth, 0.0);
+        double y0 = std::max(view.centerY - halfHeight, 0.0);
+        double x1 = std::min(view.centerX + halfWidth, double(width_));
+        double y1 = std::min(view.centerY + halfHeight, double(height_));
+        if (x1 <= x0 || y1 <= y0) {
+            return;
+        }
+
+        double span = double(uint64_t(tileSize_) << level);
+        uint32_t tx0 = static_cast<uint32_t>(x0 / span);
+        uint32_t ty0 = static_cast<uint32_t>(y0 / span);
+        uint32_t tx1 = std::min(static_cast<uint32_t>(std::ceil(x1 / span)),
+                                tilesX(level));
+        uint32_t ty1 = std::min(static_cast<uint32_t>(std::ceil(y1 / span)),
+                                tilesY(level));
+
+        for (uint32_t y = ty0; y < ty1; y++) {
+            for (uint32_t x = tx0; x < tx1; x++) {
+                tiles.push_back(TileKey{level, x, y});
+            }
+        }
+    }
+
+    TileCache::TileCache(uint32_t slotCount) : slots_(slotCount) {
+        for (uint32_t i = 0; i < slotCount; i++) {
+            pushBack(i);
+        }
+    }
+
+    std::optional<uint32_t> TileCache::find(const TileKey &key) const {
+        auto it = lookup_.find(key);
+        if (it == lookup_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void TileCache::touch(uint32_t slot, uint64_t serial) {
+        slots_[slot].serial = std::max(slots_[slot].serial, serial);
+        if (!slots_[slot].pinned) {
+            unlink(slot);
+            pushBack(slot);
+        }
+    }
+
+    bool TileCache::insert(const TileKey &key, uint64_t serial,
+                           uint64_t completedSerial, bool pinned,
+                           uint32_t &slot) {
+        slot = head_;
+        while (slot != NONE && slots_[slot].serial > completedSerial) {
+            slot = slots_[slot].next;
+        }
+        if (slot == NONE) {
+            return false;
+        }
+
+        Slot &entry = slots_[slot];
+        if (entry.used) {
+            lookup_.erase(entry.key);
+        }
+        entry.key = key;
+        entry.used = true;
+        entry.pinned = pinned;
+        entry.serial = serial;
+        unlink(slot);
+        if (!pinned) {
+            pushBack(slot);
+        }
+        lookup_[key] = slot;
+        return true;
+    }
+
+    void TileCache::erase(const TileKey &key) {
+        auto it = lookup_.find(key);
+        if (it == lookup_.end()) {
+            return;
+        }
+
+        uint32_t slot = it->second;
+        lookup_.erase(it);
+        Slot &entry = slots_[slot];
+        if (!entry.pinned) {
+            unlink(slot);
+        }
+        entry.used = false;
+        entry.pinned = false;
+
+        // Free slots are the first to be handed out again
+        entry.prev = NONE;
+        entry.next = head_;
+        if (head_ != NONE) {
+            slots_[head_].prev = slot;
+        } else {
+            tail_ = slot;
+        }
+        head_ = slot;
+    }
+
+    void TileCache::unlink(uint32_t slot) {
+        Slot &entry = slots_[slot];
+        if (entry.prev != NONE) {
+            slots_[entry.prev].next = entry.next;
+        } else if (head_ == slot) {
+            head_ = entry.next;
+        }
+        if (entry.next != NONE) {
+            slots_[entry.next].prev = entry.prev;
+        } else if (tail_ == slot) {
+            tail_ = entry.prev;
+        }
+        entry.prev = NONE;
+        entry.next = NONE;
+    }
+
+    void TileCache::pushBack(uint32_t slot) {
+        Slot &entry = slots_[slot];
+        entry.prev = tail_;
+        entry.next = NONE;
+        if (tail_ != NONE) {
+            slots_[tail_].next = slot;
+        } else {
+            head_ = slot;
+        }
+        tail_ = slot;
+    }
+
+    PnmTileSource::PnmTileSource(std::string path, uint32_t tileSize)
+        : file_(path), header_(parsePnmFile(file_.bytes())),
+          pyramid_(header_.width, header_.height, tileSize) {}
+
+    bool PnmTileSource::readTile(const TileKey &key, DecodedImage &tile) {
+        TileRect rect = pyramid_.tileRect(key);
+        VkExtent2D extent = pyramid_.tileExtent(key);
+        uint32_t step = 1u << key.level;
+        uint32_t channels = header_.channels;
+        uint32_t maxValue = header_.maxValue;
+
+        tile.width = extent.width;
+        tile.height = extent.height;
+        tile.pixels.resize(size_t(extent.width) * extent.height * 4);
+
+        // The constructor checked that every row is in the file
+        const auto *pixels =
+            reinterpret_cast<const uint8_t *>(file_.bytes().data()) +
+            header_.dataOffset;
+        uint8_t *dst = tile.pixels.data();
+        for (uint32_t j = 0; j < extent.height; j++) {
+            uint64_t y = rect.y0 + uint64_t(j) * step;
+            const uint8_t *row =
+                pixels + (y * header_.width + rect.x0) * channels;
+
+            for (uint32_t i = 0; i < extent.width; i++) {
+                const uint8_t *pixel = row + size_t(i) * step * channels;
+                for (uint32_t c = 0; c < 3; c++) {
+                    uint32_t value = pixel[channels == 3 ? c : 0];
+                    dst[c] = static_cast<uint8_t>(
+                        std::min(value, maxValue) * 255 / maxValue);
+                }
+                dst[3] = 255;
+                dst += 4;
+            }
+        }
+        return true;
+    }
+
+    TiledImage::TiledImage(const TiledImageCreateInfo &createInfo)
+        : renderer_(createInfo.renderer), streamer_(createInfo.streamer),
+          source_(createInfo.source),
+          device_(createInfo.renderer->device()),
+          maxQueuedTiles_(std::max(createInfo.maxQueuedTiles, 1u)),
+          uploadBudget_(createInfo.uploadBudget),
+          atlasSize_(atlasEdge(createInfo)),
+          slotsPerRow_(atlasSize_ / source_->pyramid().tileSize()),
+          cache_(slotsPerRow_ * slotsPerRow_) {
+        try {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = createInfo.format;
+            imageInfo.extent = {atlasSize_, atlasSize_, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            // Slots are written while frames sample the others, so the
+            // atlas stays in GENERAL
+            UploadQueue &uploadQueue = renderer_->uploadQueue();
+            atlas_ = uploadQueue.createImage(imageInfo);
+            uploadQueue.prepareImage(atlas_.image, 1,
+                                     VK_IMAGE_LAYOUT_GENERAL);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = atlas_.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = createInfo.format;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device_, &viewInfo, nullptr,
+                                  &atlasView_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create tile atlas image view!");
+            }
+
+            // The atlas keeps one heap slot for its whole life
+            if (DescriptorHeap *heap = renderer_->descriptorHeap()) {
+                image_.heapIndex = heap->addImage(
+                    atlasView_, streamer_->sampler(), VK_IMAGE_LAYOUT_GENERAL);
+            } else {
+                createDescriptorSet();
+            }
+
+            uint32_t threadCount = std::max(createInfo.loadThreads, 1u);
+            for (uint32_t i = 0; i < threadCount; i++) {
+                workers_.emplace_back(&TiledImage::loadLoop, this);
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    void TiledImage::createDescriptorSet() {
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+
+        if (vkCreateDescriptorPool(device_, &poolInfo, nullptr,
+                                   &descriptorPool_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create tile descriptor pool!");
+        }
+
+        VkDescriptorSetLayout setLayout = streamer_->setLayout();
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool_;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+
+        if (vkAllocateDescriptorSets(device_, &allocInfo,
+                                     &image_.descriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate tile descriptor set!");
+        }
+
+        VkDescriptorImageInfo descriptorImage{};
+        descriptorImage.sampler = streamer_->sampler();
+        descriptorImage.imageView = atlasView_;
+        descriptorImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = image_.descriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &descriptorImage;
+        vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+    }
+
+    TiledImage::~TiledImage() { destroy(); }
+
+    void TiledImage::destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        requestsChanged_.notify_all();
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+
+        // Copies into the atlas may still be queued or running
+        UploadQueue &uploadQueue = renderer_->uploadQueue();
+        uploadQueue.wait(uploadQueue.flush());
+
+        if (image_.heapIndex != DescriptorHeap::NO_INDEX) {
+            renderer_->descriptorHeap()->removeImage(
+                image_.heapIndex, renderer_->submittedSerial());
+            image_.heapIndex = DescriptorHeap::NO_INDEX;
+        }
+        if (descriptorPool_ != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(device_, descriptorPool_, nullptr);
+            descriptorPool_ = VK_NULL_HANDLE;
+        }
+        if (atlasView_ != VK_NULL_HANDLE) {
+            vkDestroyImageView(device_, atlasView_, nullptr);
+            atlasView_ = VK_NULL_HANDLE;
+        }
+        renderer_->allocator().destroyImage(atlas_);
+    }
+
+    void TiledImage::update(const TileView &view) {
+        const TilePyramid &pyramid = this->pyramid();
+        view_ = view;
+        viewLevel_ = pyramid.levelFor(view.scale);
+
+        visible_.clear();
+        pyramid.visibleTiles(view, viewLevel_, visible_);
+
+        // Ancestors first, they stand in while the visible tiles load
+        wanted_.clear();
+        for (uint32_t level = pyramid.topLevel(); level > viewLevel_;
+             level--) {
+            pyramid.visibleTiles(view, level, wanted_);
+        }
+        wanted_.insert(wanted_.end(), visible_.begin(), visible_.end());
+
+        requestTiles();
+
+        VkDeviceSize budget = uploadBudget_;
+        while (!loaded_.empty() && budget > 0) {
+            const Result &result = loaded_.front();
+            if (!result.success) {
+                failed_.insert(result.key);
+            } else if (!cache_.find(result.key)) {
+                if (!stageTile(result)) {
+                    // No slot or staging space yet, retry next frame
+                    break;
+                }
+                budget -= std::min<VkDeviceSize>(budget,
+                                                 result.tile.pixels.size());
+            }
+            loaded_.pop_front();
+        }
+
+        missingTiles_ = 0;
+        for (const TileKey &key : visible_) {
+            if (!cache_.find(key)) {
+                missingTiles_++;
+            }
+        }
+    }
+
+    void TiledImage::requestTiles() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (Result &result : results_) {
+                loaded_.push_back(std::move(result));
+            }
+            results_.clear();
+
+            // Rebuilt from the current view, so panning drops tiles that
+            // are no longer needed before they are read
+            for (const TileKey &key : requests_) {
+                requested_.erase(key);
+            }
+            requests_.clear();
+
+            for (const TileKey &key : wanted_) {
+                if (requests_.size() + loaded_.size() >= maxQueuedTiles_) {
+                    break;
+                }
+                if (cache_.find(key) || requested_.contains(key) ||
+                    failed_.contains(key) ||
+                    std::any_of(loaded_.begin(), loaded_.end(),
+                                [&](const Result &result) {
+                                    return result.key == key;
+                                })) {
+                    continue;
+                }
+                requests_.push_back(key);
+                requested_.insert(key);
+            }
+        }
+        requestsChanged_.notify_all();
+    }
+
+    bool TiledImage::stageTile(const Result &result) {
+        const TilePyramid &pyramid = this->pyramid();
+        uint32_t slot = 0;
+        if (!cache_.insert(result.key, renderer_->submittedSerial() + 1,
+                           renderer_->completedSerial(),
+                           result.key.level == pyramid.topLevel(), slot)) {
+            return false;
+        }
+
+        uint32_t tileSize = pyramid.tileSize();
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {
+            static_cast<int32_t>(slot % slotsPerRow_ * tileSize),
+            static_cast<int32_t>(slot / slotsPerRow_ * tileSize), 0};
+        region.imageExtent = {result.tile.width, result.tile.height, 1};
+
+        if (!renderer_->uploadQueue().tryWriteImage(
+                atlas_.image, region, result.tile.pixels.data(),
+                result.tile.pixels.size(), VK_IMAGE_LAYOUT_GENERAL)) {
+            cache_.erase(result.key);
+            return false;
+        }
+        return true;
+    }
+
+    void TiledImage::draw(VkCommandBuffer commandBuffer) {
+        const TilePyramid &pyramid = this->pyramid();
+        uint64_t serial = renderer_->submittedSerial() + 1;
+        uint32_t tileSize = pyramid.tileSize();
+        double atlasSize = atlasSize_;
+        bool bound = false;
+
+        fallbackTiles_ = 0;
+        for (const TileKey &key : visible_) {
+            TileKey source = key;
+            std::optional<uint32_t> slot = cache_.find(source);
+            while (!slot && source.level < pyramid.topLevel()) {
+                source = TileKey{source.level + 1, source.x / 2, source.y / 2};
+                slot = cache_.find(source);
+            }
+            if (!slot) {
+                continue;
+            }
+            if (source.level != key.level) {
+                fallbackTiles_++;
+            }
+            cache_.touch(*slot, serial);
+
+            if (!bound) {
+                streamer_->bind(commandBuffer);
+                bound = true;
+            }
+
+            // The part of the source tile the key covers, inset by half a
+            // texel at the slot edges so filtering never reaches a
+            // neighbouring slot
+            TileRect rect = pyramid.tileRect(key);
+            TileRect sourceRect = pyramid.tileRect(source);
+            VkExtent2D sourceExtent = pyramid.tileExtent(source);
+            double step = double(1u << source.level);
+            auto atlasCoordinate = [&](uint32_t pixel, uint32_t origin,
+                                       uint32_t texels, uint32_t slotOrigin) {
+                double texel = (pixel - origin) / step;
+                texel = 0.5 + texel * (texels - 1) / texels;
+                return float((slotOrigin + texel) / atlasSize);
+            };
+
+            uint32_t slotX = *slot % slotsPerRow_ * tileSize;
+            uint32_t slotY = *slot / slotsPerRow_ * tileSize;
+            float u0 = atlasCoordinate(rect.x0, sourceRect.x0,
+                                       sourceExtent.width, slotX);
+            float u1 = atlasCoordinate(rect.x1, sourceRect.x0,
+                                       sourceExtent.width, slotX);
+            float v0 = atlasCoordinate(rect.y0, sourceRect.y0,
+                                       sourceExtent.height, slotY);
+            float v1 = atlasCoordinate(rect.y1, sourceRect.y0,
+                                       sourceExtent.height, slotY);
+
+            double toNdcX = 2.0 * view_.scale / view_.viewport.width;
+            double toNdcY = 2.0 * view_.scale / view_.viewport.height;
+
+            ImageRect imageRect;
+            imageRect.x = float((rect.x0 - view_.centerX) * toNdcX);
+            imageRect.y = float((rect.y0 - view_.centerY) * toNdcY);
+            imageRect.width = float((rect.x1 - rect.x0) * toNdcX);
+            imageRect.height = float((rect.y1 - rect.y0) * toNdcY);
+            imageRect.u = u0;
+            imageRect.v = v0;
+            imageRect.uWidth = u1 - u0;
+            imageRect.vHeight = v1 - v0;
+
+            streamer_->drawImage(commandBuffer, image_, imageRect);
+        }
+    }
+
+    void TiledImage::loadLoop() {
+        for (;;) {
+            TileKey key;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                requestsChanged_.wait(
+                    lock, [this] { return stopping_ || !requests_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                key = requests_.front();
+                requests_.pop_front();
+            }
+
+            Result result{key, false, {}};
+            try {
+                result.success = source_->readTile(key, result.tile);
+            } catch (...) {
+                result.success = false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            requested_.erase(key);
+            results_.push_back(std::move(result));
+        }
+    }
+
+} // namespace rvivl
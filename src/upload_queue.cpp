@@ -0,0 +1,414 @@
+#include "rvivl/upload_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rvivl {
+
+    namespace {
+
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Keeps every staging range usable as the source of image copies
+        constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    } // namespace
+
+    StagingRing::StagingRing(VkDeviceSize capacity) : capacity_(capacity) {}
+
+    bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment,
+                               VkDeviceSize &offset) {
+        alignment = std::max<VkDeviceSize>(alignment, 1);
+        if (size == 0 || size > capacity_) {
+            return false;
+        }
+
+        if (used_ == 0) {
+            head_ = 0;
+            tail_ = 0;
+        }
+
+        VkDeviceSize candidate = alignUp(head_, alignment);
+        VkDeviceSize consumed = 0;
+
+        if (head_ > tail_ || used_ == 0) {
+            // Free space runs from the head to the end and from the start
+            // to the tail
+            if (candidate + size <= capacity_) {
+                consumed = candidate + size - head_;
+            } else if (size <= tail_) {
+                // The unused end of the ring is charged to this batch
+                candidate = 0;
+                consumed = capacity_ - head_ + size;
+            } else {
+                return false;
+            }
+        } else {
+            // The head has wrapped behind the tail, or the ring is full
+            if (candidate + size > tail_) {
+                return false;
+            }
+            consumed = candidate + size - head_;
+        }
+
+        offset = candidate;
+        head_ = candidate + size;
+        used_ += consumed;
+        openBytes_ += consumed;
+        return true;
+    }
+
+    void StagingRing::close(uint64_t value) {
+        if (openBytes_ == 0) {
+            return;
+        }
+        batches_.push_back(Batch{value, head_, openBytes_});
+        openBytes_ = 0;
+    }
+
+    void StagingRing::release(uint64_t completedValue) {
+        while (!batches_.empty() && batches_.front().value <= completedValue) {
+            tail_ = batches_.front().end;
+            used_ -= batches_.front().bytes;
+            batches_.pop_front();
+        }
+    }
+
+    uint64_t StagingRing::oldestValue() const {
+        return batches_.empty() ? 0 : batches_.front().value;
+    }
+
+    UploadQueue::UploadQueue(const UploadQueueCreateInfo &createInfo)
+        : device_(createInfo.device), allocator_(createInfo.allocator),
+          queue_(createInfo.transferQueue),
+          transferFamily_(createInfo.transferFamily),
+          graphicsFamily_(createInfo.graphicsFamily),
+          ring_(createInfo.stagingSize / STAGING_ALIGNMENT *
+                STAGING_ALIGNMENT) {
+        try {
+            staging_ = allocator_->createBuffer(
+                ring_.capacity(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            VkSemaphoreTypeCreateInfo typeInfo{};
+            typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = &typeInfo;
+
+            if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr,
+                                  &timeline_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create upload timeline semaphore!");
+            }
+
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                             VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = transferFamily_;
+
+            if (vkCreateCommandPool(device_, &poolInfo, nullptr,
+                                    &commandPool_) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create upload command pool!");
+            }
+
+            std::vector<VkCommandBuffer> commandBuffers(COMMAND_BUFFER_COUNT);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = commandPool_;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = COMMAND_BUFFER_COUNT;
+
+            if (vkAllocateCommandBuffers(device_, &allocInfo,
+                                         commandBuffers.data()) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate upload command buffers!");
+            }
+
+            commandSlots_.resize(COMMAND_BUFFER_COUNT);
+            for (uint32_t i = 0; i < COMMAND_BUFFER_COUNT; i++) {
+                commandSlots_[i].commandBuffer = commandBuffers[i];
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    UploadQueue::~UploadQueue() { destroy(); }
+
+    void UploadQueue::destroy() {
+        if (timeline_ != VK_NULL_HANDLE) {
+            wait(submittedValue_);
+            vkDestroySemaphore(device_, timeline_, nullptr);
+            timeline_ = VK_NULL_HANDLE;
+        }
+        if (commandPool_ != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device_, commandPool_, nullptr);
+            commandPool_ = VK_NULL_HANDLE;
+        }
+        commandSlots_.clear();
+        allocator_->destroyBuffer(staging_);
+    }
+
+    Buffer UploadQueue::createBuffer(const void *data, VkDeviceSize size,
+                                     VkBufferUsageFlags usage) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        // Concurrent sharing avoids queue family ownership transfers
+        uint32_t queueFamilyIndices[] = {graphicsFamily_, transferFamily_};
+        if (graphicsFamily_ != transferFamily_) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+        } else {
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+
+        Buffer buffer = allocator_->createBuffer(
+            bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (data != nullptr) {
+            write(buffer, 0, data, size);
+        }
+        return buffer;
+    }
+
+    void UploadQueue::write(const Buffer &dst, VkDeviceSize dstOffset,
+                            const void *data, VkDeviceSize size) {
+        const char *src = static_cast<const char *>(data);
+        char *mapped = static_cast<char *>(staging_.allocation.mapped);
+
+        // Data larger than the ring goes through it in ring-sized pieces
+        while (size > 0) {
+            VkDeviceSize chunk = std::min(size, ring_.capacity());
+            VkDeviceSize offset = reserve(chunk, STAGING_ALIGNMENT);
+            memcpy(mapped + offset, src, (size_t)chunk);
+
+            VkBufferCopy region{};
+            region.srcOffset = offset;
+            region.dstOffset = dstOffset;
+            region.size = chunk;
+            pendingCopies_.push_back(PendingCopy{dst.buffer, region});
+
+            src += chunk;
+            dstOffset += chunk;
+            size -= chunk;
+        }
+    }
+
+    Image UploadQueue::createImage(VkImageCreateInfo imageInfo) {
+        imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+        uint32_t queueFamilyIndices[] = {graphicsFamily_, transferFamily_};
+        if (graphicsFamily_ != transferFamily_) {
+            imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            imageInfo.queueFamilyIndexCount = 2;
+            imageInfo.pQueueFamilyIndices = queueFamilyIndices;
+        } else {
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+
+        return allocator_->createImage(imageInfo,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    void UploadQueue::prepareImage(VkImage image, uint32_t mipLevels,
+                                   VkImageLayout layout) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.layerCount = 1;
+        pendingBarriers_.push_back(barrier);
+    }
+
+    bool UploadQueue::tryWriteImage(VkImage image,
+                                    const VkBufferImageCopy &region,
+                                    const void *data, VkDeviceSize size,
+                                    VkImageLayout layout) {
+        // Reclaim finished batches first so the ring is not reported full
+        // when it only has not been released yet
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_, &completed);
+        ring_.release(completed);
+
+        VkDeviceSize offset = 0;
+        if (!ring_.allocate(size, STAGING_ALIGNMENT, offset)) {
+            return false;
+        }
+        char *mapped = static_cast<char *>(staging_.allocation.mapped);
+        memcpy(mapped + offset, data, (size_t)size);
+
+        VkBufferImageCopy copy = region;
+        copy.bufferOffset = offset;
+        pendingImageCopies_.push_back(PendingImageCopy{image, layout, copy});
+        return true;
+    }
+
+    VkDeviceSize UploadQueue::reserve(VkDeviceSize size,
+                                      VkDeviceSize alignment) {
+        VkDeviceSize offset = 0;
+        while (!ring_.allocate(size, alignment, offset)) {
+            // Hand what is queued to the GPU so its space can come back,
+            // then wait for the oldest batch
+            flush();
+            uint64_t oldest = ring_.oldestValue();
+            if (oldest == 0) {
+                throw std::runtime_error("Failed to reserve staging memory!");
+            }
+            wait(oldest);
+            ring_.release(oldest);
+        }
+        return offset;
+    }
+
+    uint64_t UploadQueue::flush() {
+        if (!hasPending()) {
+            return submittedValue_;
+        }
+
+        CommandSlot &slot = commandSlots_[nextSlot_];
+        nextSlot_ = (nextSlot_ + 1) % COMMAND_BUFFER_COUNT;
+
+        // Wait for the previous submission recorded into this slot
+        wait(slot.value);
+
+        vkResetCommandBuffer(slot.commandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) !=
+            VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording upload command buffer!");
+        }
+
+        if (!pendingBarriers_.empty()) {
+            vkCmdPipelineBarrier(
+                slot.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                static_cast<uint32_t>(pendingBarriers_.size()),
+                pendingBarriers_.data());
+        }
+
+        // One vkCmdCopyBuffer per run of copies into the same buffer
+        for (size_t first = 0; first < pendingCopies_.size();) {
+            VkBuffer dst = pendingCopies_[first].dst;
+            regions_.clear();
+
+            size_t last = first;
+            while (last < pendingCopies_.size() &&
+                   pendingCopies_[last].dst == dst) {
+                regions_.push_back(pendingCopies_[last].region);
+                last++;
+            }
+
+            vkCmdCopyBuffer(slot.commandBuffer, staging_.buffer, dst,
+                            static_cast<uint32_t>(regions_.size()),
+                            regions_.data());
+            first = last;
+        }
+
+        // Likewise one vkCmdCopyBufferToImage per run into the same image
+        for (size_t first = 0; first < pendingImageCopies_.size();) {
+            VkImage dst = pendingImageCopies_[first].dst;
+            VkImageLayout layout = pendingImageCopies_[first].layout;
+            imageRegions_.clear();
+
+            size_t last = first;
+            while (last < pendingImageCopies_.size() &&
+                   pendingImageCopies_[last].dst == dst &&
+                   pendingImageCopies_[last].layout == layout) {
+                imageRegions_.push_back(pendingImageCopies_[last].region);
+                last++;
+            }
+
+            vkCmdCopyBufferToImage(
+                slot.commandBuffer, staging_.buffer, dst, layout,
+                static_cast<uint32_t>(imageRegions_.size()),
+                imageRegions_.data());
+            first = last;
+        }
+
+        if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload command buffer!");
+        }
+
+        uint64_t signalValue = submittedValue_ + 1;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &slot.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline_;
+
+        if (vkQueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload command buffer!");
+        }
+
+        submittedValue_ = signalValue;
+        slot.value = signalValue;
+        ring_.close(signalValue);
+        pendingCopies_.clear();
+        pendingImageCopies_.clear();
+        pendingBarriers_.clear();
+
+        // Reclaim whatever has finished in the meantime without blocking
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_, &completed);
+        ring_.release(completed);
+
+        return signalValue;
+    }
+
+    bool UploadQueue::isComplete(uint64_t value) const {
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_, &completed);
+        return completed >= value;
+    }
+
+    void UploadQueue::wait(uint64_t value) const {
+        if (value == 0) {
+            return;
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline_;
+        waitInfo.pValues = &value;
+
+        vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+    }
+
+} // namespace rvivl
@@ -0,0 +1,109 @@
+#include "rvivl/asset.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using rvivl::ArchiveEntry;
+using rvivl::Asset;
+using rvivl::AssetArchive;
+
+namespace {
+
+    std::filesystem::path tempPath(const std::string &name) {
+        return std::filesystem::temp_directory_path() /
+               ("rvivl_asset_test_" + name);
+    }
+
+    void writeFile(const std::filesystem::path &path,
+                   const std::vector<char> &data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+} // namespace
+
+TEST(AssetTest, ArchiveRoundTrips) {
+    std::vector<char> shader(12, 0);
+    uint32_t word = 0x07230203;
+    std::memcpy(shader.data(), &word, sizeof(word));
+    std::string text = "odd";
+
+    std::vector<ArchiveEntry> entries = {
+        {"text.txt", {text.data(), text.size()}},
+        {"shader.spv", {shader.data(), shader.size()}},
+    };
+    std::filesystem::path path = tempPath("roundtrip.pak");
+    writeFile(path, rvivl::encodeAssetArchive(entries));
+
+    Asset shaderAsset;
+    {
+        AssetArchive archive(path.string());
+        EXPECT_EQ(archive.size(), 2u);
+        EXPECT_FALSE(archive.find("missing.spv"));
+
+        std::optional<Asset> found = archive.find("text.txt");
+        ASSERT_TRUE(found);
+        EXPECT_EQ(std::string(found->bytes().begin(), found->bytes().end()),
+                  text);
+
+        found = archive.find("shader.spv");
+        ASSERT_TRUE(found);
+        shaderAsset = *found;
+    }
+
+    // The asset keeps the mapping alive after the archive is gone, and its
+    // data follows an entry of odd size yet is still aligned
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(shaderAsset.bytes().data()) % 16,
+              0u);
+    std::span<const uint32_t> words = shaderAsset.words();
+    ASSERT_EQ(words.size(), 3u);
+    EXPECT_EQ(words[0], word);
+
+    std::filesystem::remove(path);
+}
+
+TEST(AssetTest, RejectsBadArchives) {
+    std::string data = "data";
+    std::vector<char> file = rvivl::encodeAssetArchive(
+        {{"data.bin", {data.data(), data.size()}}});
+
+    std::filesystem::path path = tempPath("bad.pak");
+    std::vector<char> truncated(file.begin(), file.end() - 2);
+    writeFile(path, truncated);
+    EXPECT_THROW(AssetArchive archive(path.string()), std::runtime_error);
+
+    file[0] = 'X';
+    writeFile(path, file);
+    EXPECT_THROW(AssetArchive archive(path.string()), std::runtime_error);
+
+    std::filesystem::remove(path);
+    EXPECT_THROW(AssetArchive archive(path.string()), std::runtime_error);
+}
+
+TEST(AssetTest, LibraryFallsBackToDirectories) {
+    std::filesystem::path directory = tempPath("dir");
+    std::filesystem::create_directories(directory);
+    writeFile(directory / "loose.bin", {'a', 'b', 'c'});
+    writeFile(directory / "empty.bin", {});
+
+    rvivl::AssetLibrary library;
+    library.addDirectory(directory.string());
+
+    Asset loose = library.load("loose.bin");
+    EXPECT_EQ(loose.size(), 3u);
+    EXPECT_EQ(loose.bytes()[2], 'c');
+    // Three bytes are not a whole number of words
+    EXPECT_THROW(loose.words(), std::runtime_error);
+
+    EXPECT_EQ(library.load("empty.bin").size(), 0u);
+    EXPECT_FALSE(library.tryLoad("missing.bin"));
+    EXPECT_THROW(library.load("missing.bin"), std::runtime_error);
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,127 @@
+#include "quad.hpp"
+#include "rvivl/draw_batcher.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Times recording the same scene of separate quad meshes with one
+// vkCmdDrawIndexed per mesh and through a DrawBatcher.
+// Usage: batch-benchmark [draws per frame] [frames]
+int main(int argc, char **argv) {
+    const uint32_t drawCount =
+        argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 20000;
+    const uint32_t frameCount =
+        argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 100;
+    const uint32_t warmupFrames = 10;
+
+    try {
+        rvivl::RendererCreateInfo rendererInfo{};
+        rendererInfo.applicationName = "Batch Benchmark";
+        rendererInfo.headless = true;
+        rendererInfo.extent = {256, 256};
+        rendererInfo.vertexShaderCode = rvivl::embeddedShader("vertex.vert");
+        rendererInfo.fragmentShaderCode =
+            rvivl::embeddedShader("fragment.frag");
+
+        rvivl::Renderer renderer(rendererInfo);
+
+        rvivl::DrawBatcherCreateInfo batcherInfo{};
+        batcherInfo.allocator = &renderer.allocator();
+        batcherInfo.uploadQueue = &renderer.uploadQueue();
+        batcherInfo.frameCount = renderer.framesInFlight();
+        batcherInfo.multiDrawIndirect =
+            renderer.enabledFeatures().multiDrawIndirect == VK_TRUE;
+        batcherInfo.physicalDevice = renderer.physicalDevice();
+        batcherInfo.vertexStride = sizeof(Vertex);
+        batcherInfo.maxDraws = drawCount;
+
+        rvivl::DrawBatcher batcher(batcherInfo);
+
+        // The direct path gets a buffer pair per mesh, as it would without
+        // megabuffers
+        VkDeviceSize vertexSize = sizeof(vertices[0]) * vertices.size();
+        VkDeviceSize indexSize = sizeof(quadIndices[0]) * quadIndices.size();
+        std::vector<rvivl::Mesh> meshes(drawCount);
+        std::vector<rvivl::Buffer> vertexBuffers(drawCount);
+        std::vector<rvivl::Buffer> indexBuffers(drawCount);
+        for (uint32_t i = 0; i < drawCount; i++) {
+            meshes[i] = batcher.addMesh(
+                vertices.data(), static_cast<uint32_t>(vertices.size()),
+                quadIndices.data(), static_cast<uint32_t>(quadIndices.size()));
+            vertexBuffers[i] = renderer.uploadQueue().createBuffer(
+                vertices.data(), vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+            indexBuffers[i] = renderer.uploadQueue().createBuffer(
+                quadIndices.data(), indexSize,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        }
+
+        auto direct = [&](VkCommandBuffer commandBuffer) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              renderer.pipeline());
+            VkDeviceSize offsets[] = {0};
+            for (uint32_t i = 0; i < drawCount; i++) {
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1,
+                                       &vertexBuffers[i].buffer, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, indexBuffers[i].buffer, 0,
+                                     VK_INDEX_TYPE_UINT16);
+                vkCmdDrawIndexed(commandBuffer,
+                                 static_cast<uint32_t>(quadIndices.size()), 1,
+                                 0, 0, 0);
+            }
+        };
+
+        auto batched = [&](VkCommandBuffer commandBuffer) {
+            batcher.beginFrame(renderer.frameIndex());
+            for (const rvivl::Mesh &mesh : meshes) {
+                batcher.draw(renderer.pipeline(), mesh);
+            }
+            batcher.record(commandBuffer);
+        };
+
+        std::cout << "mode,draws,record_ms" << std::endl;
+
+        for (bool useBatcher : {false, true}) {
+            std::chrono::duration<double, std::milli> recordTime{0};
+            for (uint32_t frame = 0; frame < warmupFrames + frameCount;
+                 frame++) {
+                if (!renderer.beginFrame()) {
+                    throw std::runtime_error("Failed to begin frame!");
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                if (useBatcher) {
+                    batched(renderer.commandBuffer());
+                } else {
+                    direct(renderer.commandBuffer());
+                }
+                if (frame >= warmupFrames) {
+                    recordTime += std::chrono::steady_clock::now() - start;
+                }
+
+                renderer.submit();
+                renderer.endFrame();
+            }
+
+            std::cout << (useBatcher ? "indirect" : "direct") << ","
+                      << drawCount << "," << recordTime.count() / frameCount
+                      << std::endl;
+        }
+
+        renderer.waitIdle();
+        for (uint32_t i = 0; i < drawCount; i++) {
+            renderer.destroyBuffer(indexBuffers[i]);
+            renderer.destroyBuffer(vertexBuffers[i]);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
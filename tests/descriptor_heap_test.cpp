@@ -0,0 +1,49 @@
+#include "rvivl/descriptor_heap.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::DescriptorIndexAllocator;
+
+TEST(DescriptorIndexAllocatorTest, HandsOutLowSlotsFirst) {
+    DescriptorIndexAllocator allocator(3);
+    EXPECT_EQ(allocator.allocate(), 0u);
+    EXPECT_EQ(allocator.allocate(), 1u);
+    EXPECT_EQ(allocator.allocate(), 2u);
+    EXPECT_EQ(allocator.size(), 3u);
+
+    // Full until a slot comes back
+    EXPECT_EQ(allocator.allocate(), DescriptorIndexAllocator::NO_INDEX);
+    EXPECT_EQ(allocator.size(), 3u);
+}
+
+TEST(DescriptorIndexAllocatorTest, ReusesSlotsOnceTheirFrameCompleted) {
+    DescriptorIndexAllocator allocator(2);
+    uint32_t first = allocator.allocate();
+    uint32_t second = allocator.allocate();
+
+    // Frame 5 may still sample first, frame 7 second
+    allocator.free(first, 5);
+    allocator.free(second, 7);
+    EXPECT_EQ(allocator.allocate(), DescriptorIndexAllocator::NO_INDEX);
+
+    allocator.release(4);
+    EXPECT_EQ(allocator.allocate(), DescriptorIndexAllocator::NO_INDEX);
+
+    allocator.release(5);
+    EXPECT_EQ(allocator.size(), 1u);
+    EXPECT_EQ(allocator.allocate(), first);
+    EXPECT_EQ(allocator.allocate(), DescriptorIndexAllocator::NO_INDEX);
+
+    allocator.release(7);
+    EXPECT_EQ(allocator.allocate(), second);
+    EXPECT_EQ(allocator.size(), 2u);
+}
+
+TEST(DescriptorIndexAllocatorTest, IgnoresSlotsItNeverHandedOut) {
+    DescriptorIndexAllocator allocator(4);
+    allocator.free(DescriptorIndexAllocator::NO_INDEX, 0);
+    allocator.free(2, 0);
+    allocator.release(1);
+    EXPECT_EQ(allocator.size(), 0u);
+    EXPECT_EQ(allocator.allocate(), 0u);
+}
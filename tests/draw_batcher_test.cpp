@@ -0,0 +1,60 @@
+#include "rvivl/draw_batcher.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::DrawList;
+
+namespace {
+
+    VkPipeline pipeline(uintptr_t id) {
+        return reinterpret_cast<VkPipeline>(id);
+    }
+
+    VkDrawIndexedIndirectCommand command(uint32_t firstIndex) {
+        VkDrawIndexedIndirectCommand result{};
+        result.indexCount = 6;
+        result.instanceCount = 1;
+        result.firstIndex = firstIndex;
+        return result;
+    }
+
+} // namespace
+
+TEST(DrawListTest, GroupsByPipelineInFirstUseOrder) {
+    DrawList list;
+    list.add(pipeline(2), command(0));
+    list.add(pipeline(1), command(6));
+    list.add(pipeline(2), command(12));
+    list.add(pipeline(2), command(18));
+
+    ASSERT_EQ(list.batches().size(), 2u);
+    EXPECT_EQ(list.drawCount(), 4u);
+
+    const DrawList::Batch &first = list.batches()[0];
+    EXPECT_EQ(first.pipeline, pipeline(2));
+    ASSERT_EQ(first.commands.size(), 3u);
+    EXPECT_EQ(first.commands[0].firstIndex, 0u);
+    EXPECT_EQ(first.commands[1].firstIndex, 12u);
+    EXPECT_EQ(first.commands[2].firstIndex, 18u);
+
+    EXPECT_EQ(list.batches()[1].pipeline, pipeline(1));
+    EXPECT_EQ(list.batches()[1].commands.size(), 1u);
+}
+
+TEST(DrawListTest, ClearKeepsStorage) {
+    DrawList list;
+    for (uint32_t i = 0; i < 100; i++) {
+        list.add(pipeline(1 + i % 2), command(i));
+    }
+    const VkDrawIndexedIndirectCommand *storage =
+        list.batches()[0].commands.data();
+
+    list.clear();
+    EXPECT_EQ(list.drawCount(), 0u);
+    EXPECT_TRUE(list.batches().empty());
+
+    list.add(pipeline(3), command(0));
+    ASSERT_EQ(list.batches().size(), 1u);
+    EXPECT_EQ(list.batches()[0].pipeline, pipeline(3));
+    EXPECT_EQ(list.batches()[0].commands.data(), storage);
+}
@@ -0,0 +1,220 @@
+#include "quad.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace {
+
+    // Every heap allocation of the process, counted by the replaced global
+    // operator new below
+    std::atomic<uint64_t> allocationCount{0};
+
+    // Nearest rank percentile of sorted samples
+    double percentile(const std::vector<double> &sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.5);
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    void writeStats(std::ostream &out, const char *name,
+                    std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        out << "\"" << name << "\":{\"p50\":" << percentile(samples, 0.50)
+            << ",\"p99\":" << percentile(samples, 0.99)
+            << ",\"max\":" << (samples.empty() ? 0.0 : samples.back())
+            << "}";
+    }
+
+    // A mesh of vertexCount / 4 small quads on a grid that covers the
+    // same area as the red quad
+    void buildMesh(uint32_t vertexCount, std::vector<Vertex> &meshVertices,
+                   std::vector<uint16_t> &meshIndices) {
+        uint32_t quadCount = std::clamp(vertexCount / 4, 1u, 16384u);
+        uint32_t columns = 1;
+        while (columns * columns < quadCount) {
+            columns++;
+        }
+
+        float size = 1.0f / columns;
+        for (uint32_t quad = 0; quad < quadCount; quad++) {
+            float x = -0.5f + (quad % columns) * size;
+            float y = -0.5f + (quad / columns) * size;
+            auto first = static_cast<uint16_t>(meshVertices.size());
+            for (const Vertex &corner : vertices) {
+                meshVertices.push_back(
+                    {{x + (corner.pos.x + 0.5f) * size,
+                      y + (corner.pos.y + 0.5f) * size},
+                     corner.color});
+            }
+            for (uint16_t index : quadIndices) {
+                meshIndices.push_back(static_cast<uint16_t>(first + index));
+            }
+        }
+    }
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// Renders frames headlessly and prints one JSON object with the CPU frame
+// time, the GPU time of the frames, the frame rate and the heap
+// allocations per frame.
+// Usage: frame-benchmark [--frames N] [--warmup N] [--draws N]
+//                        [--vertices N] [--threads N]
+int main(int argc, char **argv) {
+    uint32_t frameCount = 500;
+    uint32_t warmupFrames = 20;
+    uint32_t drawCount = 1000;
+    uint32_t vertexCount = 4;
+    uint32_t threads = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto value = static_cast<uint32_t>(std::atoi(argv[i + 1]));
+        if (std::strcmp(argv[i], "--frames") == 0) {
+            frameCount = std::max(value, 1u);
+        } else if (std::strcmp(argv[i], "--warmup") == 0) {
+            warmupFrames = value;
+        } else if (std::strcmp(argv[i], "--draws") == 0) {
+            drawCount = value;
+        } else if (std::strcmp(argv[i], "--vertices") == 0) {
+            vertexCount = value;
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = value;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+
+    try {
+        rvivl::RendererCreateInfo rendererInfo{};
+        rendererInfo.applicationName = "Frame Benchmark";
+        rendererInfo.headless = true;
+        rendererInfo.extent = {256, 256};
+        rendererInfo.vertexShaderCode = rvivl::embeddedShader("vertex.vert");
+        rendererInfo.fragmentShaderCode =
+            rvivl::embeddedShader("fragment.frag");
+        rendererInfo.recordingThreads = threads;
+        rendererInfo.profiling = true;
+
+        rvivl::Renderer renderer(rendererInfo);
+
+        std::vector<Vertex> meshVertices;
+        std::vector<uint16_t> meshIndices;
+        buildMesh(vertexCount, meshVertices, meshIndices);
+        auto indexCount = static_cast<uint32_t>(meshIndices.size());
+
+        rvivl::Buffer vertexBuffer = renderer.uploadQueue().createBuffer(
+            meshVertices.data(), sizeof(Vertex) * meshVertices.size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        rvivl::Buffer indexBuffer = renderer.uploadQueue().createBuffer(
+            meshIndices.data(), sizeof(uint16_t) * meshIndices.size(),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        auto record = [&](VkCommandBuffer commandBuffer, uint32_t,
+                          uint32_t count) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              renderer.pipeline());
+
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer,
+                                   offsets);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0,
+                                 VK_INDEX_TYPE_UINT16);
+            for (uint32_t i = 0; i < count; i++) {
+                vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            }
+        };
+
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+        cpuTimes.reserve(frameCount);
+        gpuTimes.reserve(frameCount);
+        uint64_t lastGpuFrame = 0;
+        uint64_t allocations = 0;
+        auto measureStart = std::chrono::steady_clock::now();
+
+        for (uint32_t frame = 0; frame < warmupFrames + frameCount; frame++) {
+            bool measured = frame >= warmupFrames;
+            if (frame == warmupFrames) {
+                measureStart = std::chrono::steady_clock::now();
+            }
+            uint64_t allocationsBefore =
+                allocationCount.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+
+            if (!renderer.beginFrame(
+                    VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)) {
+                throw std::runtime_error("Failed to begin frame!");
+            }
+            renderer.recordParallel(drawCount, record);
+            renderer.submit();
+            renderer.endFrame();
+
+            if (!measured) {
+                continue;
+            }
+            cpuTimes.push_back(std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count());
+            allocations += allocationCount.load(std::memory_order_relaxed) -
+                           allocationsBefore;
+
+            // A frame's GPU time is read once its slot comes round again
+            const rvivl::Profiler &profiler = renderer.profiler();
+            if (profiler.lastGpuFrame() != lastGpuFrame) {
+                lastGpuFrame = profiler.lastGpuFrame();
+                gpuTimes.push_back(std::chrono::duration<double, std::milli>(
+                                       profiler.lastGpuFrameTime())
+                                       .count());
+            }
+        }
+
+        renderer.waitIdle();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - measureStart;
+
+        std::cout << "{\"frames\":" << frameCount << ",\"draws\":" << drawCount
+                  << ",\"vertices\":" << meshVertices.size()
+                  << ",\"threads\":" << renderer.jobs().threadCount() << ",";
+        writeStats(std::cout, "cpu_frame_ms", cpuTimes);
+        std::cout << ",";
+        writeStats(std::cout, "gpu_frame_ms", gpuTimes);
+        std::cout << ",\"gpu_timestamps\":"
+                  << (renderer.profiler().gpuTimestamps() ? "true" : "false")
+                  << ",\"fps\":" << frameCount / elapsed.count()
+                  << ",\"allocations_per_frame\":"
+                  << double(allocations) / frameCount << "}" << std::endl;
+
+        renderer.destroyBuffer(indexBuffer);
+        renderer.destroyBuffer(vertexBuffer);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "rvivl/frame_pacing.hpp"
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+using rvivl::DamageRegion;
+using rvivl::LatencyTracker;
+using rvivl::PacingMode;
+using rvivl::PacingPolicy;
+
+namespace {
+
+    VkSurfaceCapabilitiesKHR capabilities(uint32_t minImageCount,
+                                          uint32_t maxImageCount) {
+        VkSurfaceCapabilitiesKHR result{};
+        result.minImageCount = minImageCount;
+        result.maxImageCount = maxImageCount;
+        return result;
+    }
+
+} // namespace
+
+TEST(FramePacingTest, ModesPickTheirPresentModes) {
+    std::vector<VkPresentModeKHR> all = {
+        VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+        VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+
+    PacingPolicy policy;
+    EXPECT_EQ(rvivl::choosePresentMode(policy, all),
+              VK_PRESENT_MODE_MAILBOX_KHR);
+
+    policy.mode = PacingMode::Throughput;
+    EXPECT_EQ(rvivl::choosePresentMode(policy, all),
+              VK_PRESENT_MODE_IMMEDIATE_KHR);
+
+    policy.mode = PacingMode::LowLatency;
+    EXPECT_EQ(rvivl::choosePresentMode(policy, all),
+              VK_PRESENT_MODE_MAILBOX_KHR);
+}
+
+TEST(FramePacingTest, FallsBackToFifo) {
+    std::vector<VkPresentModeKHR> fifoOnly = {VK_PRESENT_MODE_FIFO_KHR};
+
+    PacingPolicy policy;
+    policy.mode = PacingMode::Throughput;
+    policy.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    EXPECT_EQ(rvivl::choosePresentMode(policy, fifoOnly),
+              VK_PRESENT_MODE_FIFO_KHR);
+
+    std::vector<VkPresentModeKHR> relaxed = {VK_PRESENT_MODE_FIFO_KHR,
+                                             VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+    policy.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    EXPECT_EQ(rvivl::choosePresentMode(policy, relaxed),
+              VK_PRESENT_MODE_FIFO_KHR);
+}
+
+TEST(FramePacingTest, ClampsCounts) {
+    PacingPolicy policy;
+    EXPECT_EQ(rvivl::chooseFramesInFlight(policy), 2u);
+
+    policy.mode = PacingMode::LowLatency;
+    EXPECT_EQ(rvivl::chooseFramesInFlight(policy), 1u);
+    EXPECT_EQ(rvivl::chooseImageCount(policy, VK_PRESENT_MODE_FIFO_KHR,
+                                      capabilities(2, 8)),
+              2u);
+    EXPECT_EQ(rvivl::chooseImageCount(policy, VK_PRESENT_MODE_MAILBOX_KHR,
+                                      capabilities(2, 8)),
+              3u);
+
+    policy.mode = PacingMode::Throughput;
+    policy.framesInFlight = 100;
+    EXPECT_EQ(rvivl::chooseFramesInFlight(policy), rvivl::MAX_FRAMES_IN_FLIGHT);
+    EXPECT_EQ(rvivl::chooseImageCount(policy, VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                      capabilities(2, 3)),
+              3u);
+    // No upper limit
+    EXPECT_EQ(rvivl::chooseImageCount(policy, VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                      capabilities(2, 0)),
+              4u);
+}
+
+TEST(LatencyTrackerTest, MeasuresFromEarliestInput) {
+    LatencyTracker tracker;
+    LatencyTracker::Clock::time_point start{};
+
+    tracker.input(start + 5ms);
+    tracker.input(start);
+    tracker.beginFrame();
+    tracker.present(start + 10ms);
+
+    rvivl::LatencyStats stats = tracker.stats();
+    EXPECT_EQ(stats.samples, 1u);
+    EXPECT_EQ(stats.last, 10ms);
+}
+
+TEST(LatencyTrackerTest, LateInputCountsTowardsNextFrame) {
+    LatencyTracker tracker;
+    LatencyTracker::Clock::time_point start{};
+
+    tracker.beginFrame();
+    tracker.input(start);
+    tracker.present(start + 2ms);
+    EXPECT_EQ(tracker.stats().samples, 0u);
+
+    tracker.beginFrame();
+    tracker.present(start + 20ms);
+    tracker.beginFrame();
+    tracker.present(start + 30ms);
+
+    rvivl::LatencyStats stats = tracker.stats();
+    EXPECT_EQ(stats.samples, 1u);
+    EXPECT_EQ(stats.last, 20ms);
+    EXPECT_EQ(stats.average, 20ms);
+    EXPECT_EQ(stats.max, 20ms);
+}
+
+TEST(DamageRegionTest, MergesOverlappingRects) {
+    DamageRegion damage;
+    EXPECT_TRUE(damage.empty());
+
+    damage.add({{0, 0}, {0, 10}});
+    EXPECT_TRUE(damage.empty());
+
+    damage.add({{0, 0}, {10, 10}});
+    damage.add({{50, 50}, {10, 10}});
+    ASSERT_EQ(damage.rects().size(), 2u);
+
+    // Bridges both, so all three end up in one
+    damage.add({{5, 5}, {50, 50}});
+    ASSERT_EQ(damage.rects().size(), 1u);
+    VkRect2D rect = damage.rects()[0];
+    EXPECT_EQ(rect.offset.x, 0);
+    EXPECT_EQ(rect.offset.y, 0);
+    EXPECT_EQ(rect.extent.width, 60u);
+    EXPECT_EQ(rect.extent.height, 60u);
+}
+
+TEST(DamageRegionTest, CollapsesIntoBoundsWhenOutOfRects) {
+    DamageRegion damage;
+    for (int32_t i = 0; i <= int32_t(DamageRegion::MAX_RECTS); i++) {
+        damage.add({{i * 20, 0}, {10, 10}});
+    }
+    ASSERT_EQ(damage.rects().size(), 1u);
+    EXPECT_EQ(damage.rects()[0].extent.width,
+              DamageRegion::MAX_RECTS * 20 + 10);
+}
+
+TEST(DamageRegionTest, FullDamageHasNoRects) {
+    DamageRegion damage;
+    damage.add({{0, 0}, {10, 10}});
+    damage.addAll();
+    EXPECT_FALSE(damage.empty());
+    EXPECT_TRUE(damage.full());
+    EXPECT_TRUE(damage.rects().empty());
+
+    damage.add({{0, 0}, {10, 10}});
+    EXPECT_TRUE(damage.rects().empty());
+
+    damage.clear();
+    EXPECT_TRUE(damage.empty());
+    EXPECT_FALSE(damage.full());
+}
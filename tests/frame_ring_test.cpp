@@ -0,0 +1,60 @@
+#include "rvivl/frame_ring.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using rvivl::FrameRegions;
+
+namespace {
+
+    struct Transform {
+        float scale[4];
+        float offset[2];
+    };
+
+} // namespace
+
+TEST(FrameRegionsTest, AlignsUniformsWithinTheBuffer) {
+    // The second region starts at 1000, which is not a multiple of 256
+    FrameRegions regions(2, 1000, 256);
+
+    for (uint32_t frame = 0; frame < 2; ++frame) {
+        regions.beginFrame(frame);
+
+        VkDeviceSize vertices = 0;
+        ASSERT_TRUE(regions.allocate(12, 4, vertices));
+        for (int i = 0; i < 3; ++i) {
+            VkDeviceSize offset = 0;
+            ASSERT_TRUE(regions.allocateUniform(sizeof(Transform),
+                                                alignof(Transform), offset));
+            EXPECT_EQ(offset % 256, 0u);
+            EXPECT_GE(offset, 1000u * frame);
+            EXPECT_LE(offset + sizeof(Transform), 1000u * (frame + 1));
+        }
+    }
+}
+
+TEST(FrameRegionsTest, KeepsLargerTypeAlignment) {
+    FrameRegions regions(1, 4096, 64);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(regions.allocate(1, 1, offset));
+    ASSERT_TRUE(regions.allocateUniform(16, 512, offset));
+    EXPECT_EQ(offset, 512u);
+}
+
+TEST(FrameRegionsTest, FailsWhenTheRegionIsFull) {
+    FrameRegions regions(2, 512, 256);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(regions.allocateUniform(16, 4, offset));
+    ASSERT_TRUE(regions.allocateUniform(16, 4, offset));
+    EXPECT_EQ(offset, 256u);
+    EXPECT_FALSE(regions.allocateUniform(16, 4, offset));
+
+    // The next frame starts from the beginning of its own region
+    regions.beginFrame(1);
+    ASSERT_TRUE(regions.allocateUniform(16, 4, offset));
+    EXPECT_EQ(offset, 512u);
+    EXPECT_THROW(regions.beginFrame(2), std::runtime_error);
+}
@@ -0,0 +1,663 @@
+#include "quad.hpp"
+#include "rvivl/frame_ring.hpp"
+#include "rvivl/image_processor.hpp"
+#include "rvivl/render_graph.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+#include "rvivl/texture_streamer.hpp"
+#include "rvivl/tiled_image.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Renders the red quad without a window and checks the read back pixels.
+// --dynamic-rendering renders without a render pass where supported,
+// --instanced draws the quad through the instanced pipeline and --compact
+// with half float positions and 8 bit colors. --textured streams a red
+// image from disk and draws it where the quad would be, --tiled does the
+// same through a tile pyramid. --no-bindless samples them through per-frame
+// descriptor sets even where a descriptor heap is supported. --profiled
+// checks that GPU timestamps of the frames come back and writes them to
+// headless-trace.json. --compute also converts a red YUV frame, downscales
+// and tonemaps it with compute shaders before the first frame's render
+// pass and checks the result; with --async-compute it does so on the
+// compute queue instead, and with --graph through a render graph with
+// transient images. --immediate writes the quad's vertices, indices and
+// the transforms of its two halves into the renderer's frame arena every
+// frame and draws from there, binding the transforms at dynamic offsets.
+int main(int argc, char **argv) {
+    const uint32_t frameCount = 3;
+
+    bool dynamicRendering = false;
+    bool instanced = false;
+    bool compact = false;
+    bool textured = false;
+    bool tiled = false;
+    bool profiled = false;
+    bool compute = false;
+    bool asyncCompute = false;
+    bool graph = false;
+    bool immediate = false;
+    bool bindless = true;
+    for (int i = 1; i < argc; i++) {
+        dynamicRendering |= std::strcmp(argv[i], "--dynamic-rendering") == 0;
+        instanced |= std::strcmp(argv[i], "--instanced") == 0;
+        compact |= std::strcmp(argv[i], "--compact") == 0;
+        textured |= std::strcmp(argv[i], "--textured") == 0;
+        tiled |= std::strcmp(argv[i], "--tiled") == 0;
+        profiled |= std::strcmp(argv[i], "--profiled") == 0;
+        compute |= std::strcmp(argv[i], "--compute") == 0;
+        asyncCompute |= std::strcmp(argv[i], "--async-compute") == 0;
+        graph |= std::strcmp(argv[i], "--graph") == 0;
+        immediate |= std::strcmp(argv[i], "--immediate") == 0;
+        bindless &= std::strcmp(argv[i], "--no-bindless") != 0;
+    }
+
+    rvivl::RendererCreateInfo rendererInfo{};
+    rendererInfo.applicationName = "Headless Red Quad";
+    rendererInfo.headless = true;
+    rendererInfo.enableReadback = true;
+    rendererInfo.extent = {64, 64};
+    rendererInfo.colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    rendererInfo.dynamicRendering = dynamicRendering;
+    rendererInfo.profiling = profiled;
+    rendererInfo.bindless = bindless;
+    if (compact) {
+        rendererInfo.vertexInput = rvivl::VertexInput::of<rvivl::HalfVertex>();
+    }
+
+    try {
+        rendererInfo.vertexShaderCode = rvivl::embeddedShader("vertex.vert");
+        rendererInfo.fragmentShaderCode =
+            rvivl::embeddedShader("fragment.frag");
+        if (instanced) {
+            rendererInfo.instancedVertexShaderCode =
+                rvivl::embeddedShader("instanced.vert");
+        }
+
+        rvivl::Renderer renderer(rendererInfo);
+
+        std::vector<rvivl::HalfVertex> compactVertices;
+        for (const Vertex &vertex : vertices) {
+            compactVertices.push_back(
+                {rvivl::Half2::encode(vertex.pos.x, vertex.pos.y),
+                 rvivl::Unorm4::encode(vertex.color.r, vertex.color.g,
+                                       vertex.color.b)});
+        }
+
+        const void *vertexData = vertices.data();
+        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        if (compact) {
+            vertexData = compactVertices.data();
+            bufferSize = sizeof(compactVertices[0]) * compactVertices.size();
+        }
+        rvivl::Buffer vertexBuffer = renderer.uploadQueue().createBuffer(
+            vertexData, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+        VkDeviceSize indexBufferSize =
+            sizeof(quadIndices[0]) * quadIndices.size();
+        rvivl::Buffer indexBuffer = renderer.uploadQueue().createBuffer(
+            quadIndices.data(), indexBufferSize,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        rvivl::FrameRingCreateInfo ringInfo{};
+        ringInfo.allocator = &renderer.allocator();
+        ringInfo.frameCount = renderer.framesInFlight();
+        ringInfo.frameSize = 64 * 1024;
+        rvivl::FrameRing instanceRing(ringInfo);
+
+        // Two stacked halves of the quad, so the image matches the
+        // non-instanced draw only if both instances land
+        const std::vector<rvivl::Instance> instances = {
+            {{1.0f, 0.0f, 0.0f, 0.5f},
+             {0.0f, -0.25f},
+             {1.0f, 1.0f, 1.0f, 1.0f}},
+            {{1.0f, 0.0f, 0.0f, 0.5f}, {0.0f, 0.25f}, {1.0f, 1.0f, 1.0f, 1.0f}},
+        };
+
+        // Left and right half of the quad, each drawn with its own
+        // transform.vert uniform from the frame arena
+        struct Transform {
+            float transform[4];
+            float offset[2];
+        };
+        const Transform halves[] = {
+            {{0.5f, 0.0f, 0.0f, 1.0f}, {-0.25f, 0.0f}},
+            {{0.5f, 0.0f, 0.0f, 1.0f}, {0.25f, 0.0f}},
+        };
+
+        VkDescriptorSetLayout transformSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout transformLayout = VK_NULL_HANDLE;
+        VkPipeline transformPipeline = VK_NULL_HANDLE;
+        if (immediate) {
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = 0;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            binding.descriptorCount = 1;
+            binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+            VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+            setLayoutInfo.sType =
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            setLayoutInfo.bindingCount = 1;
+            setLayoutInfo.pBindings = &binding;
+            if (vkCreateDescriptorSetLayout(renderer.device(), &setLayoutInfo,
+                                            nullptr, &transformSetLayout) !=
+                VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create transform descriptor set layout!");
+            }
+
+            VkPipelineLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            layoutInfo.setLayoutCount = 1;
+            layoutInfo.pSetLayouts = &transformSetLayout;
+            if (vkCreatePipelineLayout(renderer.device(), &layoutInfo,
+                                       nullptr,
+                                       &transformLayout) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to create transform pipeline layout!");
+            }
+
+            rvivl::PipelineDesc desc = renderer.pipelineDesc();
+            desc.vertexShader = renderer.pipelines().shaderModule(
+                rvivl::embeddedShader("transform.vert"));
+            desc.layout = transformLayout;
+            transformPipeline = renderer.pipelines().get(desc);
+        }
+
+        std::optional<rvivl::TextureStreamer> streamer;
+        std::optional<rvivl::TiledImage> tiledImage;
+        rvivl::TextureId texture = 0;
+        const uint32_t imageSize = tiled ? 600 : 16;
+        rvivl::TileView tileView;
+        tileView.centerX = imageSize / 2.0;
+        tileView.centerY = imageSize / 2.0;
+        tileView.scale = renderer.extent().width / 2.0 / imageSize;
+        tileView.viewport = renderer.extent();
+        if (textured || tiled) {
+            const char *path = "headless-texture.ppm";
+            {
+                const uint32_t size = imageSize;
+                std::ofstream file(path, std::ios::binary);
+                file << "P6\n" << size << " " << size << "\n255\n";
+                for (uint32_t p = 0; p < size * size; p++) {
+                    file.put(char(255)).put(0).put(0);
+                }
+            }
+
+            rvivl::TextureStreamerCreateInfo streamerInfo{};
+            streamerInfo.renderer = &renderer;
+            streamer.emplace(streamerInfo);
+
+            auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            if (tiled) {
+                // Small tiles so the view spans several of them
+                rvivl::TiledImageCreateInfo tiledInfo{};
+                tiledInfo.renderer = &renderer;
+                tiledInfo.streamer = &*streamer;
+                tiledInfo.source =
+                    std::make_shared<rvivl::PnmTileSource>(path, 16);
+                tiledInfo.atlasSize = 256;
+                tiledImage.emplace(tiledInfo);
+
+                tiledImage->update(tileView);
+                while (tiledImage->missingTiles() > 0) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        throw std::runtime_error("Failed to load the tiles!");
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    tiledImage->update(tileView);
+                }
+            } else {
+                // Nothing here blocks, the texture turns up in a later
+                // update
+                texture = streamer->load(path);
+                while (!streamer->ready(texture)) {
+                    if (streamer->state(texture) ==
+                            rvivl::TextureState::Failed ||
+                        std::chrono::steady_clock::now() > deadline) {
+                        throw std::runtime_error(
+                            "Failed to stream the texture!");
+                    }
+                    streamer->update();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
+
+        std::optional<rvivl::ImageProcessor> processor;
+        std::optional<rvivl::RenderGraph> renderGraph;
+        rvivl::ProcessedImage converted;
+        rvivl::ProcessedImage downscaled;
+        rvivl::ProcessedImage tonemapped;
+        rvivl::Buffer yuvBuffer;
+        rvivl::Buffer computeReadback;
+        rvivl::YuvFrame yuvFrame;
+        const uint32_t yuvSize = 32;
+        const VkExtent2D yuvExtent = {yuvSize, yuvSize};
+        const VkExtent2D smallExtent = {yuvSize / 2, yuvSize / 2};
+        if (compute) {
+            rvivl::ImageProcessorCreateInfo processorInfo{};
+            processorInfo.renderer = &renderer;
+            processor.emplace(processorInfo);
+
+            rvivl::RenderGraphCreateInfo graphInfo{};
+            graphInfo.renderer = &renderer;
+            renderGraph.emplace(graphInfo);
+
+            converted = processor->createImage(yuvExtent);
+            downscaled = processor->createImage(smallExtent);
+            tonemapped = processor->createImage(smallExtent);
+
+            yuvBuffer = renderer.createBuffer(
+                rvivl::YuvFrame::packedSize(yuvSize, yuvSize),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            computeReadback = renderer.createBuffer(
+                VkDeviceSize(smallExtent.width) * smallExtent.height * 4,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            // Pure red in full range BT.601
+            yuvFrame =
+                rvivl::YuvFrame::packed(yuvBuffer.buffer, yuvSize, yuvSize);
+            yuvFrame.matrix = rvivl::YuvMatrix::Bt601;
+            yuvFrame.range = rvivl::YuvRange::Full;
+            auto *planes = static_cast<uint8_t *>(yuvBuffer.allocation.mapped);
+            const size_t chromaSize = (yuvSize / 2) * (yuvSize / 2);
+            std::memset(planes + yuvFrame.yOffset, 76, yuvSize * yuvSize);
+            std::memset(planes + yuvFrame.uOffset, 85, chromaSize);
+            std::memset(planes + yuvFrame.vOffset, 255, chromaSize);
+        }
+
+        // Outside the render pass and only once, so the images are never
+        // written by two frames in flight
+        auto recordCompute = [&](VkCommandBuffer commandBuffer) {
+            for (const rvivl::ProcessedImage *image :
+                 {&converted, &downscaled, &tonemapped}) {
+                rvivl::imageBarrier(commandBuffer, image->image.image,
+                                    VK_IMAGE_LAYOUT_UNDEFINED,
+                                    VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_ACCESS_SHADER_WRITE_BIT);
+            }
+            auto computeToCompute = [&](const rvivl::ProcessedImage &image) {
+                rvivl::imageBarrier(commandBuffer, image.image.image,
+                                    VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_ACCESS_SHADER_WRITE_BIT,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_ACCESS_SHADER_READ_BIT);
+            };
+
+            processor->convertYuv(commandBuffer, yuvFrame, converted.view);
+            computeToCompute(converted);
+            processor->downscale(commandBuffer, converted.view, yuvExtent,
+                                 downscaled.view, smallExtent);
+            computeToCompute(downscaled);
+
+            rvivl::TonemapSettings settings;
+            settings.op = rvivl::TonemapOperator::Clamp;
+            processor->tonemap(commandBuffer, downscaled.view,
+                               tonemapped.view, smallExtent, settings);
+
+            rvivl::imageBarrier(
+                commandBuffer, tonemapped.image.image, VK_IMAGE_LAYOUT_GENERAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT);
+
+            VkBufferImageCopy region{};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = {smallExtent.width, smallExtent.height, 1};
+            vkCmdCopyImageToBuffer(commandBuffer, tonemapped.image.image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   computeReadback.buffer, 1, &region);
+
+            VkMemoryBarrier hostBarrier{};
+            hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                                 &hostBarrier, 0, nullptr, 0, nullptr);
+        };
+
+        // The same passes on transient images, plus one whose result is
+        // never read
+        auto recordGraph = [&](VkCommandBuffer commandBuffer) {
+            using rvivl::ImageUsage;
+            rvivl::RenderGraphImage full = renderGraph->createImage(
+                "converted", yuvExtent, VK_FORMAT_R8G8B8A8_UNORM);
+            rvivl::RenderGraphImage small = renderGraph->createImage(
+                "downscaled", smallExtent, VK_FORMAT_R8G8B8A8_UNORM);
+            rvivl::RenderGraphImage result = renderGraph->createImage(
+                "tonemapped", smallExtent, VK_FORMAT_R8G8B8A8_UNORM);
+            rvivl::RenderGraphImage unused = renderGraph->createImage(
+                "unused", smallExtent, VK_FORMAT_R8G8B8A8_UNORM);
+
+            rvivl::ImageAccess convertAccesses[] = {
+                {full, ImageUsage::StorageWrite}};
+            renderGraph->addPass(
+                "convert", convertAccesses,
+                [&, full](VkCommandBuffer cb, const rvivl::RenderGraph &g) {
+                    processor->convertYuv(cb, yuvFrame, g.view(full));
+                });
+
+            rvivl::ImageAccess unusedAccesses[] = {
+                {full, ImageUsage::SampledCompute},
+                {unused, ImageUsage::StorageWrite}};
+            renderGraph->addPass(
+                "unused", unusedAccesses,
+                [&, full, unused](VkCommandBuffer cb,
+                                  const rvivl::RenderGraph &g) {
+                    processor->downscale(
+                        cb, g.view(full), yuvExtent, g.view(unused),
+                        smallExtent, false,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                });
+
+            rvivl::ImageAccess downscaleAccesses[] = {
+                {full, ImageUsage::SampledCompute},
+                {small, ImageUsage::StorageWrite}};
+            renderGraph->addPass(
+                "downscale", downscaleAccesses,
+                [&, full, small](VkCommandBuffer cb,
+                                 const rvivl::RenderGraph &g) {
+                    processor->downscale(
+                        cb, g.view(full), yuvExtent, g.view(small),
+                        smallExtent, false,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                });
+
+            rvivl::ImageAccess tonemapAccesses[] = {
+                {small, ImageUsage::SampledCompute},
+                {result, ImageUsage::StorageWrite}};
+            renderGraph->addPass(
+                "tonemap", tonemapAccesses,
+                [&, small, result](VkCommandBuffer cb,
+                                   const rvivl::RenderGraph &g) {
+                    rvivl::TonemapSettings settings;
+                    settings.op = rvivl::TonemapOperator::Clamp;
+                    processor->tonemap(
+                        cb, g.view(small), g.view(result), smallExtent,
+                        settings, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                });
+
+            rvivl::ImageAccess readbackAccesses[] = {
+                {result, ImageUsage::TransferSrc}};
+            renderGraph->addPass(
+                "readback", readbackAccesses,
+                [&, result](VkCommandBuffer cb, const rvivl::RenderGraph &g) {
+                    VkBufferImageCopy region{};
+                    region.imageSubresource.aspectMask =
+                        VK_IMAGE_ASPECT_COLOR_BIT;
+                    region.imageSubresource.layerCount = 1;
+                    region.imageExtent = {smallExtent.width,
+                                          smallExtent.height, 1};
+                    vkCmdCopyImageToBuffer(
+                        cb, g.image(result),
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        computeReadback.buffer, 1, &region);
+
+                    VkMemoryBarrier hostBarrier{};
+                    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                                         &hostBarrier, 0, nullptr, 0,
+                                         nullptr);
+                },
+                true);
+
+            renderGraph->execute(commandBuffer);
+        };
+
+        auto recordComputePasses = [&](VkCommandBuffer commandBuffer) {
+            if (graph) {
+                recordGraph(commandBuffer);
+            } else {
+                recordCompute(commandBuffer);
+            }
+        };
+
+        for (uint32_t i = 0; i < frameCount; i++) {
+            bool begun = compute && i == 0 && !asyncCompute
+                             ? renderer.beginFrame(VK_SUBPASS_CONTENTS_INLINE,
+                                                   recordComputePasses)
+                             : renderer.beginFrame();
+            if (!begun) {
+                throw std::runtime_error("Failed to begin headless frame!");
+            }
+            if (compute && i == 0 && asyncCompute) {
+                recordComputePasses(renderer.beginAsyncCompute());
+                renderer.submitAsyncCompute();
+            }
+
+            VkCommandBuffer commandBuffer = renderer.commandBuffer();
+            if (tiled) {
+                tiledImage->update(tileView);
+                tiledImage->draw(commandBuffer);
+                renderer.submit();
+                renderer.endFrame();
+                continue;
+            }
+            if (textured) {
+                streamer->update();
+
+                // Left and right half of the quad's pixels in one batch
+                const rvivl::TextureDraw draws[] = {
+                    {texture, {-0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.5f}},
+                    {texture, {0.0f, -0.5f, 0.5f, 1.0f, 0.5f, 0.0f, 0.5f}},
+                };
+                if (streamer->draw(commandBuffer, draws) != 2) {
+                    throw std::runtime_error("Failed to draw the texture!");
+                }
+                renderer.submit();
+                renderer.endFrame();
+                continue;
+            }
+
+            VkPipeline pipeline = renderer.pipeline();
+            if (immediate) {
+                pipeline = transformPipeline;
+            } else if (instanced) {
+                pipeline = renderer.instancedPipeline();
+            }
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipeline);
+
+            if (immediate) {
+                rvivl::FrameAllocation vertexArena =
+                    renderer.frameArena().allocate(bufferSize, 4);
+                std::memcpy(vertexArena.mapped, vertexData, bufferSize);
+                rvivl::FrameAllocation indexArena = renderer.frameArena().push(
+                    std::span<const uint16_t>(quadIndices));
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1,
+                                       &vertexArena.buffer,
+                                       &vertexArena.offset);
+                vkCmdBindIndexBuffer(commandBuffer, indexArena.buffer,
+                                     indexArena.offset, VK_INDEX_TYPE_UINT16);
+            } else {
+                VkDeviceSize offsets[] = {0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1,
+                                       &vertexBuffer.buffer, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0,
+                                     VK_INDEX_TYPE_UINT16);
+            }
+
+            uint32_t instanceCount = 1;
+            if (instanced) {
+                instanceRing.beginFrame(renderer.frameIndex());
+                rvivl::FrameAllocation instanceData = instanceRing.push(
+                    std::span<const rvivl::Instance>(instances));
+                vkCmdBindVertexBuffers(commandBuffer, rvivl::Instance::BINDING,
+                                       1, &instanceData.buffer,
+                                       &instanceData.offset);
+                instanceCount = static_cast<uint32_t>(instances.size());
+            }
+
+            if (immediate) {
+                // One descriptor for the frame, moved to each half's
+                // uniform by its dynamic offset
+                VkDescriptorSet transformSet =
+                    renderer.frameDescriptors().allocate(transformSetLayout);
+                VkDescriptorBufferInfo bufferInfo =
+                    renderer.frameArena().bufferInfo(sizeof(Transform));
+                VkWriteDescriptorSet write{};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = transformSet;
+                write.dstBinding = 0;
+                write.descriptorCount = 1;
+                write.descriptorType =
+                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                write.pBufferInfo = &bufferInfo;
+                vkUpdateDescriptorSets(renderer.device(), 1, &write, 0,
+                                       nullptr);
+
+                for (const Transform &half : halves) {
+                    uint32_t dynamicOffset =
+                        renderer.frameArena().pushUniform(half).dynamicOffset();
+                    vkCmdBindDescriptorSets(
+                        commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        transformLayout, 0, 1, &transformSet, 1,
+                        &dynamicOffset);
+                    vkCmdDrawIndexed(commandBuffer,
+                                     static_cast<uint32_t>(quadIndices.size()),
+                                     1, 0, 0, 0);
+                }
+            } else {
+                vkCmdDrawIndexed(commandBuffer,
+                                 static_cast<uint32_t>(quadIndices.size()),
+                                 instanceCount, 0, 0, 0);
+            }
+
+            renderer.submit();
+            renderer.endFrame();
+        }
+
+        VkExtent2D extent = renderer.extent();
+        std::vector<uint8_t> pixels(size_t(extent.width) * extent.height * 4);
+        renderer.readback(pixels.data());
+
+        renderer.waitIdle();
+        if (profiled) {
+            // Every frame slot but the last frame's has been read back
+            rvivl::Profiler &profiler = renderer.profiler();
+            uint32_t gpuFrames = 0;
+            for (const rvivl::ProfileEvent &event : profiler.events()) {
+                gpuFrames += event.track == rvivl::ProfileTrack::Gpu;
+            }
+            if (profiler.gpuTimestamps() && gpuFrames == 0) {
+                std::cerr << "Expected GPU timestamps of the frames"
+                          << std::endl;
+                return 1;
+            }
+            profiler.saveChromeTrace("headless-trace.json");
+            std::cout << "GPU frames timed: " << gpuFrames << ", last took "
+                      << profiler.lastGpuFrameTime().count() << " ns"
+                      << std::endl;
+        }
+        std::vector<uint8_t> computed;
+        rvivl::RenderGraphStats graphStats;
+        if (compute) {
+            const auto *texels =
+                static_cast<const uint8_t *>(computeReadback.allocation.mapped);
+            computed.assign(texels, texels + computeReadback.size);
+            graphStats = renderGraph->stats();
+            renderGraph.reset();
+            processor->destroyImage(tonemapped);
+            processor->destroyImage(downscaled);
+            processor->destroyImage(converted);
+            processor.reset();
+            renderer.destroyBuffer(computeReadback);
+            renderer.destroyBuffer(yuvBuffer);
+        }
+        if (immediate) {
+            vkDestroyPipelineLayout(renderer.device(), transformLayout,
+                                    nullptr);
+            vkDestroyDescriptorSetLayout(renderer.device(), transformSetLayout,
+                                         nullptr);
+        }
+        tiledImage.reset();
+        streamer.reset();
+        renderer.destroyBuffer(indexBuffer);
+        renderer.destroyBuffer(vertexBuffer);
+
+        const uint8_t *center =
+            &pixels[((extent.height / 2) * extent.width + extent.width / 2) *
+                    4];
+        const uint8_t *corner = &pixels[0];
+
+        if (center[0] != 255 || center[1] != 0 || center[2] != 0) {
+            std::cerr << "Expected a red pixel in the center, got "
+                      << int(center[0]) << ", " << int(center[1]) << ", "
+                      << int(center[2]) << std::endl;
+            return 1;
+        }
+        if (corner[0] != 0 || corner[1] != 0 || corner[2] != 0) {
+            std::cerr << "Expected the clear color in the corner, got "
+                      << int(corner[0]) << ", " << int(corner[1]) << ", "
+                      << int(corner[2]) << std::endl;
+            return 1;
+        }
+        // Each half comes from its own uniform
+        for (uint32_t x : {extent.width * 5 / 16, extent.width * 11 / 16}) {
+            const uint8_t *pixel =
+                &pixels[((extent.height / 2) * extent.width + x) * 4];
+            if (immediate && (pixel[0] != 255 || pixel[1] != 0 ||
+                              pixel[2] != 0)) {
+                std::cerr << "Expected a red pixel at x = " << x << ", got "
+                          << int(pixel[0]) << ", " << int(pixel[1]) << ", "
+                          << int(pixel[2]) << std::endl;
+                return 1;
+            }
+        }
+        // 8 bit YUV cannot hit pure red exactly
+        for (size_t p = 0; p < computed.size(); p += 4) {
+            if (computed[p] < 253 || computed[p + 1] > 2 ||
+                computed[p + 2] > 2) {
+                std::cerr << "Expected red from the compute passes, got "
+                          << int(computed[p]) << ", " << int(computed[p + 1])
+                          << ", " << int(computed[p + 2]) << std::endl;
+                return 1;
+            }
+        }
+        // The tonemapped image takes the converted one's memory
+        if (graph && (graphStats.culledPasses != 1 ||
+                      graphStats.transientImages != 3 ||
+                      graphStats.memorySlots != 2)) {
+            std::cerr << "Expected one culled pass and three transient "
+                         "images in two memory slots, got "
+                      << graphStats.culledPasses << ", "
+                      << graphStats.transientImages << ", "
+                      << graphStats.memorySlots << std::endl;
+            return 1;
+        }
+
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    std::cout << "Headless rendering produced the expected image."
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "rvivl/image_decode.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using rvivl::DecodedImage;
+
+namespace {
+
+    bool decode(const std::string &data, DecodedImage &image) {
+        return rvivl::decodePnm(data, image);
+    }
+
+} // namespace
+
+TEST(ImageDecodeTest, DecodesColorPixels) {
+    std::string data = "P6\n# two pixels\n2 1\n255\n";
+    data += std::string("\xff\x00\x00\x00\x80\xff", 6);
+
+    DecodedImage image;
+    ASSERT_TRUE(decode(data, image));
+    EXPECT_EQ(image.width, 2u);
+    EXPECT_EQ(image.height, 1u);
+    std::vector<uint8_t> expected = {255, 0, 0, 255, 0, 128, 255, 255};
+    EXPECT_EQ(image.pixels, expected);
+}
+
+TEST(ImageDecodeTest, ExpandsGreyAndRescales) {
+    std::string data = "P5 1 2 15 ";
+    data += std::string("\x0f\x05", 2);
+
+    DecodedImage image;
+    ASSERT_TRUE(decode(data, image));
+    std::vector<uint8_t> expected = {255, 255, 255, 255, 85, 85, 85, 255};
+    EXPECT_EQ(image.pixels, expected);
+}
+
+TEST(ImageDecodeTest, RejectsBadData) {
+    DecodedImage image;
+    EXPECT_FALSE(decode("", image));
+    EXPECT_FALSE(decode("P3\n1 1\n255\n0 0 0", image));
+    EXPECT_FALSE(decode("P6\n0 1\n255\n", image));
+    EXPECT_FALSE(decode("P6\n1 1\n65535\n\x01\x02", image));
+    // Truncated pixels
+    EXPECT_FALSE(decode(std::string("P6\n2 1\n255\n\x01\x02\x03", 14), image));
+}
+
+TEST(ImageDecodeTest, CountsMipLevels) {
+    EXPECT_EQ(rvivl::mipLevelCount(1, 1), 1u);
+    EXPECT_EQ(rvivl::mipLevelCount(2, 1), 2u);
+    EXPECT_EQ(rvivl::mipLevelCount(256, 256), 9u);
+    EXPECT_EQ(rvivl::mipLevelCount(300, 17), 9u);
+    EXPECT_EQ(rvivl::mipLevelCount(0, 0), 1u);
+}
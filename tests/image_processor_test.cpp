@@ -0,0 +1,80 @@
+#include "rvivl/compute.hpp"
+#include "rvivl/image_processor.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::YuvFrame;
+using rvivl::YuvLayout;
+using rvivl::YuvMatrix;
+using rvivl::YuvRange;
+
+namespace {
+
+    // What shaders/yuv_to_rgb.comp computes for one pixel
+    std::array<float, 3> toRgb(YuvMatrix matrix, YuvRange range, int y,
+                               int u, int v) {
+        std::array<float, 12> rows = rvivl::yuvToRgbMatrix(matrix, range);
+        float yuv[4] = {y / 255.0f, u / 255.0f, v / 255.0f, 1.0f};
+        std::array<float, 3> rgb{};
+        for (int row = 0; row < 3; row++) {
+            for (int i = 0; i < 4; i++) {
+                rgb[row] += rows[row * 4 + i] * yuv[i];
+            }
+        }
+        return rgb;
+    }
+
+} // namespace
+
+TEST(YuvToRgbMatrixTest, LimitedRangeSpansBlackToWhite) {
+    for (YuvMatrix matrix : {YuvMatrix::Bt601, YuvMatrix::Bt709}) {
+        for (float channel : toRgb(matrix, YuvRange::Limited, 16, 128, 128)) {
+            EXPECT_NEAR(channel, 0.0f, 1e-5f);
+        }
+        for (float channel : toRgb(matrix, YuvRange::Limited, 235, 128, 128)) {
+            EXPECT_NEAR(channel, 1.0f, 1e-5f);
+        }
+    }
+}
+
+TEST(YuvToRgbMatrixTest, RecoversPrimaries) {
+    // Red encoded in full range BT.601 and limited range BT.709
+    std::array<float, 3> red601 =
+        toRgb(YuvMatrix::Bt601, YuvRange::Full, 76, 85, 255);
+    EXPECT_NEAR(red601[0], 1.0f, 0.01f);
+    EXPECT_NEAR(red601[1], 0.0f, 0.01f);
+    EXPECT_NEAR(red601[2], 0.0f, 0.01f);
+
+    std::array<float, 3> red709 =
+        toRgb(YuvMatrix::Bt709, YuvRange::Limited, 63, 102, 240);
+    EXPECT_NEAR(red709[0], 1.0f, 0.01f);
+    EXPECT_NEAR(red709[1], 0.0f, 0.01f);
+    EXPECT_NEAR(red709[2], 0.0f, 0.01f);
+}
+
+TEST(YuvFrameTest, PacksPlanesBackToBack) {
+    YuvFrame i420 = YuvFrame::packed(VK_NULL_HANDLE, 6, 4);
+    EXPECT_EQ(i420.yOffset, 0u);
+    EXPECT_EQ(i420.yStride, 6u);
+    EXPECT_EQ(i420.uOffset, 24u);
+    EXPECT_EQ(i420.chromaStride, 3u);
+    EXPECT_EQ(i420.vOffset, 30u);
+
+    YuvFrame nv12 = YuvFrame::packed(VK_NULL_HANDLE, 6, 4, YuvLayout::Nv12);
+    EXPECT_EQ(nv12.uOffset, 24u);
+    EXPECT_EQ(nv12.chromaStride, 6u);
+    EXPECT_EQ(nv12.vOffset, 25u);
+}
+
+TEST(YuvFrameTest, PackedSizeRoundsOddSizesUp) {
+    EXPECT_EQ(YuvFrame::packedSize(6, 4), 36u);
+    // 15 luma and 2 * 6 chroma bytes, padded to whole words
+    EXPECT_EQ(YuvFrame::packedSize(5, 3), 28u);
+}
+
+TEST(ComputePipelineTest, GroupCountCoversEveryInvocation) {
+    EXPECT_EQ(rvivl::ComputePipeline::groupCount(0, 8), 0u);
+    EXPECT_EQ(rvivl::ComputePipeline::groupCount(1, 8), 1u);
+    EXPECT_EQ(rvivl::ComputePipeline::groupCount(16, 8), 2u);
+    EXPECT_EQ(rvivl::ComputePipeline::groupCount(17, 8), 3u);
+}
@@ -0,0 +1,83 @@
+#include "rvivl/job_system.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+using rvivl::JobSystem;
+
+TEST(JobSystemTest, RunsEveryJobOnce) {
+    JobSystem jobs(4);
+
+    std::vector<std::atomic<uint32_t>> runs(1000);
+    jobs.run(static_cast<uint32_t>(runs.size()),
+             [&](uint32_t index, uint32_t) { runs[index]++; });
+
+    for (const auto &count : runs) {
+        EXPECT_EQ(count.load(), 1u);
+    }
+}
+
+TEST(JobSystemTest, WorkerIndicesStayInRange) {
+    JobSystem jobs(3);
+    ASSERT_EQ(jobs.threadCount(), 3u);
+
+    std::atomic<bool> outOfRange{false};
+    for (int batch = 0; batch < 50; batch++) {
+        jobs.run(64, [&](uint32_t, uint32_t worker) {
+            if (worker >= jobs.threadCount()) {
+                outOfRange = true;
+            }
+        });
+    }
+    EXPECT_FALSE(outOfRange);
+}
+
+TEST(JobSystemTest, SingleThreadRunsInline) {
+    JobSystem jobs(1);
+    EXPECT_EQ(jobs.threadCount(), 1u);
+
+    std::vector<uint32_t> order;
+    jobs.run(5, [&](uint32_t index, uint32_t worker) {
+        EXPECT_EQ(worker, 0u);
+        order.push_back(index);
+    });
+    EXPECT_EQ(order, (std::vector<uint32_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(JobSystemTest, RethrowsJobErrors) {
+    JobSystem jobs(4);
+
+    std::atomic<uint32_t> finished{0};
+    EXPECT_THROW(jobs.run(100,
+                          [&](uint32_t index, uint32_t) {
+                              if (index == 42) {
+                                  throw std::runtime_error("job failed");
+                              }
+                              finished++;
+                          }),
+                 std::runtime_error);
+    EXPECT_EQ(finished.load(), 99u);
+
+    // The pool is still usable afterwards
+    std::atomic<uint32_t> count{0};
+    jobs.run(10, [&](uint32_t, uint32_t) { count++; });
+    EXPECT_EQ(count.load(), 10u);
+}
+
+TEST(JobSystemTest, InlineBatchRunsPastJobErrors) {
+    JobSystem jobs(1);
+
+    uint32_t finished = 0;
+    EXPECT_THROW(jobs.run(100,
+                          [&](uint32_t index, uint32_t) {
+                              if (index == 42) {
+                                  throw std::runtime_error("job failed");
+                              }
+                              finished++;
+                          }),
+                 std::runtime_error);
+    EXPECT_EQ(finished, 99u);
+}
@@ -0,0 +1,93 @@
+#include "rvivl/memory_allocator.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using rvivl::MemoryBlockMetadata;
+using rvivl::ResourceKind;
+
+TEST(MemoryBlockMetadataTest, RespectsAlignment) {
+    MemoryBlockMetadata block(1024, 1);
+
+    VkDeviceSize first = 0, second = 0;
+    ASSERT_TRUE(block.allocate(10, 1, ResourceKind::Linear, first));
+    ASSERT_TRUE(block.allocate(64, 256, ResourceKind::Linear, second));
+
+    EXPECT_EQ(first, 0u);
+    EXPECT_EQ(second, 256u);
+    EXPECT_EQ(block.bytesInUse(), 74u);
+    EXPECT_EQ(block.allocationCount(), 2u);
+}
+
+TEST(MemoryBlockMetadataTest, FailsWhenFull) {
+    MemoryBlockMetadata block(256, 1);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(block.allocate(200, 1, ResourceKind::Linear, offset));
+    EXPECT_FALSE(block.allocate(100, 1, ResourceKind::Linear, offset));
+    EXPECT_TRUE(block.allocate(56, 1, ResourceKind::Linear, offset));
+    EXPECT_EQ(block.largestFreeRange(), 0u);
+}
+
+TEST(MemoryBlockMetadataTest, CoalescesFreedNeighbours) {
+    MemoryBlockMetadata block(300, 1);
+
+    VkDeviceSize a = 0, b = 0, c = 0;
+    ASSERT_TRUE(block.allocate(100, 1, ResourceKind::Linear, a));
+    ASSERT_TRUE(block.allocate(100, 1, ResourceKind::Linear, b));
+    ASSERT_TRUE(block.allocate(100, 1, ResourceKind::Linear, c));
+
+    block.free(a);
+    block.free(c);
+    EXPECT_EQ(block.freeRangeCount(), 2u);
+    EXPECT_EQ(block.largestFreeRange(), 100u);
+
+    block.free(b);
+    EXPECT_TRUE(block.empty());
+    EXPECT_EQ(block.freeRangeCount(), 1u);
+    EXPECT_EQ(block.largestFreeRange(), 300u);
+}
+
+TEST(MemoryBlockMetadataTest, PrefersBestFit) {
+    MemoryBlockMetadata block(1000, 1);
+
+    VkDeviceSize a = 0, b = 0, c = 0, d = 0;
+    ASSERT_TRUE(block.allocate(400, 1, ResourceKind::Linear, a));
+    ASSERT_TRUE(block.allocate(100, 1, ResourceKind::Linear, b));
+    ASSERT_TRUE(block.allocate(50, 1, ResourceKind::Linear, c));
+    ASSERT_TRUE(block.allocate(100, 1, ResourceKind::Linear, d));
+
+    // Leaves a 400 byte hole, a 50 byte hole and the 350 byte tail
+    block.free(a);
+    block.free(c);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(block.allocate(40, 1, ResourceKind::Linear, offset));
+    EXPECT_EQ(offset, c);
+}
+
+TEST(MemoryBlockMetadataTest, SeparatesKindsByGranularity) {
+    MemoryBlockMetadata block(4096, 1024);
+
+    VkDeviceSize buffer = 0, image = 0, secondBuffer = 0;
+    ASSERT_TRUE(block.allocate(100, 16, ResourceKind::Linear, buffer));
+    ASSERT_TRUE(block.allocate(100, 16, ResourceKind::Optimal, image));
+    EXPECT_EQ(image, 1024u);
+
+    // Buffers still pack into the first page, next to each other
+    ASSERT_TRUE(block.allocate(100, 16, ResourceKind::Linear, secondBuffer));
+    EXPECT_EQ(secondBuffer, 112u);
+
+    VkDeviceSize secondImage = 0;
+    ASSERT_TRUE(block.allocate(100, 16, ResourceKind::Optimal, secondImage));
+    EXPECT_EQ(secondImage, 1136u);
+}
+
+TEST(MemoryBlockMetadataTest, RejectsDoubleFree) {
+    MemoryBlockMetadata block(256, 1);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(block.allocate(64, 1, ResourceKind::Linear, offset));
+    block.free(offset);
+    EXPECT_THROW(block.free(offset), std::runtime_error);
+}
@@ -0,0 +1,47 @@
+#include "rvivl/asset.hpp"
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Packs the input files into one asset archive, each named after its file
+// name: pack-assets <output> <inputs...>
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output> <inputs...>"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::vector<std::unique_ptr<rvivl::MappedFile>> files;
+        std::vector<rvivl::ArchiveEntry> entries;
+        for (int i = 2; i < argc; i++) {
+            files.push_back(std::make_unique<rvivl::MappedFile>(argv[i]));
+
+            rvivl::ArchiveEntry entry;
+            entry.name = std::filesystem::path(argv[i]).filename().string();
+            entry.data = files.back()->bytes();
+            entries.push_back(entry);
+        }
+
+        std::vector<char> archive = rvivl::encodeAssetArchive(entries);
+        std::ofstream output(argv[1], std::ios::binary | std::ios::trunc);
+        output.write(archive.data(),
+                     static_cast<std::streamsize>(archive.size()));
+        if (!output) {
+            throw std::runtime_error(std::string("Failed to write file: ") +
+                                     argv[1]);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
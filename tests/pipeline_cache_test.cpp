@@ -0,0 +1,75 @@
+#include "rvivl/pipeline_cache.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+using rvivl::decodePipelineCacheFile;
+using rvivl::encodePipelineCacheFile;
+using rvivl::PipelineCacheKey;
+
+namespace {
+
+    PipelineCacheKey testKey() {
+        PipelineCacheKey key;
+        key.vendorID = 0x10de;
+        key.deviceID = 0x2684;
+        key.driverVersion = 42;
+        key.pipelineCacheUUID.fill(7);
+        key.driverUUID.fill(9);
+        return key;
+    }
+
+    const std::vector<char> cacheData = {'d', 'r', 'i', 'v', 'e', 'r'};
+
+} // namespace
+
+TEST(PipelineCacheFileTest, RoundTrips) {
+    std::vector<char> file = encodePipelineCacheFile(testKey(), cacheData);
+
+    std::vector<char> data;
+    ASSERT_TRUE(decodePipelineCacheFile(testKey(), file, data));
+    EXPECT_EQ(data, cacheData);
+}
+
+TEST(PipelineCacheFileTest, RejectsOtherDevice) {
+    std::vector<char> file = encodePipelineCacheFile(testKey(), cacheData);
+
+    PipelineCacheKey other = testKey();
+    other.deviceID++;
+
+    std::vector<char> data;
+    EXPECT_FALSE(decodePipelineCacheFile(other, file, data));
+}
+
+TEST(PipelineCacheFileTest, RejectsOtherDriver) {
+    std::vector<char> file = encodePipelineCacheFile(testKey(), cacheData);
+
+    PipelineCacheKey updated = testKey();
+    updated.driverUUID[0] = 1;
+
+    std::vector<char> data;
+    EXPECT_FALSE(decodePipelineCacheFile(updated, file, data));
+}
+
+TEST(PipelineCacheFileTest, RejectsOtherFormatVersion) {
+    std::vector<char> file = encodePipelineCacheFile(testKey(), cacheData);
+    // The version follows the four byte magic
+    file[4]++;
+
+    std::vector<char> data;
+    EXPECT_FALSE(decodePipelineCacheFile(testKey(), file, data));
+}
+
+TEST(PipelineCacheFileTest, RejectsDamagedFiles) {
+    std::vector<char> file = encodePipelineCacheFile(testKey(), cacheData);
+    std::vector<char> data;
+
+    std::vector<char> truncated(file.begin(), file.end() - 1);
+    EXPECT_FALSE(decodePipelineCacheFile(testKey(), truncated, data));
+
+    std::vector<char> corrupted = file;
+    corrupted.back() ^= 1;
+    EXPECT_FALSE(decodePipelineCacheFile(testKey(), corrupted, data));
+
+    EXPECT_FALSE(decodePipelineCacheFile(testKey(), {}, data));
+}
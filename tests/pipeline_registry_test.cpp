@@ -0,0 +1,75 @@
+#include "rvivl/pipeline_registry.hpp"
+#include "rvivl/vertex.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::PipelineDesc;
+
+namespace {
+
+    PipelineDesc quadDesc() {
+        auto attributes = rvivl::Vertex::getAttributeDescriptions();
+
+        PipelineDesc desc;
+        desc.vertexBindings = {rvivl::Vertex::getBindingDescription()};
+        desc.vertexAttributes.assign(attributes.begin(), attributes.end());
+        return desc;
+    }
+
+} // namespace
+
+TEST(PipelineDescTest, IdenticalDescriptionsMatch) {
+    PipelineDesc a = quadDesc();
+    PipelineDesc b = quadDesc();
+
+    EXPECT_TRUE(a == b);
+    EXPECT_EQ(a.hash(), b.hash());
+}
+
+TEST(PipelineDescTest, FixedFunctionStateChangesHash) {
+    PipelineDesc base = quadDesc();
+
+    PipelineDesc blended = base;
+    blended.blendEnable = true;
+    EXPECT_FALSE(base == blended);
+    EXPECT_NE(base.hash(), blended.hash());
+
+    PipelineDesc dynamic = base;
+    dynamic.colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    EXPECT_FALSE(base == dynamic);
+    EXPECT_NE(base.hash(), dynamic.hash());
+
+    PipelineDesc culled = base;
+    culled.cullMode = VK_CULL_MODE_NONE;
+    EXPECT_FALSE(base == culled);
+    EXPECT_NE(base.hash(), culled.hash());
+}
+
+TEST(PipelineDescTest, VertexLayoutChangesHash) {
+    PipelineDesc base = quadDesc();
+
+    PipelineDesc offset = base;
+    offset.vertexAttributes[1].offset += 4;
+    EXPECT_FALSE(base == offset);
+    EXPECT_NE(base.hash(), offset.hash());
+
+    PipelineDesc fewer = base;
+    fewer.vertexAttributes.pop_back();
+    EXPECT_FALSE(base == fewer);
+    EXPECT_NE(base.hash(), fewer.hash());
+}
+
+TEST(PipelineDescTest, StateHashIgnoresHandleValues) {
+    PipelineDesc a = quadDesc();
+    a.colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    PipelineDesc b = a;
+    b.vertexShader = reinterpret_cast<VkShaderModule>(uintptr_t(0x10));
+    b.layout = reinterpret_cast<VkPipelineLayout>(uintptr_t(0x20));
+
+    EXPECT_NE(a.hash(), b.hash());
+    EXPECT_EQ(a.stateHash(), b.stateHash());
+
+    PipelineDesc srgb = a;
+    srgb.colorFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    EXPECT_NE(a.stateHash(), srgb.stateHash());
+}
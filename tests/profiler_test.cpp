@@ -0,0 +1,104 @@
+#include "rvivl/profiler.hpp"
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using rvivl::CpuScope;
+using rvivl::ProfileEvent;
+using rvivl::Profiler;
+using rvivl::ProfilerCreateInfo;
+using rvivl::ProfileTrack;
+
+TEST(ProfilerTest, RecordsCpuScopes) {
+    Profiler profiler(ProfilerCreateInfo{});
+    {
+        CpuScope outer(profiler, "outer");
+        CpuScope inner(profiler, "inner");
+    }
+
+    std::vector<ProfileEvent> events = profiler.events();
+    ASSERT_EQ(events.size(), 2u);
+    // Scopes end innermost first
+    EXPECT_STREQ(events[0].name, "inner");
+    EXPECT_STREQ(events[1].name, "outer");
+    EXPECT_EQ(events[0].track, ProfileTrack::Cpu);
+    EXPECT_LE(events[1].begin, events[0].begin);
+    EXPECT_GE(events[1].end, events[0].end);
+    EXPECT_FALSE(profiler.gpuTimestamps());
+}
+
+TEST(ProfilerTest, NumbersThreads) {
+    Profiler profiler(ProfilerCreateInfo{});
+    { CpuScope scope(profiler, "main"); }
+    std::thread([&] { CpuScope scope(profiler, "worker"); }).join();
+
+    std::vector<ProfileEvent> events = profiler.events();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_NE(events[0].thread, events[1].thread);
+}
+
+TEST(ProfilerTest, RingKeepsNewestEvents) {
+    ProfilerCreateInfo info{};
+    info.maxEvents = 3;
+    Profiler profiler(info);
+
+    for (uint64_t i = 1; i <= 5; i++) {
+        ProfileEvent event;
+        event.name = "event";
+        event.begin = i;
+        event.end = i + 1;
+        profiler.addEvent(event);
+    }
+
+    std::vector<ProfileEvent> events = profiler.events();
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[0].begin, 3u);
+    EXPECT_EQ(events[2].begin, 5u);
+
+    profiler.clear();
+    EXPECT_TRUE(profiler.events().empty());
+}
+
+TEST(ProfilerTest, DisabledIgnoresScopes) {
+    ProfilerCreateInfo info{};
+    info.enabled = false;
+    Profiler profiler(info);
+    { CpuScope scope(profiler, "ignored"); }
+
+    EXPECT_TRUE(profiler.events().empty());
+    EXPECT_EQ(profiler.beginGpuScope(VK_NULL_HANDLE, "ignored"),
+              Profiler::NO_SCOPE);
+}
+
+TEST(ProfilerTest, WritesChromeTrace) {
+    Profiler profiler(ProfilerCreateInfo{});
+
+    ProfileEvent cpu;
+    cpu.name = "say \"hi\"";
+    cpu.begin = 1500;
+    cpu.end = 4000;
+    profiler.addEvent(cpu);
+
+    ProfileEvent gpu;
+    gpu.name = "frame";
+    gpu.track = ProfileTrack::Gpu;
+    gpu.frame = 7;
+    gpu.begin = 2000000;
+    gpu.end = 2000250;
+    profiler.addEvent(gpu);
+
+    std::ostringstream out;
+    profiler.writeChromeTrace(out);
+    std::string trace = out.str();
+
+    EXPECT_NE(trace.find("\"traceEvents\":["), std::string::npos);
+    EXPECT_NE(trace.find("{\"name\":\"say \\\"hi\\\"\",\"ph\":\"X\",\"pid\":1,"
+                         "\"tid\":0,\"ts\":1.500,\"dur\":2.500}"),
+              std::string::npos);
+    EXPECT_NE(trace.find("{\"name\":\"frame\",\"ph\":\"X\",\"pid\":2,"
+                         "\"tid\":0,\"ts\":2000.000,\"dur\":0.250,"
+                         "\"args\":{\"frame\":7}}"),
+              std::string::npos);
+}
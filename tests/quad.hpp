@@ -0,0 +1,35 @@
+#pragma once
+
+#include "rvivl/vertex.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using rvivl::Vertex;
+
+// Quad vertices (two triangles forming a red quad)
+inline const std::vector<Vertex> vertices = {
+    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}}, // Bottom-left
+    {{0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},  // Bottom-right
+    {{0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}},   // Top-right
+    {{-0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}}   // Top-left
+};
+
+inline const std::vector<uint16_t> quadIndices = {0, 1, 2, 2, 3, 0};
+
+// Finds a file the build puts next to the tests, e.g. assets.pak, from the
+// build directory, the project root or the tests directory
+inline std::string findTestFile(const std::string &filename) {
+    const std::vector<std::string> searchPaths = {".", "build/tests", "tests",
+                                                  "../tests"};
+    for (const auto &path : searchPaths) {
+        std::string candidate = path + "/" + filename;
+        if (std::filesystem::exists(candidate)) {
+            return candidate;
+        }
+    }
+    throw std::runtime_error("Failed to find file: " + filename);
+}
@@ -0,0 +1,105 @@
+#include "quad.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Times recordParallel() for a large draw list at increasing thread counts.
+// Usage: recording-benchmark [draws per frame] [frames]
+int main(int argc, char **argv) {
+    const uint32_t drawCount =
+        argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 20000;
+    const uint32_t frameCount =
+        argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 100;
+    const uint32_t warmupFrames = 10;
+
+    std::vector<uint32_t> threadCounts;
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    try {
+        std::cout << "threads,draws,record_ms" << std::endl;
+
+        for (uint32_t threads : threadCounts) {
+            rvivl::RendererCreateInfo rendererInfo{};
+            rendererInfo.applicationName = "Recording Benchmark";
+            rendererInfo.headless = true;
+            rendererInfo.extent = {256, 256};
+            rendererInfo.vertexShaderCode =
+                rvivl::embeddedShader("vertex.vert");
+            rendererInfo.fragmentShaderCode =
+                rvivl::embeddedShader("fragment.frag");
+            rendererInfo.recordingThreads = threads;
+
+            rvivl::Renderer renderer(rendererInfo);
+
+            VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+            rvivl::Buffer vertexBuffer = renderer.uploadQueue().createBuffer(
+                vertices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+            VkDeviceSize indexBufferSize =
+                sizeof(quadIndices[0]) * quadIndices.size();
+            rvivl::Buffer indexBuffer = renderer.uploadQueue().createBuffer(
+                quadIndices.data(), indexBufferSize,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+            auto record = [&](VkCommandBuffer commandBuffer, uint32_t,
+                              uint32_t count) {
+                vkCmdBindPipeline(commandBuffer,
+                                  VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                  renderer.pipeline());
+
+                VkDeviceSize offsets[] = {0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1,
+                                       &vertexBuffer.buffer, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0,
+                                     VK_INDEX_TYPE_UINT16);
+                for (uint32_t i = 0; i < count; i++) {
+                    vkCmdDrawIndexed(commandBuffer,
+                                     static_cast<uint32_t>(quadIndices.size()),
+                                     1, 0, 0, 0);
+                }
+            };
+
+            std::chrono::duration<double, std::milli> recordTime{0};
+            for (uint32_t frame = 0; frame < warmupFrames + frameCount;
+                 frame++) {
+                if (!renderer.beginFrame(
+                        VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)) {
+                    throw std::runtime_error("Failed to begin frame!");
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                renderer.recordParallel(drawCount, record);
+                if (frame >= warmupFrames) {
+                    recordTime += std::chrono::steady_clock::now() - start;
+                }
+
+                renderer.submit();
+                renderer.endFrame();
+            }
+
+            renderer.waitIdle();
+            renderer.destroyBuffer(indexBuffer);
+            renderer.destroyBuffer(vertexBuffer);
+
+            std::cout << renderer.jobs().threadCount() << "," << drawCount
+                      << "," << recordTime.count() / frameCount << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
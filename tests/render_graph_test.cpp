@@ -0,0 +1,206 @@
+#include "rvivl/render_graph.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::AliasPlan;
+using rvivl::CompiledRenderGraph;
+using rvivl::ImageAccess;
+using rvivl::ImageUsage;
+using rvivl::RenderGraph;
+using rvivl::RenderGraphImage;
+using rvivl::TransientImageLifetime;
+
+namespace {
+
+    // Passes are never recorded, since without a renderer the graph can
+    // only be compiled
+    void addPass(RenderGraph &graph, std::vector<ImageAccess> accesses,
+                 bool sideEffects = false) {
+        graph.addPass("pass", accesses, nullptr, sideEffects);
+    }
+
+    VkImage fakeImage(uintptr_t value) {
+        return reinterpret_cast<VkImage>(value);
+    }
+
+    TransientImageLifetime lifetime(uint32_t first, uint32_t last,
+                                    VkDeviceSize size,
+                                    uint32_t memoryTypeBits = 1) {
+        TransientImageLifetime image;
+        image.first = first;
+        image.last = last;
+        image.requirements.size = size;
+        image.requirements.alignment = 256;
+        image.requirements.memoryTypeBits = memoryTypeBits;
+        return image;
+    }
+
+} // namespace
+
+TEST(RenderGraphTest, CullsPassesNothingReads) {
+    RenderGraph graph({});
+    RenderGraphImage a = graph.createImage("a", {8, 8}, VK_FORMAT_R8_UNORM);
+    RenderGraphImage b = graph.createImage("b", {8, 8}, VK_FORMAT_R8_UNORM);
+    RenderGraphImage out = graph.importImage(
+        "out", fakeImage(1), VK_NULL_HANDLE, {8, 8}, ImageUsage::None,
+        ImageUsage::SampledFragment);
+
+    addPass(graph, {{a, ImageUsage::StorageWrite}});
+    // Writes b, which nothing reads
+    addPass(graph, {{a, ImageUsage::SampledCompute},
+                    {b, ImageUsage::StorageWrite}});
+    addPass(graph, {{a, ImageUsage::SampledCompute},
+                    {out, ImageUsage::StorageWrite}});
+    // Reads a only for the host
+    addPass(graph, {{a, ImageUsage::TransferSrc}}, true);
+
+    CompiledRenderGraph compiled = graph.compile();
+    ASSERT_EQ(compiled.passes.size(), 3u);
+    EXPECT_EQ(compiled.passes[0].pass, 0u);
+    EXPECT_EQ(compiled.passes[1].pass, 2u);
+    EXPECT_EQ(compiled.passes[2].pass, 3u);
+    EXPECT_EQ(compiled.lifetimes[b].first, CompiledRenderGraph::UNUSED);
+    EXPECT_EQ(compiled.lifetimes[a].first, 0u);
+    EXPECT_EQ(compiled.lifetimes[a].last, 2u);
+}
+
+TEST(RenderGraphTest, OverwrittenImagesCullEarlierWriters) {
+    RenderGraph graph({});
+    RenderGraphImage a = graph.createImage("a", {8, 8}, VK_FORMAT_R8_UNORM);
+
+    addPass(graph, {{a, ImageUsage::StorageWrite}});
+    addPass(graph, {{a, ImageUsage::StorageWrite}});
+    addPass(graph, {{a, ImageUsage::TransferSrc}}, true);
+    EXPECT_EQ(graph.compile().passes.size(), 2u);
+
+    // Reading and writing keeps what came before
+    RenderGraph kept({});
+    RenderGraphImage b = kept.createImage("b", {8, 8}, VK_FORMAT_R8_UNORM);
+    addPass(kept, {{b, ImageUsage::StorageWrite}});
+    addPass(kept,
+            {{b, ImageUsage::StorageRead}, {b, ImageUsage::StorageWrite}});
+    addPass(kept, {{b, ImageUsage::TransferSrc}}, true);
+    EXPECT_EQ(kept.compile().passes.size(), 3u);
+}
+
+TEST(RenderGraphTest, PlacesBarriersOnlyForHazards) {
+    RenderGraph graph({});
+    RenderGraphImage a = graph.createImage("a", {8, 8}, VK_FORMAT_R8_UNORM);
+
+    addPass(graph, {{a, ImageUsage::StorageWrite}});
+    addPass(graph, {{a, ImageUsage::SampledCompute}}, true);
+    // Same layout and stage as the read before, already synchronized
+    addPass(graph, {{a, ImageUsage::SampledCompute}}, true);
+    addPass(graph, {{a, ImageUsage::SampledFragment}}, true);
+
+    CompiledRenderGraph compiled = graph.compile();
+    ASSERT_EQ(compiled.passes.size(), 4u);
+    ASSERT_EQ(compiled.barriers.size(), 3u);
+
+    // UNDEFINED to GENERAL with nothing to wait for
+    ASSERT_EQ(compiled.passes[0].barrierCount, 1u);
+    const rvivl::RenderGraphBarrier &first = compiled.barriers[0];
+    EXPECT_EQ(first.oldLayout, VK_IMAGE_LAYOUT_UNDEFINED);
+    EXPECT_EQ(first.newLayout, VK_IMAGE_LAYOUT_GENERAL);
+    EXPECT_EQ(first.srcStages, VK_PIPELINE_STAGE_2_NONE);
+    EXPECT_EQ(compiled.lifetimes[a].firstBarrier, 0u);
+
+    // Read after write with a layout change
+    ASSERT_EQ(compiled.passes[1].barrierCount, 1u);
+    const rvivl::RenderGraphBarrier &raw = compiled.barriers[1];
+    EXPECT_EQ(raw.srcStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    EXPECT_EQ(raw.srcAccess, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    EXPECT_EQ(raw.newLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    EXPECT_EQ(compiled.passes[2].barrierCount, 0u);
+
+    // A new reading stage still waits for the write
+    ASSERT_EQ(compiled.passes[3].barrierCount, 1u);
+    const rvivl::RenderGraphBarrier &fragment = compiled.barriers[2];
+    EXPECT_EQ(fragment.oldLayout, fragment.newLayout);
+    EXPECT_EQ(fragment.srcStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    EXPECT_EQ(fragment.dstStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                                      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+}
+
+TEST(RenderGraphTest, WritesWaitForReads) {
+    RenderGraph graph({});
+    RenderGraphImage out = graph.importImage(
+        "out", fakeImage(1), VK_NULL_HANDLE, {8, 8},
+        ImageUsage::SampledFragment, ImageUsage::SampledFragment);
+
+    addPass(graph, {{out, ImageUsage::StorageWrite}});
+
+    CompiledRenderGraph compiled = graph.compile();
+    ASSERT_EQ(compiled.barriers.size(), 2u);
+    // Last frame's fragment reads, then the transition back for this
+    // frame's
+    EXPECT_EQ(compiled.barriers[0].srcStages,
+              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+    EXPECT_EQ(compiled.barriers[0].oldLayout,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    EXPECT_EQ(compiled.finalBarrierCount, 1u);
+    EXPECT_EQ(compiled.barriers[1].newLayout,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    EXPECT_EQ(compiled.barriers[1].srcAccess,
+              VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+}
+
+TEST(RenderGraphTest, RejectsConflictingLayouts) {
+    RenderGraph graph({});
+    RenderGraphImage a = graph.createImage("a", {8, 8}, VK_FORMAT_R8_UNORM);
+    addPass(graph, {{a, ImageUsage::SampledCompute},
+                    {a, ImageUsage::StorageWrite}},
+            true);
+    EXPECT_THROW(graph.compile(), std::runtime_error);
+    EXPECT_THROW(addPass(graph, {{7, ImageUsage::StorageRead}}),
+                 std::runtime_error);
+}
+
+TEST(PlanAliasingTest, SharesMemoryBetweenDisjointLifetimes) {
+    TransientImageLifetime images[] = {
+        lifetime(0, 1, 4096),
+        lifetime(1, 2, 1024),
+        lifetime(2, 3, 2048),
+    };
+    AliasPlan plan = rvivl::planAliasing(images);
+
+    ASSERT_EQ(plan.slots.size(), 2u);
+    EXPECT_EQ(plan.slot[0], plan.slot[2]);
+    EXPECT_NE(plan.slot[0], plan.slot[1]);
+    EXPECT_EQ(plan.slots[plan.slot[0]].size, 4096u);
+    EXPECT_EQ(plan.previous[0], AliasPlan::NO_IMAGE);
+    EXPECT_EQ(plan.previous[1], AliasPlan::NO_IMAGE);
+    EXPECT_EQ(plan.previous[2], 0u);
+}
+
+TEST(PlanAliasingTest, KeepsIncompatibleMemoryTypesApart) {
+    TransientImageLifetime images[] = {
+        lifetime(0, 0, 4096, 0b01),
+        lifetime(1, 1, 4096, 0b10),
+        lifetime(2, 2, 4096, 0b11),
+    };
+    AliasPlan plan = rvivl::planAliasing(images);
+
+    ASSERT_EQ(plan.slots.size(), 2u);
+    EXPECT_EQ(plan.slot[2], plan.slot[0]);
+    EXPECT_EQ(plan.slots[plan.slot[0]].memoryTypeBits, 0b01u);
+}
+
+TEST(ImageUsageInfoTest, MapsToLegacyFlags) {
+    rvivl::ImageUsageInfo sampled =
+        rvivl::imageUsageInfo(ImageUsage::SampledFragment);
+    EXPECT_FALSE(sampled.write);
+    EXPECT_EQ(rvivl::legacyStages(sampled.stages),
+              static_cast<VkPipelineStageFlags>(
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+    EXPECT_EQ(rvivl::legacyAccess(sampled.access),
+              static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT));
+
+    rvivl::ImageUsageInfo storage =
+        rvivl::imageUsageInfo(ImageUsage::StorageWrite);
+    EXPECT_TRUE(storage.write);
+    EXPECT_EQ(storage.layout, VK_IMAGE_LAYOUT_GENERAL);
+    EXPECT_EQ(rvivl::legacyAccess(storage.access),
+              static_cast<VkAccessFlags>(VK_ACCESS_SHADER_WRITE_BIT));
+}
@@ -0,0 +1,32 @@
+#include "rvivl/shader_registry.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+TEST(ShaderRegistryTest, EmbedsEveryShader) {
+    for (const char *name :
+         {"downscale.comp", "fragment.frag", "image.frag",
+          "image_bindless.frag", "image.vert", "instanced.vert",
+          "tonemap.comp", "transform.vert", "vertex.vert",
+          "yuv_to_rgb.comp"}) {
+        std::optional<std::span<const uint32_t>> code =
+            rvivl::findEmbeddedShader(name);
+        ASSERT_TRUE(code) << name;
+        ASSERT_FALSE(code->empty());
+        EXPECT_EQ((*code)[0], 0x07230203u) << name;
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(code->data()) % 16, 0u);
+    }
+}
+
+TEST(ShaderRegistryTest, ShadersAreSortedByName) {
+    std::span<const rvivl::EmbeddedShader> shaders = rvivl::embeddedShaders();
+    for (size_t i = 1; i < shaders.size(); i++) {
+        EXPECT_LT(shaders[i - 1].name, shaders[i].name);
+    }
+}
+
+TEST(ShaderRegistryTest, MissingShaderThrows) {
+    EXPECT_FALSE(rvivl::findEmbeddedShader("missing.vert"));
+    EXPECT_FALSE(rvivl::findEmbeddedShader("vertex"));
+    EXPECT_THROW(rvivl::embeddedShader("missing.vert"), std::runtime_error);
+}
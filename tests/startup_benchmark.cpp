@@ -0,0 +1,96 @@
+#include "quad.hpp"
+#include "rvivl/asset.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Times loading the shaders from the packed archive and from the library,
+// then renderer creation without a pipeline cache, with an empty one and
+// with one saved by a previous run.
+// Usage: startup-benchmark [runs per mode]
+int main(int argc, char **argv) {
+    const uint32_t runs =
+        argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 5;
+    const std::filesystem::path cachePath =
+        std::filesystem::temp_directory_path() / "rvivl-startup-benchmark.bin";
+
+    try {
+        auto timeLoad = [&](auto &&load) {
+            std::chrono::duration<double, std::micro> total{0};
+            for (uint32_t i = 0; i < runs; i++) {
+                auto start = std::chrono::steady_clock::now();
+                load();
+                total += std::chrono::steady_clock::now() - start;
+            }
+            return total.count() / runs;
+        };
+
+        // A fresh archive each run, so the mapping is part of the time
+        const std::string archivePath = findTestFile("assets.pak");
+        double archiveTime = timeLoad([&] {
+            rvivl::AssetLibrary assets;
+            assets.addArchive(archivePath);
+            assets.load("vertex.vert.spv").words();
+            assets.load("fragment.frag.spv").words();
+        });
+        double embeddedTime = timeLoad([] {
+            rvivl::embeddedShader("vertex.vert");
+            rvivl::embeddedShader("fragment.frag");
+        });
+
+        std::cout << "shaders,load_us" << std::endl;
+        std::cout << "archive," << archiveTime << std::endl;
+        std::cout << "embedded," << embeddedTime << std::endl;
+
+        rvivl::RendererCreateInfo rendererInfo{};
+        rendererInfo.applicationName = "Startup Benchmark";
+        rendererInfo.headless = true;
+        rendererInfo.vertexShaderCode = rvivl::embeddedShader("vertex.vert");
+        rendererInfo.fragmentShaderCode =
+            rvivl::embeddedShader("fragment.frag");
+
+        auto measure = [&](const std::string &path, bool removeFirst) {
+            std::chrono::duration<double, std::milli> total{0};
+            bool loaded = false;
+            for (uint32_t i = 0; i < runs; i++) {
+                if (removeFirst) {
+                    std::filesystem::remove(cachePath);
+                }
+                rendererInfo.pipelineCachePath = path;
+
+                auto start = std::chrono::steady_clock::now();
+                rvivl::Renderer renderer(rendererInfo);
+                total += std::chrono::steady_clock::now() - start;
+                loaded = renderer.pipelineCache().loaded();
+            }
+            return std::make_pair(total.count() / runs, loaded);
+        };
+
+        std::cout << "mode,startup_ms,cache_loaded" << std::endl;
+
+        auto [noneTime, noneLoaded] = measure("", false);
+        std::cout << "none," << noneTime << "," << noneLoaded << std::endl;
+
+        auto [coldTime, coldLoaded] = measure(cachePath.string(), true);
+        std::cout << "cold," << coldTime << "," << coldLoaded << std::endl;
+
+        // The last cold run left its cache behind
+        auto [warmTime, warmLoaded] = measure(cachePath.string(), false);
+        std::cout << "warm," << warmTime << "," << warmLoaded << std::endl;
+
+        std::filesystem::remove(cachePath);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "rvivl/tiled_image.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using rvivl::TileCache;
+using rvivl::TileKey;
+using rvivl::TilePyramid;
+using rvivl::TileView;
+
+TEST(TilePyramidTest, LevelsEndInOneTile) {
+    TilePyramid pyramid(1000, 300, 256);
+    EXPECT_EQ(pyramid.levelCount(), 3u);
+    EXPECT_EQ(pyramid.tilesX(0), 4u);
+    EXPECT_EQ(pyramid.tilesY(0), 2u);
+    EXPECT_EQ(pyramid.tilesX(pyramid.topLevel()), 1u);
+    EXPECT_EQ(pyramid.tilesY(pyramid.topLevel()), 1u);
+
+    // Edge tiles are cut off by the image
+    VkExtent2D edge = pyramid.tileExtent(TileKey{0, 3, 1});
+    EXPECT_EQ(edge.width, 1000u - 768u);
+    EXPECT_EQ(edge.height, 300u - 256u);
+    VkExtent2D top = pyramid.tileExtent(TileKey{2, 0, 0});
+    EXPECT_EQ(top.width, 250u);
+    EXPECT_EQ(top.height, 75u);
+}
+
+TEST(TilePyramidTest, PicksLevelAndVisibleTiles) {
+    TilePyramid pyramid(4096, 4096, 256);
+    EXPECT_EQ(pyramid.levelFor(2.0), 0u);
+    EXPECT_EQ(pyramid.levelFor(0.5), 1u);
+    EXPECT_EQ(pyramid.levelFor(0.3), 1u);
+    EXPECT_EQ(pyramid.levelFor(1e-9), pyramid.topLevel());
+
+    TileView view;
+    view.centerX = 512.0;
+    view.centerY = 256.0;
+    view.scale = 1.0;
+    view.viewport = {512, 256};
+
+    std::vector<TileKey> tiles;
+    pyramid.visibleTiles(view, 0, tiles);
+    std::vector<TileKey> expected = {{0, 1, 0}, {0, 2, 0}, {0, 1, 1},
+                                     {0, 2, 1}};
+    EXPECT_EQ(tiles, expected);
+
+    // Off the image
+    tiles.clear();
+    view.centerX = -1000.0;
+    pyramid.visibleTiles(view, 0, tiles);
+    EXPECT_TRUE(tiles.empty());
+}
+
+TEST(TileCacheTest, EvictsLeastRecentlyUsed) {
+    TileCache cache(2);
+    uint32_t a = 0, b = 0, c = 0;
+    ASSERT_TRUE(cache.insert(TileKey{0, 0, 0}, 1, 0, false, a));
+    ASSERT_TRUE(cache.insert(TileKey{0, 1, 0}, 1, 0, false, b));
+    EXPECT_NE(a, b);
+
+    // Both slots belong to frame 1, which has not completed
+    EXPECT_FALSE(cache.insert(TileKey{0, 2, 0}, 2, 0, false, c));
+
+    cache.touch(a, 2);
+    ASSERT_TRUE(cache.insert(TileKey{0, 2, 0}, 3, 2, false, c));
+    EXPECT_EQ(c, b);
+    EXPECT_FALSE(cache.find(TileKey{0, 1, 0}));
+    EXPECT_EQ(cache.find(TileKey{0, 0, 0}), a);
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST(TileCacheTest, KeepsPinnedTiles) {
+    TileCache cache(2);
+    uint32_t pinned = 0, slot = 0;
+    ASSERT_TRUE(cache.insert(TileKey{3, 0, 0}, 1, 0, true, pinned));
+    for (uint32_t x = 0; x < 4; x++) {
+        ASSERT_TRUE(cache.insert(TileKey{0, x, 0}, 1, 1, false, slot));
+        EXPECT_NE(slot, pinned);
+    }
+    EXPECT_EQ(cache.find(TileKey{3, 0, 0}), pinned);
+
+    cache.erase(TileKey{0, 3, 0});
+    EXPECT_EQ(cache.size(), 1u);
+    ASSERT_TRUE(cache.insert(TileKey{0, 9, 0}, 2, 1, false, slot));
+}
+
+TEST(PnmTileSourceTest, ReadsDecimatedTiles) {
+    const char *path = "tiled_image_test.pgm";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "P5\n6 4\n255\n";
+        for (uint32_t y = 0; y < 4; y++) {
+            for (uint32_t x = 0; x < 6; x++) {
+                file.put(char(y * 10 + x));
+            }
+        }
+    }
+
+    rvivl::PnmTileSource source(path, 4);
+    ASSERT_EQ(source.pyramid().levelCount(), 2u);
+
+    rvivl::DecodedImage tile;
+    ASSERT_TRUE(source.readTile(TileKey{0, 1, 0}, tile));
+    EXPECT_EQ(tile.width, 2u);
+    EXPECT_EQ(tile.height, 4u);
+    EXPECT_EQ(tile.pixels[0], 4);
+    EXPECT_EQ(tile.pixels[3], 255);
+    EXPECT_EQ(tile.pixels[(3 * 2 + 1) * 4], 35);
+
+    // Every other pixel of every other row
+    ASSERT_TRUE(source.readTile(TileKey{1, 0, 0}, tile));
+    EXPECT_EQ(tile.width, 3u);
+    EXPECT_EQ(tile.height, 2u);
+    EXPECT_EQ(tile.pixels[2 * 4], 4);
+    EXPECT_EQ(tile.pixels[(1 * 3 + 1) * 4], 22);
+
+    std::remove(path);
+}
@@ -0,0 +1,82 @@
+#include "rvivl/upload_queue.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::StagingRing;
+
+TEST(StagingRingTest, RespectsAlignment) {
+    StagingRing ring(1024);
+
+    VkDeviceSize first = 0, second = 0;
+    ASSERT_TRUE(ring.allocate(10, 1, first));
+    ASSERT_TRUE(ring.allocate(10, 64, second));
+
+    EXPECT_EQ(first, 0u);
+    EXPECT_EQ(second, 64u);
+    EXPECT_EQ(ring.bytesInUse(), 74u);
+}
+
+TEST(StagingRingTest, FailsUntilBatchCompletes) {
+    StagingRing ring(256);
+
+    VkDeviceSize offset = 0;
+    ASSERT_TRUE(ring.allocate(100, 1, offset));
+    ASSERT_TRUE(ring.allocate(100, 1, offset));
+    EXPECT_FALSE(ring.allocate(100, 1, offset));
+
+    ring.close(1);
+    EXPECT_EQ(ring.oldestValue(), 1u);
+    EXPECT_FALSE(ring.allocate(100, 1, offset));
+
+    ring.release(1);
+    EXPECT_EQ(ring.bytesInUse(), 0u);
+    EXPECT_EQ(ring.oldestValue(), 0u);
+    ASSERT_TRUE(ring.allocate(100, 1, offset));
+    EXPECT_EQ(offset, 0u);
+}
+
+TEST(StagingRingTest, WrapsBehindTail) {
+    StagingRing ring(256);
+
+    VkDeviceSize a = 0, b = 0, c = 0;
+    ASSERT_TRUE(ring.allocate(100, 1, a));
+    ring.close(1);
+    ASSERT_TRUE(ring.allocate(100, 1, b));
+    ring.close(2);
+    ring.release(1);
+
+    // The 56 byte end of the ring is too short and is charged to c
+    ASSERT_TRUE(ring.allocate(100, 1, c));
+    EXPECT_EQ(c, 0u);
+    EXPECT_EQ(ring.bytesInUse(), 256u);
+
+    // The head has caught up with the tail
+    VkDeviceSize offset = 0;
+    EXPECT_FALSE(ring.allocate(1, 1, offset));
+
+    ring.release(2);
+    ASSERT_TRUE(ring.allocate(50, 1, offset));
+    EXPECT_EQ(offset, 100u);
+}
+
+TEST(StagingRingTest, ReleasesInSubmissionOrder) {
+    StagingRing ring(300);
+
+    VkDeviceSize offset = 0;
+    for (uint64_t value = 1; value <= 3; value++) {
+        ASSERT_TRUE(ring.allocate(100, 1, offset));
+        ring.close(value);
+    }
+
+    ring.release(2);
+    EXPECT_EQ(ring.bytesInUse(), 100u);
+    EXPECT_EQ(ring.oldestValue(), 3u);
+}
+
+TEST(StagingRingTest, RejectsOversizedRequests) {
+    StagingRing ring(128);
+
+    VkDeviceSize offset = 0;
+    EXPECT_FALSE(ring.allocate(129, 1, offset));
+    EXPECT_FALSE(ring.allocate(0, 1, offset));
+}
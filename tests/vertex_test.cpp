@@ -0,0 +1,69 @@
+#include "rvivl/vertex.hpp"
+
+#include <gtest/gtest.h>
+
+using rvivl::Instance;
+using rvivl::Vertex;
+
+TEST(InstanceTest, AdvancesPerInstanceOnItsOwnBinding) {
+    VkVertexInputBindingDescription binding = Instance::getBindingDescription();
+    EXPECT_EQ(binding.binding, Instance::BINDING);
+    EXPECT_NE(binding.binding, Vertex::getBindingDescription().binding);
+    EXPECT_EQ(binding.inputRate, VK_VERTEX_INPUT_RATE_INSTANCE);
+    EXPECT_EQ(binding.stride, sizeof(Instance));
+}
+
+TEST(InstanceTest, LocationsFollowVertex) {
+    auto vertexAttributes = Vertex::getAttributeDescriptions();
+    auto instanceAttributes = Instance::getAttributeDescriptions();
+
+    uint32_t next = vertexAttributes.back().location + 1;
+    for (const auto &attribute : instanceAttributes) {
+        EXPECT_EQ(attribute.binding, Instance::BINDING);
+        EXPECT_EQ(attribute.location, next++);
+        EXPECT_LT(attribute.offset, sizeof(Instance));
+    }
+}
+
+TEST(VertexLayoutTest, CompactLayoutsHalveTheSize) {
+    static_assert(sizeof(Vertex) == 20);
+    static_assert(sizeof(rvivl::HalfVertex) == 8);
+    static_assert(sizeof(rvivl::QuantizedVertex) == 8);
+
+    constexpr auto attributes = rvivl::HalfVertex::getAttributeDescriptions();
+    EXPECT_EQ(attributes[0].format, VK_FORMAT_R16G16_SFLOAT);
+    EXPECT_EQ(attributes[0].offset, 0u);
+    EXPECT_EQ(attributes[1].format, VK_FORMAT_R8G8B8A8_UNORM);
+    EXPECT_EQ(attributes[1].offset, 4u);
+
+    EXPECT_EQ(rvivl::QuantizedVertex::getAttributeDescriptions()[0].format,
+              VK_FORMAT_R16G16_SNORM);
+    EXPECT_EQ(rvivl::QuantizedVertex::getBindingDescription().stride, 8u);
+}
+
+TEST(VertexLayoutTest, EncodesHalfFloats) {
+    static_assert(rvivl::floatToHalf(1.0f) == 0x3c00);
+    EXPECT_EQ(rvivl::floatToHalf(0.0f), 0x0000);
+    EXPECT_EQ(rvivl::floatToHalf(-2.0f), 0xc000);
+    EXPECT_EQ(rvivl::floatToHalf(0.5f), 0x3800);
+    EXPECT_EQ(rvivl::floatToHalf(65504.0f), 0x7bff);
+    EXPECT_EQ(rvivl::floatToHalf(1.0e6f), 0x7c00);
+    // Smallest subnormal, and halfway between 1 and the next half, which
+    // rounds to the even 1
+    EXPECT_EQ(rvivl::floatToHalf(5.9604645e-8f), 0x0001);
+    EXPECT_EQ(rvivl::floatToHalf(1.0f + 1.0f / 2048.0f), 0x3c00);
+    EXPECT_EQ(rvivl::floatToHalf(1.0f + 3.0f / 2048.0f), 0x3c02);
+}
+
+TEST(VertexLayoutTest, QuantizesToNormalizedIntegers) {
+    EXPECT_EQ(rvivl::Snorm2::quantize(1.0f), 32767);
+    EXPECT_EQ(rvivl::Snorm2::quantize(-1.0f), -32767);
+    EXPECT_EQ(rvivl::Snorm2::quantize(2.0f), 32767);
+    EXPECT_EQ(rvivl::Snorm2::quantize(0.0f), 0);
+
+    rvivl::Unorm4 red = rvivl::Unorm4::encode(1.0f, 0.0f, 0.0f);
+    EXPECT_EQ(red.r, 255);
+    EXPECT_EQ(red.g, 0);
+    EXPECT_EQ(red.a, 255);
+    EXPECT_EQ(rvivl::Unorm4::quantize(0.5f), 128);
+}
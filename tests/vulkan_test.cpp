@@ -1,303 +1,54 @@
-// Helper function to create#define VK_USE_PLATFORM_XLIB_KHR
+#include "quad.hpp"
+#include "rvivl/renderer.hpp"
+#include "rvivl/shader_registry.hpp"
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 #include <algorithm>
+#include <chrono>
 #include <cstring>
-#include <fstream>
 #include <iostream>
-#include <limits>
-#include <set>
-#include <stdexcept>
 #include <vector>
 #include <vulkan/vulkan.h>
 
-// Vertex structure
-struct Vertex {
-    float pos[2];
-    float color[3];
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return bindingDescription;
-    }
-
-    static std::vector<VkVertexInputAttributeDescription>
-    getAttributeDescriptions() {
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        return attributeDescriptions;
-    }
-};
-
-// Quad vertices (two triangles forming a red quad)
-const std::vector<Vertex> vertices = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}}, // Bottom-left
-    {{0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},  // Bottom-right
-    {{0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}},   // Top-right
-    {{-0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}}   // Top-left
-};
-
-const std::vector<uint16_t> quadIndices = {0, 1, 2, 2, 3, 0};
-
-// Compiled SPIR-V bytecode for vertex shader
-const std::vector<uint32_t> vertexShaderCode = {
-    0x07230203, 0x00010000, 0x00080007, 0x0000002c, 0x00000000, 0x00020011,
-    0x00000001, 0x0006000b, 0x00000001, 0x4c534c47, 0x6474732e, 0x3035342e,
-    0x00000000, 0x0003000e, 0x00000000, 0x00000001, 0x0008000f, 0x00000000,
-    0x00000004, 0x6e69616d, 0x00000000, 0x0000000b, 0x0000000f, 0x00000015,
-    0x00030003, 0x00000002, 0x000001c2, 0x00040005, 0x00000004, 0x6e69616d,
-    0x00000000, 0x00030005, 0x00000009, 0x00000000, 0x00050006, 0x00000009,
-    0x00000000, 0x6f6c6f43, 0x00000072, 0x00040006, 0x00000009, 0x00000001,
-    0x00005655, 0x00030005, 0x0000000b, 0x0074754f, 0x00040005, 0x0000000f,
-    0x6f6c6f43, 0x00000072, 0x00040};
-
-// Helper function to find memory type
-uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter,
-                        VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) ==
-                properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("Failed to find suitable memory type!");
-}
-
-// Helper function to create buffer
-void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
-                  VkDeviceSize size, VkBufferUsageFlags usage,
-                  VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                  VkDeviceMemory &bufferMemory) {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create buffer!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory!");
-    }
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
-// Note: This is a simplified example. In a real application, you would use
-// glslang or shaderc to compile GLSL to SPIR-V at runtime or build time.
-// For now, you'll need to compile the shaders separately using
-// glslangValidator:
-//
-// glslangValidator -V shader.vert -o vert.spv
-// glslangValidator -V shader.frag -o frag.spv
-//
-// Then load the compiled SPIR-V files
-
-// Helper function to read SPIR-V file with multiple search paths
-std::vector<char> readFile(const std::string &filename) {
-    // Try multiple possible locations for the shader files
-    std::vector<std::string> searchPaths = {
-        filename,                  // Direct path
-        "build/tests/" + filename, // From project root
-        "tests/" + filename,       // From build directory
-        "../tests/" + filename,    // From tests subdirectory
-        "./" + filename            // Current directory
-    };
-
-    for (const auto &path : searchPaths) {
-        std::ifstream file(path, std::ios::ate | std::ios::binary);
-        if (file.is_open()) {
-            size_t fileSize = (size_t)file.tellg();
-            std::vector<char> buffer(fileSize);
-
-            file.seekg(0);
-            file.read(buffer.data(), fileSize);
-            file.close();
-
-            std::cout << "Found shader at: " << path << std::endl;
-            return buffer;
-        }
-    }
-
-    throw std::runtime_error("Failed to open file: " + filename +
-                             " (tried multiple locations)");
-}
-
-// Helper function to create shader module from SPIR-V file
-VkShaderModule createShaderModule(VkDevice device,
-                                  const std::vector<char> &code) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to create shader module!");
-    }
-
-    return shaderModule;
-}
-
-struct QueueFamilyIndices {
-    uint32_t graphicsFamily = UINT32_MAX;
-    uint32_t presentFamily = UINT32_MAX;
-
-    bool isComplete() {
-        return graphicsFamily != UINT32_MAX && presentFamily != UINT32_MAX;
-    }
-};
-
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device,
-                                     VkSurfaceKHR surface) {
-    QueueFamilyIndices indices;
-
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
-                                             nullptr);
-
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
-                                             queueFamilies.data());
-
-    int i = 0;
-    for (const auto &queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
-
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
-                                             &presentSupport);
-
-        if (presentSupport) {
-            indices.presentFamily = i;
-        }
-
-        if (indices.isComplete()) {
-            break;
-        }
-
-        i++;
-    }
-
-    return indices;
-}
-
-struct SwapChainSupportDetails {
-    VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
-};
-
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device,
-                                              VkSurfaceKHR surface) {
-    SwapChainSupportDetails details;
-
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface,
-                                              &details.capabilities);
-
-    uint32_t formatCount;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount,
-                                         nullptr);
-
-    if (formatCount != 0) {
-        details.formats.resize(formatCount);
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount,
-                                             details.formats.data());
-    }
-
-    uint32_t presentModeCount;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface,
-                                              &presentModeCount, nullptr);
-
-    if (presentModeCount != 0) {
-        details.presentModes.resize(presentModeCount);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(
-            device, surface, &presentModeCount, details.presentModes.data());
-    }
-
-    return details;
-}
-
-VkSurfaceFormatKHR chooseSwapSurfaceFormat(
-    const std::vector<VkSurfaceFormatKHR> &availableFormats) {
-    for (const auto &availableFormat : availableFormats) {
-        if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB &&
-            availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            return availableFormat;
-        }
-    }
-
-    return availableFormats[0];
-}
-
-VkPresentModeKHR chooseSwapPresentMode(
-    const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-    }
-
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
-
-VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities,
-                            SDL_Window *window) {
-    if (capabilities.currentExtent.width !=
-        std::numeric_limits<uint32_t>::max()) {
-        return capabilities.currentExtent;
-    } else {
-        int width, height;
-        SDL_GetWindowSize(window, &width, &height);
-
-        VkExtent2D actualExtent = {static_cast<uint32_t>(width),
-                                   static_cast<uint32_t>(height)};
-
-        actualExtent.width =
-            std::clamp(actualExtent.width, capabilities.minImageExtent.width,
-                       capabilities.maxImageExtent.width);
-        actualExtent.height =
-            std::clamp(actualExtent.height, capabilities.minImageExtent.height,
-                       capabilities.maxImageExtent.height);
-
-        return actualExtent;
+namespace {
+
+    // Longest the loop sleeps while nothing needs drawing, which bounds
+    // how late a change that comes without an event is picked up
+    constexpr int IDLE_TIMEOUT_MS = 250;
+
+    // Pixels the quad covers on an image of extent
+    VkRect2D quadBounds(VkExtent2D extent) {
+        float left = 1.0f, top = 1.0f, right = -1.0f, bottom = -1.0f;
+        for (const Vertex &vertex : vertices) {
+            left = std::min(left, vertex.pos.x);
+            right = std::max(right, vertex.pos.x);
+            top = std::min(top, vertex.pos.y);
+            bottom = std::max(bottom, vertex.pos.y);
+        }
+        auto toPixel = [](float ndc, uint32_t size) {
+            return static_cast<int32_t>((ndc + 1.0f) * 0.5f * size);
+        };
+        int32_t x0 = toPixel(left, extent.width);
+        int32_t y0 = toPixel(top, extent.height);
+        int32_t x1 = toPixel(right, extent.width) + 1;
+        int32_t y1 = toPixel(bottom, extent.height) + 1;
+        return {{x0, y0},
+                {static_cast<uint32_t>(x1 - x0),
+                 static_cast<uint32_t>(y1 - y0)}};
+    }
+
+} // namespace
+
+// Draws the red quad in a window. Frames are only drawn after something
+// changed, waiting for events in between; --continuous draws them as fast
+// as presentation allows instead.
+int main(int argc, char **argv) {
+    bool continuous = false;
+    for (int i = 1; i < argc; i++) {
+        continuous |= std::strcmp(argv[i], "--continuous") == 0;
     }
-}
 
-int main(int argc, char **argv) {
     std::cout << "Starting Vulkan application..." << std::endl;
 
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
@@ -309,7 +60,7 @@ int main(int argc, char **argv) {
     // Create an SDL window with Vulkan flag
     SDL_Window *window = SDL_CreateWindow(
         "Vulkan Red Quad", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800,
-        600, SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN);
+        600, SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
     if (!window) {
         std::cerr << "SDL_CreateWindow failed: " << SDL_GetError() << "\n";
         SDL_Quit();
@@ -317,16 +68,6 @@ int main(int argc, char **argv) {
     }
     std::cout << "SDL window created successfully." << std::endl;
 
-    // Create Vulkan instance
-    VkInstance instance;
-    VkApplicationInfo appInfo{};
-    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = "Vulkan Red Quad";
-    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.pEngineName = "No Engine";
-    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
-
     // Query required Vulkan extensions from SDL
     unsigned int sdlExtensionCount = 0;
     if (!SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount,
@@ -337,728 +78,144 @@ int main(int argc, char **argv) {
         SDL_Quit();
         return -1;
     }
-    std::cout << "SDL requires " << sdlExtensionCount << " Vulkan extensions."
-              << std::endl;
-
-    if (sdlExtensionCount == 0) {
-        std::cerr << "No Vulkan extensions required by SDL - this seems wrong!"
-                  << std::endl;
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return -1;
-    }
 
-    const char **sdlExtensions = new const char *[sdlExtensionCount];
-    if (!SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount,
-                                          sdlExtensions)) {
+    rvivl::RendererCreateInfo rendererInfo{};
+    rendererInfo.applicationName = "Vulkan Red Quad";
+    rendererInfo.instanceExtensions.resize(sdlExtensionCount);
+    if (!SDL_Vulkan_GetInstanceExtensions(
+            window, &sdlExtensionCount,
+            rendererInfo.instanceExtensions.data())) {
         std::cerr << "SDL_Vulkan_GetInstanceExtensions failed (2): "
                   << SDL_GetError() << "\n";
-        delete[] sdlExtensions;
         SDL_DestroyWindow(window);
         SDL_Quit();
         return -1;
     }
 
-    std::cout << "Required extensions: ";
-    for (unsigned int i = 0; i < sdlExtensionCount; i++) {
-        std::cout << sdlExtensions[i] << " ";
-    }
-    std::cout << std::endl;
-
-    VkInstanceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    createInfo.pApplicationInfo = &appInfo;
-    createInfo.enabledExtensionCount = sdlExtensionCount;
-    createInfo.ppEnabledExtensionNames = sdlExtensions;
-    createInfo.enabledLayerCount = 0;         // Explicitly set layer count
-    createInfo.ppEnabledLayerNames = nullptr; // Explicitly set layer names
-
-    std::cout << "Creating Vulkan instance..." << std::endl;
-    VkResult result = vkCreateInstance(&createInfo, nullptr, &instance);
-    delete[] sdlExtensions;
-    if (result != VK_SUCCESS) {
-        std::cerr << "Failed to create Vulkan instance!" << std::endl;
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return -1;
-    }
-
-    // Create Vulkan surface from SDL window
-    VkSurfaceKHR surface;
-    if (!SDL_Vulkan_CreateSurface(window, instance, &surface)) {
-        std::cerr << "Failed to create Vulkan surface: " << SDL_GetError()
-                  << "\n";
-        vkDestroyInstance(instance, nullptr);
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return -1;
-    }
-    std::cout << "Vulkan surface created successfully." << std::endl;
-
-    try {
-        std::cout << "Starting Vulkan device setup..." << std::endl;
-
-        // Pick physical device
-        uint32_t deviceCount = 0;
-        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-        if (deviceCount == 0) {
-            throw std::runtime_error(
-                "Failed to find GPUs with Vulkan support!");
-        }
-        std::cout << "Found " << deviceCount << " Vulkan-capable devices."
-                  << std::endl;
-
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-
-        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-        for (const auto &device : devices) {
-            QueueFamilyIndices indices = findQueueFamilies(device, surface);
-            SwapChainSupportDetails swapChainSupport =
-                querySwapChainSupport(device, surface);
-
-            if (indices.isComplete() && !swapChainSupport.formats.empty() &&
-                !swapChainSupport.presentModes.empty()) {
-                physicalDevice = device;
-                break;
-            }
-        }
-
-        if (physicalDevice == VK_NULL_HANDLE) {
-            throw std::runtime_error("Failed to find a suitable GPU!");
-        }
-
-        // Create logical device
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
-        std::cout << "Queue families - Graphics: " << indices.graphicsFamily
-                  << ", Present: " << indices.presentFamily << std::endl;
-
-        if (!indices.isComplete()) {
-            throw std::runtime_error("Required queue families not found!");
-        }
-
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::vector<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily,
-                                                     indices.presentFamily};
-
-        // Remove duplicates
-        std::sort(uniqueQueueFamilies.begin(), uniqueQueueFamilies.end());
-        uniqueQueueFamilies.erase(
-            std::unique(uniqueQueueFamilies.begin(), uniqueQueueFamilies.end()),
-            uniqueQueueFamilies.end());
-
-        std::cout << "Creating " << uniqueQueueFamilies.size() << " queue(s)"
-                  << std::endl;
-
-        float queuePriority = 1.0f;
-        for (uint32_t queueFamily : uniqueQueueFamilies) {
-            VkDeviceQueueCreateInfo queueCreateInfo{};
-            queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex = queueFamily;
-            queueCreateInfo.queueCount = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
-            queueCreateInfos.push_back(queueCreateInfo);
-            std::cout << "  Queue family " << queueFamily << std::endl;
-        }
-
-        VkPhysicalDeviceFeatures deviceFeatures{};
-        // Initialize all features to VK_FALSE explicitly
-        memset(&deviceFeatures, 0, sizeof(deviceFeatures));
-
-        const std::vector<const char *> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-
-        // Check if device supports required extensions
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
-                                             &extensionCount, nullptr);
-
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
-                                             &extensionCount,
-                                             availableExtensions.data());
-
-        std::cout << "Checking device extensions..." << std::endl;
-        for (const char *requiredExtension : deviceExtensions) {
-            bool found = false;
-            for (const auto &extension : availableExtensions) {
-                if (strcmp(requiredExtension, extension.extensionName) == 0) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                throw std::runtime_error(
-                    std::string("Required device extension not available: ") +
-                    requiredExtension);
-            }
-            std::cout << "  ✓ " << requiredExtension << std::endl;
-        }
-
-        VkDeviceCreateInfo deviceCreateInfo{};
-        deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        deviceCreateInfo.queueCreateInfoCount =
-            static_cast<uint32_t>(queueCreateInfos.size());
-        deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-        deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-        deviceCreateInfo.enabledExtensionCount =
-            static_cast<uint32_t>(deviceExtensions.size());
-        deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
-        deviceCreateInfo.enabledLayerCount = 0; // Deprecated but set explicitly
-        deviceCreateInfo.ppEnabledLayerNames = nullptr;
-
-        std::cout << "Creating logical device..." << std::endl;
-        VkDevice device;
-        VkResult deviceResult =
-            vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
-        if (deviceResult != VK_SUCCESS) {
-            throw std::runtime_error(
-                "Failed to create logical device! Error code: " +
-                std::to_string(deviceResult));
-        }
-        std::cout << "Logical device created successfully." << std::endl;
-
-        VkQueue graphicsQueue, presentQueue;
-        vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
-
-        // Create swap chain
-        SwapChainSupportDetails swapChainSupport =
-            querySwapChainSupport(physicalDevice, surface);
-
-        VkSurfaceFormatKHR surfaceFormat =
-            chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode =
-            chooseSwapPresentMode(swapChainSupport.presentModes);
-        VkExtent2D extent =
-            chooseSwapExtent(swapChainSupport.capabilities, window);
-
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-        if (swapChainSupport.capabilities.maxImageCount > 0 &&
-            imageCount > swapChainSupport.capabilities.maxImageCount) {
-            imageCount = swapChainSupport.capabilities.maxImageCount;
-        }
-
-        VkSwapchainCreateInfoKHR swapchainCreateInfo{};
-        swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        swapchainCreateInfo.surface = surface;
-        swapchainCreateInfo.minImageCount = imageCount;
-        swapchainCreateInfo.imageFormat = surfaceFormat.format;
-        swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
-        swapchainCreateInfo.imageExtent = extent;
-        swapchainCreateInfo.imageArrayLayers = 1;
-        swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-        uint32_t queueFamilyIndices[] = {indices.graphicsFamily,
-                                         indices.presentFamily};
-
-        if (indices.graphicsFamily != indices.presentFamily) {
-            swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-            swapchainCreateInfo.queueFamilyIndexCount = 2;
-            swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
-        } else {
-            swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        }
-
-        swapchainCreateInfo.preTransform =
-            swapChainSupport.capabilities.currentTransform;
-        swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        swapchainCreateInfo.presentMode = presentMode;
-        swapchainCreateInfo.clipped = VK_TRUE;
-        swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
-
-        VkSwapchainKHR swapChain;
-        if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr,
-                                 &swapChain) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create swap chain!");
-        }
-
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
-        std::vector<VkImage> swapChainImages(imageCount);
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount,
-                                swapChainImages.data());
-
-        VkFormat swapChainImageFormat = surfaceFormat.format;
-        VkExtent2D swapChainExtent = extent;
-
-        // Create image views
-        std::vector<VkImageView> swapChainImageViews(swapChainImages.size());
-        for (size_t i = 0; i < swapChainImages.size(); i++) {
-            VkImageViewCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image = swapChainImages[i];
-            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            createInfo.format = swapChainImageFormat;
-            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            createInfo.subresourceRange.baseMipLevel = 0;
-            createInfo.subresourceRange.levelCount = 1;
-            createInfo.subresourceRange.baseArrayLayer = 0;
-            createInfo.subresourceRange.layerCount = 1;
-
-            if (vkCreateImageView(device, &createInfo, nullptr,
-                                  &swapChainImageViews[i]) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create image views!");
-            }
-        }
-
-        // Create render pass
-        VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = swapChainImageFormat;
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-        VkAttachmentReference colorAttachmentRef{};
-        colorAttachmentRef.attachment = 0;
-        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-        VkSubpassDescription subpass{};
-        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.colorAttachmentCount = 1;
-        subpass.pColorAttachments = &colorAttachmentRef;
-
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-        VkRenderPassCreateInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = 1;
-        renderPassInfo.pAttachments = &colorAttachment;
-        renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
-
-        VkRenderPass renderPass;
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("Failed to create render pass!");
-        }
-
-        // Load shaders from compiled SPIR-V files
-        std::cout << "Loading shader files..." << std::endl;
-
-        auto vertShaderCode = readFile("vertex.spv");
-        auto fragShaderCode = readFile("fragment.spv");
-
-        VkShaderModule vertShaderModule =
-            createShaderModule(device, vertShaderCode);
-        VkShaderModule fragShaderModule =
-            createShaderModule(device, fragShaderCode);
-
-        std::cout << "Shaders loaded successfully." << std::endl;
-
-        // Create graphics pipeline
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo,
-                                                          fragShaderStageInfo};
-
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.vertexAttributeDescriptionCount =
-            static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions =
-            attributeDescriptions.data();
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChainExtent.width;
-        viewport.height = (float)swapChainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = swapChainExtent;
-
-        VkPipelineViewportStateCreateInfo viewportState{};
-        viewportState.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-
-        VkPipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.colorWriteMask =
-            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-
-        VkPipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f;
-        colorBlending.blendConstants[1] = 0.0f;
-        colorBlending.blendConstants[2] = 0.0f;
-        colorBlending.blendConstants[3] = 0.0f;
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType =
-            VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-        VkPipelineLayout pipelineLayout;
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
-                                   &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create pipeline layout!");
-        }
-
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-        VkPipeline graphicsPipeline;
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                      nullptr,
-                                      &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create graphics pipeline!");
-        }
-
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
-
-        // Create framebuffers
-        std::vector<VkFramebuffer> swapChainFramebuffers(
-            swapChainImageViews.size());
-        for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            VkImageView attachments[] = {swapChainImageViews[i]};
-
-            VkFramebufferCreateInfo framebufferInfo{};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = renderPass;
-            framebufferInfo.attachmentCount = 1;
-            framebufferInfo.pAttachments = attachments;
-            framebufferInfo.width = swapChainExtent.width;
-            framebufferInfo.height = swapChainExtent.height;
-            framebufferInfo.layers = 1;
-
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                                    &swapChainFramebuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create framebuffer!");
-            }
+    rendererInfo.createSurface = [window](VkInstance instance) {
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        if (!SDL_Vulkan_CreateSurface(window, instance, &surface)) {
+            std::cerr << "Failed to create Vulkan surface: " << SDL_GetError()
+                      << "\n";
         }
+        return surface;
+    };
+    rendererInfo.drawableExtent = [window]() {
+        int width, height;
+        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+        return VkExtent2D{static_cast<uint32_t>(width),
+                          static_cast<uint32_t>(height)};
+    };
 
-        // Create command pool
-        VkCommandPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        poolInfo.queueFamilyIndex = indices.graphicsFamily;
+    try {
+        // SPIR-V compiled into the library, nothing is read from disk
+        rendererInfo.vertexShaderCode = rvivl::embeddedShader("vertex.vert");
+        rendererInfo.fragmentShaderCode =
+            rvivl::embeddedShader("fragment.frag");
+        rendererInfo.pipelineCachePath = "pipeline_cache.bin";
 
-        VkCommandPool commandPool;
-        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("Failed to create command pool!");
-        }
+        rvivl::Renderer renderer(rendererInfo);
 
         // Create vertex buffer
-        VkBuffer vertexBuffer;
-        VkDeviceMemory vertexBufferMemory;
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-        createBuffer(device, physicalDevice, bufferSize,
-                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     vertexBuffer, vertexBufferMemory);
-
-        void *data;
-        vkMapMemory(device, vertexBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, vertexBufferMemory);
+        rvivl::Buffer vertexBuffer = renderer.uploadQueue().createBuffer(
+            vertices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
         // Create index buffer
-        VkBuffer indexBuffer;
-        VkDeviceMemory indexBufferMemory;
         VkDeviceSize indexBufferSize =
             sizeof(quadIndices[0]) * quadIndices.size();
-
-        createBuffer(device, physicalDevice, indexBufferSize,
-                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     indexBuffer, indexBufferMemory);
-
-        vkMapMemory(device, indexBufferMemory, 0, indexBufferSize, 0, &data);
-        memcpy(data, quadIndices.data(), (size_t)indexBufferSize);
-        vkUnmapMemory(device, indexBufferMemory);
-
-        // Create command buffers
-        const int MAX_FRAMES_IN_FLIGHT = 2;
-        std::vector<VkCommandBuffer> commandBuffers(MAX_FRAMES_IN_FLIGHT);
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-        if (vkAllocateCommandBuffers(device, &allocInfo,
-                                     commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate command buffers!");
-        }
-
-        // Create synchronization objects
-        std::vector<VkSemaphore> imageAvailableSemaphores(MAX_FRAMES_IN_FLIGHT);
-        std::vector<VkSemaphore> renderFinishedSemaphores(MAX_FRAMES_IN_FLIGHT);
-        std::vector<VkFence> inFlightFences(MAX_FRAMES_IN_FLIGHT);
-
-        VkSemaphoreCreateInfo semaphoreInfo{};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr,
-                                  &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr,
-                                  &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fenceInfo, nullptr,
-                              &inFlightFences[i]) != VK_SUCCESS) {
-                throw std::runtime_error(
-                    "Failed to create synchronization objects for a frame!");
-            }
-        }
+        rvivl::Buffer indexBuffer = renderer.uploadQueue().createBuffer(
+            quadIndices.data(), indexBufferSize,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         std::cout
             << "Vulkan setup completed successfully. Rendering red quad...\n";
 
-        // Main render loop
+        // Main render loop. Everything is drawn for the first frame.
+        rvivl::DamageRegion damage;
+        damage.addAll();
         bool running = true;
-        uint32_t currentFrame = 0;
-
         while (running) {
+            // Leaves the event in the queue for the loop below
+            if (!continuous && damage.empty()) {
+                SDL_WaitEventTimeout(nullptr, IDLE_TIMEOUT_MS);
+            }
+
             SDL_Event event;
             while (SDL_PollEvent(&event)) {
                 if (event.type == SDL_QUIT) {
                     running = false;
+                } else if (event.type == SDL_WINDOWEVENT &&
+                           event.window.event ==
+                               SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    renderer.resize();
+                    damage.addAll();
+                } else if (event.type == SDL_WINDOWEVENT &&
+                           (event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+                            event.window.event == SDL_WINDOWEVENT_RESTORED)) {
+                    damage.addAll();
+                } else if (event.type == SDL_KEYDOWN ||
+                           event.type == SDL_MOUSEBUTTONDOWN) {
+                    // Only the quad would react to input
+                    renderer.markInput();
+                    damage.add(quadBounds(renderer.extent()));
                 }
             }
 
-            // Wait for the previous frame to finish
-            vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE,
-                            UINT64_MAX);
-            vkResetFences(device, 1, &inFlightFences[currentFrame]);
-
-            // Acquire an image from the swap chain
-            uint32_t imageIndex;
-            vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
-                                  imageAvailableSemaphores[currentFrame],
-                                  VK_NULL_HANDLE, &imageIndex);
-
-            // Reset and record the command buffer
-            vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-            if (vkBeginCommandBuffer(commandBuffers[currentFrame],
-                                     &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error(
-                    "Failed to begin recording command buffer!");
+            if (!running || (!continuous && damage.empty())) {
+                continue;
             }
 
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapChainExtent;
-
-            VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
-
-            vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo,
-                                 VK_SUBPASS_CONTENTS_INLINE);
+            if (!renderer.beginFrame()) {
+                // Minimized, nothing to draw until the window comes back
+                if (!continuous) {
+                    SDL_WaitEventTimeout(nullptr, IDLE_TIMEOUT_MS);
+                }
+                continue;
+            }
 
-            vkCmdBindPipeline(commandBuffers[currentFrame],
-                              VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              graphicsPipeline);
+            VkCommandBuffer commandBuffer = renderer.commandBuffer();
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              renderer.pipeline());
 
-            VkBuffer vertexBuffers[] = {vertexBuffer};
             VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1,
-                                   vertexBuffers, offsets);
-
-            vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0,
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer,
+                                   offsets);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0,
                                  VK_INDEX_TYPE_UINT16);
-
-            vkCmdDrawIndexed(commandBuffers[currentFrame],
+            vkCmdDrawIndexed(commandBuffer,
                              static_cast<uint32_t>(quadIndices.size()), 1, 0, 0,
                              0);
 
-            vkCmdEndRenderPass(commandBuffers[currentFrame]);
-
-            if (vkEndCommandBuffer(commandBuffers[currentFrame]) !=
-                VK_SUCCESS) {
-                throw std::runtime_error("Failed to record command buffer!");
-            }
-
-            // Submit the command buffer
-            VkSubmitInfo submitInfo{};
-            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-            VkSemaphore waitSemaphores[] = {
-                imageAvailableSemaphores[currentFrame]};
-            VkPipelineStageFlags waitStages[] = {
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-            submitInfo.waitSemaphoreCount = 1;
-            submitInfo.pWaitSemaphores = waitSemaphores;
-            submitInfo.pWaitDstStageMask = waitStages;
-
-            submitInfo.commandBufferCount = 1;
-            submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-
-            VkSemaphore signalSemaphores[] = {
-                renderFinishedSemaphores[currentFrame]};
-            submitInfo.signalSemaphoreCount = 1;
-            submitInfo.pSignalSemaphores = signalSemaphores;
-
-            if (vkQueueSubmit(graphicsQueue, 1, &submitInfo,
-                              inFlightFences[currentFrame]) != VK_SUCCESS) {
-                throw std::runtime_error(
-                    "Failed to submit draw command buffer!");
-            }
-
-            // Present the image
-            VkPresentInfoKHR presentInfo{};
-            presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-            presentInfo.waitSemaphoreCount = 1;
-            presentInfo.pWaitSemaphores = signalSemaphores;
-
-            VkSwapchainKHR swapChains[] = {swapChain};
-            presentInfo.swapchainCount = 1;
-            presentInfo.pSwapchains = swapChains;
-
-            presentInfo.pImageIndices = &imageIndex;
-
-            vkQueuePresentKHR(presentQueue, &presentInfo);
-
-            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            renderer.submit();
+            renderer.endFrame(damage.rects());
+            damage.clear();
         }
 
         // Wait for the device to finish operations before cleanup
-        vkDeviceWaitIdle(device);
+        renderer.waitIdle();
 
-        // Cleanup
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device, inFlightFences[i], nullptr);
+        rvivl::LatencyStats latency = renderer.latency();
+        if (latency.samples > 0) {
+            std::cout << "Input to present latency: "
+                      << std::chrono::duration<double, std::milli>(
+                             latency.average)
+                             .count()
+                      << " ms average over " << latency.samples
+                      << " inputs\n";
         }
 
-        vkDestroyCommandPool(device, commandPool, nullptr);
-
-        for (auto framebuffer : swapChainFramebuffers) {
-            vkDestroyFramebuffer(device, framebuffer, nullptr);
-        }
-
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass, nullptr);
-
-        for (auto imageView : swapChainImageViews) {
-            vkDestroyImageView(device, imageView, nullptr);
-        }
-
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
-
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
-
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
-
-        vkDestroyDevice(device, nullptr);
+        renderer.destroyBuffer(indexBuffer);
+        renderer.destroyBuffer(vertexBuffer);
 
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-        vkDestroyInstance(instance, nullptr);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return -1;
     }
 
     // Cleanup
-    vkDestroySurfaceKHR(instance, surface, nullptr);
-    vkDestroyInstance(instance, nullptr);
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;